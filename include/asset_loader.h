@@ -0,0 +1,52 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <functional>
+
+// Pipeline de carregamento de recursos em paralelo.
+//
+// Cada recurso é dividido em duas etapas:
+//   - "work":   parte somente de CPU (ler OBJ, computar normais, decodificar
+//               imagens com stb_image). Executada em uma thread do pool.
+//   - "upload": parte que chama OpenGL (criar VAOs, buffers e texturas).
+//               Executada sempre na thread que possui o contexto OpenGL.
+//
+// Uso típico (veja LoadGameResources() em main.cpp):
+//
+//     AssetLoader_Start();
+//     AssetLoader_Submit("terrain.obj", work, upload);
+//     ...                     // outras tarefas OpenGL, ex. compilar shaders
+//     AssetLoader_Finish();   // drena a fila de uploads e imprime os tempos
+//
+// Fora do intervalo Start()/Finish() o Submit() executa "work" e "upload"
+// imediatamente, na thread que o chamou.
+
+// Imagem decodificada na CPU, pronta para glTexImage2D()
+struct DecodedImage
+{
+    unsigned char* data;
+    int width;
+    int height;
+    int channels;
+
+    DecodedImage() : data(0), width(0), height(0), channels(0) {}
+};
+
+// Decodifica uma imagem com stb_image. Pode ser chamada de qualquer thread
+// (a inversão vertical é feita aqui, sem usar o estado global da stb_image).
+// Retorna false se a imagem não pôde ser lida.
+bool DecodeImageFile(const char* filename, bool flip_vertically, int desired_channels, DecodedImage* image);
+void FreeDecodedImage(DecodedImage* image);
+
+// Inicia o pool de threads. num_threads == 0 usa o número de núcleos da CPU.
+void AssetLoader_Start(unsigned int num_threads = 0);
+
+// Enfileira um recurso. "name" é usado apenas no relatório de tempos.
+void AssetLoader_Submit(const char* name, std::function<void()> work, std::function<void()> upload);
+
+// Executa os uploads pendentes até que todos os recursos estejam prontos,
+// encerra o pool e imprime o tempo de cada recurso. Exceções lançadas por
+// "work" são relançadas aqui, na thread do OpenGL.
+void AssetLoader_Finish();
+
+#endif // ASSET_LOADER_H
@@ -0,0 +1,73 @@
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Registro central de recursos carregados (modelos e texturas).
+//
+// Cada recurso é identificado pelo caminho do arquivo. Pedir o mesmo caminho
+// de novo devolve o mesmo handle e apenas incrementa o contador de
+// referências; os recursos de GPU só são destruídos quando a última referência
+// é liberada. As funções de carregamento em main.cpp (LoadModelToVirtualScene()
+// e LoadTextureImage()) usam este módulo; ele não lê arquivos por conta própria.
+//
+// Handles codificam o índice da entrada e uma geração, de modo que um handle
+// de um recurso já liberado nunca aponta para outro recurso que reutilizou a
+// mesma entrada. O valor 0 é sempre inválido.
+
+typedef unsigned int AssetHandle;
+typedef AssetHandle  ModelHandle;
+typedef AssetHandle  TextureHandle;
+
+#define INVALID_ASSET_HANDLE 0u
+
+// Recursos de um modelo ".obj": VAOs (um compartilhado e um por objeto
+// instanciado) com seus buffers e os objetos criados em g_VirtualScene (um por
+// "shape" do arquivo).
+struct ModelAsset
+{
+    std::string              path;
+    int                      refcount;
+    bool                     loaded;   // false enquanto o upload não terminou
+    std::vector<GLuint>      vertex_arrays;
+    std::vector<GLuint>      buffers;
+    std::vector<std::string> object_names;
+};
+
+// Recursos de uma imagem de textura
+struct TextureAsset
+{
+    std::string path;
+    int         refcount;
+    bool        loaded;
+    GLuint      texture_id;
+    GLuint      sampler_id;
+    GLuint      texture_unit; // Reservada em AssetRegistry_AcquireTexture()
+};
+
+// Obtém (criando se necessário) a entrada de "path" e incrementa suas
+// referências. "is_new" indica se o chamador deve de fato carregar o recurso.
+ModelHandle   AssetRegistry_AcquireModel(const char* path, bool* is_new);
+TextureHandle AssetRegistry_AcquireTexture(const char* path, bool* is_new);
+
+// NULL se o handle for inválido ou de um recurso já liberado
+ModelAsset*   AssetRegistry_GetModel(ModelHandle handle);
+TextureAsset* AssetRegistry_GetTexture(TextureHandle handle);
+
+// Decrementa as referências. Ao chegar em zero destrói os recursos de GPU e
+// retorna true; no caso de modelos "released" recebe a entrada (para que o
+// chamador remova os objetos de g_VirtualScene). Pode ser NULL.
+bool AssetRegistry_ReleaseModel(ModelHandle handle, ModelAsset* released);
+bool AssetRegistry_ReleaseTexture(TextureHandle handle);
+
+// Libera todos os recursos, independentemente das referências (fim do programa)
+void AssetRegistry_ReleaseAll();
+
+// Imprime quantos recursos estão carregados e quantos pedidos foram atendidos
+// pelo cache.
+void AssetRegistry_PrintStats();
+
+#endif // ASSET_REGISTRY_H
@@ -0,0 +1,83 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Culling por frustum de bounding boxes (AABBs).
+//
+// As caixas dos objetos (no espaço do objeto) são levadas para o espaço do
+// mundo pela matriz "model" e testadas contra os seis planos do frustum da
+// câmera, extraídos de projection*view. Objetos totalmente fora de algum plano
+// não são enviados para a fila de desenho.
+//
+// Objetos estáticos (que não se movem) ficam em uma BVH, uma árvore binária de
+// caixas envolventes: um nó fora do frustum rejeita todos os objetos abaixo
+// dele com um único teste, e um nó totalmente dentro aceita todos sem testes.
+
+// Planos com normais apontando para dentro: dot(plane.xyz, p) + plane.w >= 0
+// para pontos p dentro do frustum. Ordem: esquerda, direita, baixo, cima,
+// perto, longe.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+#define CULL_OUTSIDE   0
+#define CULL_INTERSECT 1
+#define CULL_INSIDE    2
+
+// Máscara com os seis planos (ponto de partida de Culling_TestBox())
+#define CULL_ALL_PLANES 0x3Fu
+
+Frustum Culling_ExtractFrustum(const glm::mat4& view_projection);
+
+// AABB no espaço do mundo que envolve a caixa [bbox_min, bbox_max] transformada por "model"
+void Culling_TransformBox(const glm::mat4& model, const glm::vec3& bbox_min, const glm::vec3& bbox_max,
+                          glm::vec3* world_min, glm::vec3* world_max);
+
+// Testa a caixa contra os planos de "plane_mask" (bits na ordem de Frustum).
+// Os planos dos quais a caixa está totalmente dentro são removidos da máscara,
+// que pode ser passada aos filhos de um nó da BVH.
+int Culling_TestBox(const Frustum& frustum, const glm::vec3& box_min, const glm::vec3& box_max, unsigned int* plane_mask);
+
+// Nó da BVH. Os itens de uma subárvore são contíguos em CullingBvh::items.
+struct CullingBvhNode
+{
+    glm::vec3 bbox_min;
+    glm::vec3 bbox_max;
+    int       first_item;
+    int       num_items;
+    int       first_child; // Filhos em first_child e first_child + 1; -1 em folhas (um item)
+};
+
+struct CullingBvh
+{
+    std::vector<CullingBvhNode> nodes;  // nodes[0] é a raiz
+    std::vector<int>            items;  // Índices passados a CullingBvh_Build()
+};
+
+// Constrói a BVH sobre as caixas (já no espaço do mundo) box_min[i]/box_max[i]
+void CullingBvh_Build(CullingBvh* bvh, const std::vector<glm::vec3>& box_min, const std::vector<glm::vec3>& box_max);
+
+// Acrescenta a "visible" os índices dos itens que tocam o frustum
+void CullingBvh_Query(const CullingBvh& bvh, const Frustum& frustum, std::vector<int>* visible);
+
+// Contadores do quadro atual
+struct CullingStats
+{
+    unsigned int visible;      // Objetos enviados para a fila de desenho
+    unsigned int culled;       // Objetos descartados
+    unsigned int tests;        // Testes caixa x frustum (nós da BVH e objetos)
+};
+
+extern CullingStats g_CullingStats;      // Quadro atual
+extern CullingStats g_CullingStatsLast;  // Último quadro completo
+
+// Fecha o quadro: copia g_CullingStats para g_CullingStatsLast e zera os contadores
+void CullingStats_EndFrame();
+
+#endif // CULLING_H
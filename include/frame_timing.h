@@ -0,0 +1,84 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <glad/glad.h>
+
+// Tempo de CPU e de GPU de cada etapa do quadro.
+//
+// Cada etapa (TimingPass) é medida entre FrameTiming_BeginPass() e
+// FrameTiming_EndPass(): na CPU com std::chrono::steady_clock e, nas etapas
+// que enviam comandos ao OpenGL, na GPU com um par de glQueryCounter(
+// GL_TIMESTAMP). As consultas ficam em um anel de TIMING_QUERY_FRAMES
+// quadros e só são lidas quando GL_QUERY_RESULT_AVAILABLE: a medida nunca
+// espera pela GPU. Se o resultado de um quadro ainda não chegou quando o seu
+// trecho do anel é reutilizado, a medida de GPU desse quadro é descartada.
+//
+// O tempo de um quadro é o intervalo entre dois FrameTiming_BeginFrame()
+// (inclui a troca de buffers e a espera por vsync). Os últimos
+// TIMING_HISTORY_FRAMES quadros ficam em um histórico, usado para os
+// percentis, para o gráfico do HUD e para o arquivo CSV.
+
+#define TIMING_QUERY_FRAMES   4     // Quadros de atraso tolerados na leitura da GPU
+#define TIMING_HISTORY_FRAMES 256   // Quadros no histórico (percentis)
+#define TIMING_GRAPH_FRAMES   120   // Quadros mostrados no gráfico
+
+enum TimingPass
+{
+    TIMING_PHYSICS,   // UpdateGamePhysics() (só CPU)
+    TIMING_SKYBOX,
+    TIMING_OPAQUE,    // Terreno e fila de desenho
+    TIMING_WATER,
+    TIMING_HUD,       // Texto e gráfico
+    TIMING_SWAP,      // glfwSwapBuffers() (só CPU)
+    NUM_TIMING_PASSES
+};
+
+// Resumo do histórico: percentis do tempo de quadro e médias por etapa, em
+// milissegundos. Valores < 0: sem medida.
+struct FrameTimingSummary
+{
+    unsigned int frames;
+    double frame_p50, frame_p95, frame_p99;
+    double gpu_p50, gpu_p95, gpu_p99;
+    double cpu_ms[NUM_TIMING_PASSES];
+    double gpu_ms[NUM_TIMING_PASSES];
+};
+
+// Cria as consultas e o programa do gráfico. Deve ser chamada com o contexto
+// OpenGL atual, depois de TransientBuffer_Init().
+void FrameTiming_Init();
+void FrameTiming_Destroy();
+
+// Início de um quadro: fecha o anterior e lê os resultados de GPU disponíveis
+void FrameTiming_BeginFrame();
+
+void FrameTiming_BeginPass(TimingPass pass);
+void FrameTiming_EndPass(TimingPass pass);
+
+// Mede uma etapa até o fim do escopo
+struct FrameTimingScope
+{
+    explicit FrameTimingScope(TimingPass pass) : pass(pass) { FrameTiming_BeginPass(pass); }
+    ~FrameTimingScope() { FrameTiming_EndPass(pass); }
+
+    TimingPass pass;
+};
+
+const char* FrameTiming_PassName(TimingPass pass);
+
+void FrameTiming_Summarize(FrameTimingSummary* summary);
+
+// Desenha os últimos TIMING_GRAPH_FRAMES quadros no retângulo (x0, y0) -
+// (x1, y1), em NDC: uma barra por quadro, empilhando o tempo de CPU de cada
+// etapa (o resto do quadro em cinza), e um traço branco no tempo de GPU. A
+// escala vertical vem do p99 de "summary" (de FrameTiming_Summarize()).
+void FrameTiming_DrawGraph(const FrameTimingSummary& summary, float x0, float y0, float x1, float y1);
+
+// Grava uma linha por quadro em "filename" (CSV), a partir do próximo quadro,
+// até FrameTiming_StopCsv(). Cada linha é escrita quando as medidas de GPU do
+// quadro chegam (ou são descartadas).
+bool FrameTiming_StartCsv(const char* filename);
+void FrameTiming_StopCsv();
+bool FrameTiming_IsRecordingCsv();
+
+#endif // FRAME_TIMING_H
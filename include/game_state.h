@@ -23,6 +23,13 @@ extern bool g_A_pressed;
 extern bool g_S_pressed;
 extern bool g_D_pressed;
 
+// Tempo da simulação (segundos), acumulado por UpdateGamePhysics(). Tudo que
+// depende do tempo de jogo (ondas, carga da vara) usa este relógio, e não o
+// relógio de parede, para que uma reprodução (veja input_record.h) seja exata.
+// Em double: em float, depois de algumas horas de jogo a resolução já
+// distorceria cada passo de 1/120 s.
+extern double g_SimulationTime;
+
 void InitializeGameState();
 
 ZoneType GetZoneTypeAtPosition(glm::vec3 position);
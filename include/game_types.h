@@ -34,11 +34,13 @@ enum CameraType {
 struct Boat {
     glm::vec3 position;
     float rotation_y;
+    float pitch;    // Inclinação causada pelas ondas (proa para cima > 0)
+    float roll;     // (boreste para cima > 0)
     float speed;
     float collision_radius;
     AABB bbox;
     
-    Boat() : position(0.0f, 0.0f, 0.0f), rotation_y(0.0f), speed(2.0f), collision_radius(0.8f) {}
+    Boat() : position(0.0f, 0.0f, 0.0f), rotation_y(0.0f), pitch(0.0f), roll(0.0f), speed(2.0f), collision_radius(0.8f) {}
 };
 
 struct Cube {
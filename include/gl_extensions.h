@@ -0,0 +1,71 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// Funcionalidades opcionais do OpenGL, além do núcleo 3.3 carregado pela glad.
+//
+// A glad deste projeto foi gerada apenas para o OpenGL 3.3. O que é mais novo
+// (ou só existe como extensão ARB) é carregado aqui com glfwGetProcAddress() e
+// só pode ser usado quando a flag correspondente de g_GLExtensions for true.
+
+#ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#define GL_PROGRAM_BINARY_FORMATS          0x87FF
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+#endif
+
+#ifndef GL_VERSION_4_3
+#define GL_DRAW_INDIRECT_BUFFER                   0x8F3F
+#define GL_SHADER_STORAGE_BUFFER                  0x90D2
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#define GL_SHADER_STORAGE_BLOCK                   0x92E6
+
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef GLuint (APIENTRYP PFNGLGETPROGRAMRESOURCEINDEXPROC)(GLuint program, GLenum programInterface, const GLchar* name);
+typedef void (APIENTRYP PFNGLSHADERSTORAGEBLOCKBINDINGPROC)(GLuint program, GLuint storageBlockIndex, GLuint storageBlockBinding);
+#endif
+
+#ifndef GL_VERSION_4_4
+#define GL_MAP_PERSISTENT_BIT  0x0040
+#define GL_MAP_COHERENT_BIT    0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+#endif
+
+struct GLExtensions
+{
+    int  version_major;  // Versão do contexto criado
+    int  version_minor;
+    bool program_binary; // OpenGL 4.1 ou GL_ARB_get_program_binary, com ao menos um formato
+    bool buffer_storage; // OpenGL 4.4 ou GL_ARB_buffer_storage (buffers mapeados persistentemente)
+    bool srgb_framebuffer; // O framebuffer ligado na inicialização codifica as cores em sRGB
+    bool multi_draw_indirect; // OpenGL 4.3 (MDI e shader storage buffers) e GL_ARB_shader_draw_parameters (gl_DrawIDARB)
+};
+
+extern GLExtensions g_GLExtensions;
+
+// Ponteiros carregados por GLExtensions_Init() (NULL quando indisponíveis)
+extern PFNGLGETPROGRAMBINARYPROC  glext_GetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC     glext_ProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glext_ProgramParameteri;
+extern PFNGLBUFFERSTORAGEPROC     glext_BufferStorage;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_MultiDrawElementsIndirect;
+extern PFNGLGETPROGRAMRESOURCEINDEXPROC   glext_GetProgramResourceIndex;
+extern PFNGLSHADERSTORAGEBLOCKBINDINGPROC glext_ShaderStorageBlockBinding;
+
+// Detecta versão/extensões do contexto atual e carrega os ponteiros acima.
+// Deve ser chamada com o contexto OpenGL atual, depois da glad, com o
+// framebuffer de desenho já ligado.
+void GLExtensions_Init();
+
+// true se o contexto atual anuncia a extensão "name" (ex.: "GL_ARB_get_program_binary")
+bool GLExtensions_Has(const char* name);
+
+#endif // GL_EXTENSIONS_H
@@ -0,0 +1,36 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+
+// Modo sem janela visível ("--headless"), para medir o jogo em máquinas de
+// build e CI (por exemplo com llvmpipe).
+//
+// A janela GLFW é criada invisível e só fornece o contexto OpenGL; a cena é
+// desenhada em um framebuffer de largura x altura configuráveis, ligado uma
+// vez como GL_DRAW_FRAMEBUFFER e nunca desligado. O laço principal roda como
+// no jogo normal: Headless_EndFrame() faz o papel de glfwSwapBuffers().
+//
+// O framebuffer imita o da janela: cor sRGB (veja GL_FRAMEBUFFER_SRGB em
+// RenderScene()), profundidade com stencil e HEADLESS_SAMPLES amostras.
+
+#define HEADLESS_SAMPLES 4   // Mesmo MSAA pedido para a janela (GLFW_SAMPLES)
+
+// Lê um tamanho no formato "LARGURAxALTURA". Retorna false se inválido.
+bool Headless_ParseSize(const char* text, int* width, int* height);
+
+// Cria e liga o framebuffer; deve ser chamada com o contexto OpenGL atual,
+// antes de GLExtensions_Init(). "max_frames" == 0: sem limite de quadros.
+// Retorna false (e não liga nada) se o framebuffer ficar incompleto.
+bool Headless_Init(int width, int height, int max_frames);
+void Headless_Destroy();
+
+// Fim do quadro: espera a GPU terminar (o tempo de cada quadro inclui o
+// trabalho da GPU, como com a troca de buffers da janela) e conta o quadro.
+// Retorna true quando o limite de quadros foi atingido.
+bool Headless_EndFrame();
+
+// Imprime o número de quadros desenhados e o tempo médio por quadro
+void Headless_PrintSummary();
+
+#endif // HEADLESS_H
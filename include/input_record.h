@@ -0,0 +1,48 @@
+#ifndef INPUT_RECORD_H
+#define INPUT_RECORD_H
+
+#include <GLFW/glfw3.h>
+
+// Gravação e reprodução da entrada do jogador ("--record" / "--replay").
+//
+// Na gravação, cada quadro grava o seu deltaTime e, em seguida, os eventos de
+// teclado, botões, cursor e rodinha recebidos em glfwPollEvents(), na ordem
+// em que chegaram. Na reprodução, o deltaTime de cada quadro vem do arquivo
+// (a simulação avança exatamente como na sessão gravada, não importa quão
+// rápido o quadro seja desenhado) e os eventos gravados são entregues aos
+// mesmos callbacks do jogo, ao fim do mesmo quadro; a entrada real é
+// ignorada, exceto ESC, que interrompe a reprodução.
+//
+// Arquivo: "CDIN", versão (1 byte) e registros de um byte de tipo seguido
+// dos campos, em little-endian:
+//
+//   FRAME   float delta_time
+//   KEY     int16 key, int16 scancode, uint8 action, uint8 mods
+//   BUTTON  uint8 button, uint8 action, uint8 mods
+//   CURSOR  double x, double y
+//   SCROLL  double x_offset, double y_offset
+
+// Começa a gravar ou a reproduzir. Devem ser chamadas depois que os callbacks
+// do jogo foram registrados na janela: eles são substituídos por versões que
+// gravam (ou ignoram) os eventos e chamam os originais.
+bool InputRecord_StartRecording(GLFWwindow* window, const char* filename);
+bool InputRecord_StartReplay(GLFWwindow* window, const char* filename);
+
+// Encerra a gravação/reprodução e devolve os callbacks originais
+void InputRecord_Stop();
+
+bool InputRecord_IsRecording();
+bool InputRecord_IsReplaying();
+
+// Início do quadro. Na gravação grava "*delta_time"; na reprodução o
+// substitui pelo valor gravado. Retorna false quando a reprodução terminou.
+bool InputRecord_BeginFrame(float* delta_time);
+
+// Fim do quadro, depois de glfwPollEvents(): na reprodução, entrega os
+// eventos gravados neste quadro
+void InputRecord_EndFrame();
+
+// glfwGetCursorPos(), ou a última posição reproduzida durante a reprodução
+void InputRecord_GetCursorPos(GLFWwindow* window, double* x, double* y);
+
+#endif // INPUT_RECORD_H
@@ -0,0 +1,125 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+// Número máximo de níveis de detalhe por objeto (incluindo a malha completa)
+#define MESH_MAX_LODS 4
+
+// Opções de construção de uma malha, gravadas no arquivo cozido: um arquivo
+// construído com outras opções é considerado desatualizado.
+#define MESH_BUILD_STATIC_BATCH 1 // Objetos não instanciados do OBJ viram um só (veja BuildMeshData())
+#define MESH_BUILD_INSTANCING    2 // Cópias (transformações afins) de um objeto viram instâncias dele
+#define MESH_BUILD_CLUSTERS      4 // Lote estático e instâncias separados por região (veja MESH_CLUSTER_GRID)
+
+// Com MESH_BUILD_CLUSTERS, o plano XZ da malha é dividido em uma grade de
+// MESH_CLUSTER_GRID x MESH_CLUSTER_GRID regiões. Cada região vira um lote (e
+// um grupo de instâncias por protótipo), que o culling por frustum pode
+// descartar sem descartar o resto da malha.
+#define MESH_CLUSTER_GRID 4
+
+// Floats por transformação de instância: matriz afim 3x4, linha a linha
+#define MESH_INSTANCE_FLOATS 12
+
+// Um nível de detalhe: trecho de indices[] que usa os mesmos vértices do objeto
+struct MeshLod
+{
+    size_t first_index;
+    size_t num_indices;
+    float  error; // Erro geométrico no espaço do objeto (0 para a malha completa)
+};
+
+// Informações de um objeto (shape) dentro dos streams de uma malha. Cada uma
+// vira um SceneObject em g_VirtualScene.
+struct MeshShape
+{
+    std::string name;
+    size_t      first_index; // Primeiro índice dentro de indices[]
+    size_t      num_indices; // Número de índices do objeto
+    size_t      first_vertex; // Vértices do objeto são contíguos (veja BuildMeshData())
+    size_t      num_vertices;
+    glm::vec3   bbox_min;
+    glm::vec3   bbox_max;
+    glm::vec3   material_kd; // Cor do primeiro triângulo; por vértice em "color_coefficients" se houver
+    int         num_lods;          // lods[0] é sempre a malha completa
+    MeshLod     lods[MESH_MAX_LODS];
+    size_t      first_instance;    // Dentro de instance_transforms (em transformações)
+    size_t      num_instances;     // 0: objeto comum; > 0: desenhado uma vez por transformação
+};
+
+// Streams de vértices e índices de uma malha. Construídos em BuildMeshData()
+// a partir de um ObjModel. Os streams em float ficam disponíveis para
+// processamento na CPU; o que vai para a GPU é "vertices", no formato compacto
+// de vertex_format.h, gerado por MeshData_PackVertices().
+struct MeshData
+{
+    std::vector<float>     model_coefficients;   // vec4 por vértice
+    std::vector<float>     normal_coefficients;  // vec4 por vértice (pode ser vazio)
+    std::vector<float>     texture_coefficients; // vec2 por vértice (pode ser vazio)
+    std::vector<float>     color_coefficients;   // vec3 por vértice: Kd do material (vazio se cada objeto tiver uma só cor)
+    std::vector<float>     instance_transforms;  // MESH_INSTANCE_FLOATS por instância (veja MeshShape)
+    std::vector<GLuint>    indices;
+    std::vector<MeshShape> shapes;
+
+    std::vector<unsigned char> vertices;     // Vértices intercalados e quantizados
+    unsigned int               vertex_flags; // VERTEX_FORMAT_* presentes em "vertices"
+
+    MeshData() : vertex_flags(0) {}
+};
+
+// Visão não-proprietária dos buffers de uma malha. Aponta ou para um MeshData
+// em memória ou diretamente para um arquivo cozido mapeado em memória.
+struct MeshView
+{
+    const unsigned char* vertices;
+    size_t               num_vertices;
+    unsigned int         vertex_flags;
+    const GLuint*        indices;
+    size_t               num_indices;
+    const float*         instance_transforms;
+    size_t               num_instances;
+    const std::vector<MeshShape>* shapes;
+};
+
+// Malha cozida aberta a partir do disco. Os ponteiros de "view" são válidos
+// até MeshCache_Close().
+struct CookedMesh
+{
+    MeshView               view;
+    std::vector<MeshShape> shapes;
+    void*                  mapping;
+    size_t                 mapping_size;
+
+    CookedMesh() : mapping(NULL), mapping_size(0) {}
+};
+
+// Gera mesh->vertices a partir dos streams em float, quantizando as posições
+// de cada objeto contra a sua bounding box.
+void MeshData_PackVertices(MeshData* mesh);
+
+MeshView MeshData_View(const MeshData& mesh);
+
+// Reconstrói os streams em float com os objetos na ordem de "order" (índices
+// em mesh->shapes); objetos fora da lista são descartados. Só vale antes dos
+// LODs e de MeshData_PackVertices(), quando indices[] contém apenas as malhas
+// completas dos objetos.
+void MeshData_ReorderShapes(MeshData* mesh, const std::vector<size_t>& order);
+
+// Caminho do arquivo cozido correspondente a um ".obj" (mesmo nome, extensão ".mesh")
+std::string MeshCache_PathFor(const char* obj_filename);
+
+// Abre a versão cozida de "obj_filename". Retorna false se ela não existir,
+// estiver corrompida, desatualizada em relação ao OBJ/MTL de origem ou tiver
+// sido construída com outras opções (MESH_BUILD_*).
+bool MeshCache_Open(const char* obj_filename, unsigned int build_flags, CookedMesh* cooked);
+void MeshCache_Close(CookedMesh* cooked);
+
+// Grava a versão cozida de "obj_filename" a partir dos streams já construídos.
+bool MeshCache_Write(const char* obj_filename, unsigned int build_flags, const MeshData& mesh);
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,33 @@
+#ifndef MESH_INSTANCING_H
+#define MESH_INSTANCING_H
+
+#include <cstddef>
+#include <vector>
+
+#include "mesh_cache.h"
+
+// Detecção automática de instâncias: objetos de um mesmo OBJ que são cópias
+// uns dos outros (ex. centenas de árvores duplicadas no Blender) viram um único
+// protótipo mais uma transformação por cópia, desenhados com
+// glDrawElementsInstanced(). A memória de vértices passa a crescer com a
+// geometria distinta, não com o número de cópias.
+//
+// Dois objetos são cópias se tiverem a mesma topologia (mesmo número de
+// vértices e a mesma lista de índices relativa ao primeiro vértice, como fica
+// ao duplicar um objeto) e se existir uma transformação afim, sem espelhamento,
+// que leve as posições do protótipo às da cópia dentro da tolerância. As
+// normais (transformadas pela inversa transposta), as coordenadas de textura e
+// as cores também precisam conferir. Objetos planos ou degenerados, em que a
+// transformação não fica determinada pelas posições, nunca são instanciados.
+
+// Procura cópias entre os objetos de "mesh", que deve estar como sai da
+// soldagem de BuildMeshData() (antes dos LODs e de MeshData_PackVertices()).
+// Cada protótipo com cópias recebe em mesh->instance_transforms a identidade
+// (ele mesmo) seguida de uma transformação por cópia; as cópias são removidas
+// dos streams. Retorna o número de objetos removidos.
+//
+// Se "groups" não for NULL, groups[s] é o grupo do objeto s e só objetos do
+// mesmo grupo são instâncias de um mesmo protótipo (veja MESH_BUILD_CLUSTERS).
+size_t MeshInstancing_Detect(MeshData* mesh, const std::vector<int>* groups = NULL);
+
+#endif // MESH_INSTANCING_H
@@ -0,0 +1,41 @@
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Simplificação de malhas por colapso de arestas com métrica de erro
+// quádrica (Garland & Heckbert, "Surface Simplification Using Quadric Error
+// Metrics", 1997).
+//
+// Os colapsos sempre levam um vértice até um vértice vizinho já existente
+// ("vertex subset"), de modo que todos os níveis de detalhe (LODs) usam o mesmo
+// vertex buffer da malha original: cada LOD é apenas um novo trecho de índices.
+// Vértices em bordas abertas e em costuras de atributos (mesma posição com
+// normais/UVs diferentes) nunca são movidos, preservando silhuetas e texturas.
+
+// Resultado de um nível de detalhe
+struct SimplifiedLod
+{
+    std::vector<GLuint> indices; // Triângulos (mesmos índices de vértice da entrada)
+    float               error;   // Distância aproximada (espaço do objeto) até a malha original
+};
+
+// Gera uma cadeia de LODs para os triângulos "indices[0..num_indices)", cujos
+// vértices estão em [first_vertex, first_vertex + num_vertices). "positions" e
+// "normals" contêm vec4 por vértice (model_coefficients e normal_coefficients
+// de MeshData); "normals" pode ser NULL. Além da distância aos planos, o custo
+// de um colapso inclui a diferença entre as normais dos dois vértices (escalada
+// pelo comprimento da aresta), para que detalhes que só aparecem no
+// sombreamento, como sulcos finos, não sejam tratados como erro zero. A simplificação é
+// contínua: o LOD i é gerado a partir do LOD i-1, parando em cada alvo de
+// "target_index_counts" (em ordem decrescente). Retorna menos LODs que alvos
+// se a malha não puder mais ser reduzida de forma significativa.
+std::vector<SimplifiedLod> MeshSimplify_BuildLods(
+    const float* positions, const float* normals, size_t first_vertex, size_t num_vertices,
+    const GLuint* indices, size_t num_indices,
+    const std::vector<size_t>& target_index_counts);
+
+#endif // MESH_SIMPLIFY_H
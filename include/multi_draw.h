@@ -0,0 +1,42 @@
+#ifndef MULTI_DRAW_H
+#define MULTI_DRAW_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "uniform_buffers.h"
+
+// Backend de desenho indireto (OpenGL 4.3+ com GL_ARB_shader_draw_parameters,
+// veja g_GLExtensions.multi_draw_indirect).
+//
+// No caminho do OpenGL 3.3 cada desenho da fila liga o seu trecho de
+// ObjectUniforms e chama glDrawElements(). Aqui uma sequência de desenhos com
+// o mesmo programa e o mesmo VAO vira uma única chamada a
+// glMultiDrawElementsIndirect(): os comandos (contagem, primeiro índice,
+// instâncias) e os dados de cada desenho (o mesmo layout de ObjectUniforms,
+// em std430) vão para o buffer transitório (transient_buffer.h), e o shader
+// lê os dados do seu desenho em um shader storage buffer indexado por
+// gl_DrawIDARB. Os programas usados são as variantes compiladas com
+// MULTI_DRAW_INDIRECT (veja LoadShadersFromFiles() em "main.cpp").
+
+#define MULTI_DRAW_BINDING_OBJECTS 0   // Binding do bloco "ObjectBuffer"
+
+// Deve ser chamada depois de GLExtensions_Init(); não faz nada se o backend
+// não estiver disponível
+void MultiDraw_Init();
+
+// Liga o bloco "ObjectBuffer" de "program_id" ao seu binding
+void MultiDraw_BindBlocks(GLuint program_id);
+
+// Acrescenta um desenho ao lote atual: "num_indices" índices (GL_UNSIGNED_INT)
+// a partir de "first_index" no GL_ELEMENT_ARRAY_BUFFER do VAO, com
+// "num_instances" instâncias (0: objeto não instanciado)
+void MultiDraw_Add(const ObjectUniforms& object, GLuint num_indices, GLuint first_index, GLsizei num_instances);
+
+// Desenha o lote com o programa e o VAO já ligados e o esvazia. Retorna o
+// número de desenhos do lote (0 se o buffer transitório estiver cheio e o
+// lote tiver sido descartado).
+size_t MultiDraw_Flush(GLenum mode);
+
+#endif // MULTI_DRAW_H
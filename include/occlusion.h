@@ -0,0 +1,56 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+
+// Culling por oclusão com consultas de hardware e renderização condicional.
+//
+// Para cada objeto participante ("slot"), desenhamos depois da cena uma caixa
+// (a bounding box no espaço do mundo) sem escrever cor nem profundidade,
+// dentro de uma consulta GL_ANY_SAMPLES_PASSED: o resultado diz se algum
+// pixel da caixa passou no teste de profundidade, ou seja, se o objeto pode
+// estar visível. No quadro seguinte o objeto é desenhado entre
+// glBeginConditionalRender() e glEndConditionalRender() com GL_QUERY_NO_WAIT:
+// a GPU descarta o desenho se a caixa estava oculta, e a CPU nunca espera
+// pelo resultado.
+//
+// Como o resultado é de um quadro atrás, um objeto que acabou de aparecer
+// (ex. ao girar a câmera) pode demorar um quadro para ser desenhado. Objetos
+// sem consulta no quadro anterior (ex. fora do frustum) e objetos cuja caixa
+// contém a câmera são desenhados sem condição.
+
+struct OcclusionStats
+{
+    unsigned int queries;     // Caixas desenhadas com consulta
+    unsigned int conditional; // Desenhos condicionados a uma consulta
+    unsigned int skipped;     // Destes, os com resultado já disponível e "oculto"
+};
+
+extern OcclusionStats g_OcclusionStats;      // Quadro atual
+extern OcclusionStats g_OcclusionStatsLast;  // Último quadro completo
+
+// Cria o programa e a caixa. Deve ser chamada com o contexto OpenGL atual.
+void Occlusion_Init();
+void Occlusion_Destroy();
+
+// (Re)cria as consultas para "count" slots, descartando os resultados antigos
+void Occlusion_Resize(size_t count);
+
+// Início do quadro: posição da câmera no espaço do mundo
+void Occlusion_BeginFrame(const glm::vec3& camera_position);
+
+// Agenda a caixa do "slot" para a consulta deste quadro e retorna a consulta
+// que deve condicionar o desenho do objeto (0: desenhar sem condição).
+GLuint Occlusion_Test(size_t slot, const glm::vec3& world_min, const glm::vec3& world_max);
+
+// Desenha as caixas agendadas, cada uma com sua consulta. Usa o buffer de
+// profundidade da cena já desenhada e altera o programa e o VAO ligados.
+void Occlusion_IssueQueries();
+
+// Fecha o quadro: copia g_OcclusionStats para g_OcclusionStatsLast e zera os contadores
+void OcclusionStats_EndFrame();
+
+#endif // OCCLUSION_H
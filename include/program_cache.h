@@ -0,0 +1,51 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+// Cache em disco de programas de GPU já linkados (glGetProgramBinary /
+// glProgramBinary, OpenGL 4.1 ou GL_ARB_get_program_binary).
+//
+// Cada programa tem um nome ("main", "skybox", ...) e é gravado em
+// "../../data/<nome>.glprogram". A chave do cache é um hash das fontes GLSL e
+// das strings de fabricante/renderizador/versão do driver: editar um shader
+// ou trocar de driver invalida o arquivo sem nenhuma ação manual. Se o driver
+// recusar o binário, o programa é compilado normalmente e o arquivo regravado.
+//
+// Uso típico:
+//
+//     ProgramCacheKey key = ProgramCache_Key("main", vertex_source, fragment_source);
+//     GLuint program_id = ProgramCache_Load(key);
+//     if (program_id == 0)
+//     {
+//         ... compila os shaders, glCreateProgram(), glAttachShader() ...
+//         ProgramCache_PrepareLink(program_id);
+//         glLinkProgram(program_id);
+//         ProgramCache_Store(key, program_id);
+//     }
+//
+// Sem suporte do driver (veja gl_extensions.h) Load() sempre retorna 0 e as
+// demais funções não fazem nada.
+
+struct ProgramCacheKey
+{
+    std::string        name;
+    std::string        path;
+    unsigned long long hash;
+};
+
+ProgramCacheKey ProgramCache_Key(const char* name, const char* vertex_source, const char* fragment_source);
+
+// Cria um programa a partir do binário gravado. Retorna 0 se não houver
+// arquivo, se a chave não bater ou se o driver recusar o binário.
+GLuint ProgramCache_Load(const ProgramCacheKey& key);
+
+// Pede ao driver que mantenha o binário do programa; chamar antes de glLinkProgram()
+void ProgramCache_PrepareLink(GLuint program_id);
+
+// Grava o binário de um programa linkado com sucesso
+void ProgramCache_Store(const ProgramCacheKey& key, GLuint program_id);
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,98 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+// Fila de desenho ordenada e cache de estado do OpenGL.
+//
+// Em vez de desenhar na ordem em que o código da cena é escrito, cada desenho
+// vira um pacote (RenderPacket) com uma chave de 64 bits. A fila é ordenada
+// pela chave antes de ser executada, agrupando desenhos que usam o mesmo
+// programa e o mesmo VAO:
+//
+//   opacos:        passe (2) | programa (8) | VAO (16) | profundidade (24) | ordem (14)
+//   transparentes: passe (2) | profundidade invertida (24) | programa (8) | VAO (16) | ordem (14)
+//
+// Opacos são desenhados da frente para trás dentro de cada VAO (menos
+// fragmentos sombreados à toa). Transparentes precisam da ordem de trás para
+// a frente acima de tudo, então a profundidade vem antes do estado. "ordem" é
+// a posição de submissão, que desempata chaves iguais.
+//
+// As funções RenderState_* guardam o último valor enviado de cada estado e só
+// chamam o OpenGL quando ele muda, contando as chamadas evitadas em
+// g_RenderStats. Código que altera o mesmo estado diretamente (ex. skybox,
+// texto) deve chamar RenderState_Invalidate() antes de voltar a usar o cache.
+
+#define RENDER_PASS_OPAQUE      0
+#define RENDER_PASS_TRANSPARENT 1
+
+struct RenderPacket
+{
+    uint64_t  sort_key;
+    GLuint    program_id;
+    GLuint    vertex_array_object_id;
+    int       scene_object; // Handle do objeto em g_VirtualScene (main.cpp)
+    GLuint    occlusion_query; // Consulta que condiciona o desenho; 0: nenhuma (veja occlusion.h)
+    glm::mat4 model;
+};
+
+struct RenderQueue
+{
+    std::vector<RenderPacket> packets;
+    std::vector<uint32_t>     order;   // Índices em packets, ordenados pela chave
+};
+
+// Chave de ordenação (veja acima). "view_depth" é a distância do objeto à
+// câmera ao longo da direção de visão; valores negativos contam como zero.
+uint64_t RenderQueue_MakeKey(int pass, GLuint program_id, GLuint vertex_array_object_id, float view_depth, uint32_t sequence);
+
+void RenderQueue_Clear(RenderQueue* queue);
+
+// Acrescenta um pacote; "sort_key" deve ter sido preenchida com RenderQueue_MakeKey()
+void RenderQueue_Submit(RenderQueue* queue, const RenderPacket& packet);
+
+// Preenche queue->order; percorrer packets[order[i]] dá a ordem de desenho
+void RenderQueue_Sort(RenderQueue* queue);
+
+// Passe de um pacote, extraído da chave
+int RenderQueue_Pass(const RenderPacket& packet);
+
+// Contadores do quadro atual: chamadas feitas ao OpenGL e chamadas evitadas
+// porque o valor já estava ligado/enviado.
+struct RenderStats
+{
+    unsigned int draws;           // Chamadas de desenho (um glMultiDrawElementsIndirect() conta uma)
+    unsigned int indirect_draws;  // Desenhos feitos dentro de glMultiDrawElementsIndirect() (veja multi_draw.h)
+    unsigned int binds;           // glUseProgram, glBindVertexArray, glEnable/glDisable(GL_BLEND)
+    unsigned int binds_skipped;
+    unsigned int uniforms;        // glBindBufferRange() de uniform buffers
+    unsigned int uniforms_skipped;
+};
+
+extern RenderStats g_RenderStats;       // Quadro atual
+extern RenderStats g_RenderStatsLast;   // Último quadro completo
+
+// Fecha o quadro: copia g_RenderStats para g_RenderStatsLast e zera os contadores
+void RenderStats_EndFrame();
+
+// Esquece todos os valores guardados (o próximo envio de cada estado é feito)
+void RenderState_Invalidate();
+
+void RenderState_UseProgram(GLuint program_id);
+void RenderState_BindVertexArray(GLuint vertex_array_object_id);
+void RenderState_SetBlend(bool enabled);
+
+// glBindBufferRange(GL_UNIFORM_BUFFER, binding, ...) (veja uniform_buffers.h)
+void RenderState_BindBufferRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+// Conta um desenho em g_RenderStats
+void RenderState_CountDraw();
+
+// Conta uma chamada de desenho indireto com "commands" desenhos
+void RenderState_CountMultiDraw(unsigned int commands);
+
+#endif // RENDER_QUEUE_H
@@ -6,12 +6,9 @@
 #include <glad/glad.h>
 
 // Estrutura para passar informações de rendering para a linha de pesca
+// (os dados por objeto vão no uniform buffer de desenhos avulsos, veja uniform_buffers.h)
 struct FishingLineRenderInfo {
-    GLuint program_id;
-    GLint model_uniform;
-    GLint object_id_uniform;
-    GLint bbox_min_uniform;
-    GLint bbox_max_uniform;
+    GLuint program_id; // Variante do programa principal com o material da linha
 };
 
 // Função para inicializar e carregar os modelos das varas
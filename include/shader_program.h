@@ -0,0 +1,28 @@
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <string>
+
+#include <glad/glad.h>
+
+// Leitura, compilação e linkagem dos programas de GPU, com o cache em disco de
+// program_cache.h. Usado por todos os programas: as variantes do shader
+// principal (LoadShadersFromFiles() em main.cpp, que passa as fontes já com
+// os "#define" de cada variante), o texto, o skybox, a oclusão e o gráfico de
+// tempos.
+
+// Lê o código de um shader. Encerra o programa se o arquivo não existir.
+std::string ShaderProgram_ReadFile(const char* filename);
+
+// Compila um shader; em caso de erro imprime o log com "name" (arquivo ou
+// descrição do shader)
+GLuint ShaderProgram_Compile(const char* name, const char* source, GLenum type);
+
+// Obtém o programa "cache_name" do cache em disco ou o compila e linka a
+// partir das fontes, gravando-o no cache se a linkagem tiver sucesso.
+// "vertex_name"/"fragment_name" identificam os shaders nas mensagens de erro.
+GLuint ShaderProgram_Create(const char* cache_name,
+                            const char* vertex_name, const char* vertex_source,
+                            const char* fragment_name, const char* fragment_source);
+
+#endif // SHADER_PROGRAM_H
@@ -0,0 +1,84 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include "culling.h"
+
+// Terreno em heightfield com geomipmapping.
+//
+// A malha do arquivo .obj (um heightfield triangulado em XZ) é reamostrada em
+// uma grade regular de alturas, com a cor do material de cada ponto, e dividida
+// em blocos (chunks) de TERRAIN_CHUNK_QUADS x TERRAIN_CHUNK_QUADS quadriláteros.
+// Cada bloco é desenhado em um de TERRAIN_LOD_LEVELS níveis: no nível L só um
+// a cada 2^L vértices da grade é usado em cada direção, então o custo de um
+// bloco distante não depende da resolução da grade.
+//
+// O nível de cada bloco vem da distância até a câmera e difere em no máximo 1
+// do nível dos vizinhos. Na borda com um vizinho mais grosseiro os vértices
+// ímpares são ligados ao vértice par anterior (triângulos degenerados são
+// descartados pela GPU), e as duas bordas coincidem: sem rachaduras.
+//
+// Os vértices usam o formato de "vertex_format.h" (normais e cores), e o
+// desenho usa a variante "terrain" do programa principal: a cor do .mtl
+// interpolada entre os pontos da grade (SMOOTH_MATERIAL_COLOR).
+
+#define TERRAIN_CHUNK_QUADS 16
+#define TERRAIN_LOD_LEVELS  5   // Passos 1, 2, 4, 8 e 16 vértices
+
+// Distância (no mundo) até a qual os blocos usam o nível 0; cada vez que ela
+// dobra, o nível aumenta em 1
+#define TERRAIN_LOD_DISTANCE 32.0f
+
+// Índices de um bloco em um nível, para uma combinação de vizinhos mais grosseiros
+struct TerrainPattern
+{
+    GLsizei first_index;
+    GLsizei num_indices;
+};
+
+struct TerrainChunk
+{
+    glm::vec3 world_min;   // Caixa envolvente no espaço do mundo
+    glm::vec3 world_max;
+    int       lod;         // Nível escolhido no quadro atual
+};
+
+struct Terrain
+{
+    int       chunks_per_side;
+    int       samples_per_side;  // chunks_per_side * TERRAIN_CHUNK_QUADS + 1
+    glm::mat4 model;
+    glm::vec3 bbox_min;          // Caixa do heightfield no espaço do objeto
+    glm::vec3 bbox_max;
+
+    std::vector<TerrainChunk> chunks;   // chunks[z * chunks_per_side + x]
+    TerrainPattern patterns[TERRAIN_LOD_LEVELS][16];
+
+    GLuint vertex_array;
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+
+    // Listas do glMultiDrawElementsBaseVertex() do quadro
+    std::vector<GLsizei>     draw_counts;
+    std::vector<const void*> draw_offsets;
+    std::vector<GLint>       draw_base_vertices;
+};
+
+// Lê "filename" e constrói o terreno com chunks_per_side^2 blocos, desenhado
+// com a matriz "model". A reamostragem é feita no pool de asset_loader.h e o
+// envio para a GPU na thread do OpenGL.
+void Terrain_Load(Terrain* terrain, const char* filename, int chunks_per_side, const glm::mat4& model);
+void Terrain_Destroy(Terrain* terrain);
+
+// Escolhe o nível de cada bloco pela distância até "camera_position" (ou o
+// nível 0 em todos se !use_lod) e desenha os blocos que tocam "frustum" (todos
+// se frustum == NULL) com o programa "program_id", em uma única chamada.
+// Os blocos contam como objetos em g_CullingStats.
+void Terrain_Render(Terrain* terrain, GLuint program_id, const glm::vec3& camera_position, const Frustum* frustum, bool use_lod);
+
+#endif // TERRAIN_H
@@ -0,0 +1,51 @@
+#ifndef TRANSIENT_BUFFER_H
+#define TRANSIENT_BUFFER_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+// Buffer de vértices para geometria transitória, refeita a cada quadro (linha
+// de pesca, texto, geometria de depuração).
+//
+// Um único buffer, alocado uma vez, é dividido em TRANSIENT_RING_FRAMES
+// trechos de TRANSIENT_FRAME_BYTES; cada quadro escreve no seu trecho. Ao fim
+// do quadro uma cerca (glFenceSync) marca o último comando que lê o trecho, e
+// antes de reutilizá-lo, TRANSIENT_RING_FRAMES quadros depois, esperamos por
+// ela (em geral já sinalizada). Assim a escrita nunca disputa com a GPU:
+//
+//   - com OpenGL 4.4 ou GL_ARB_buffer_storage, o buffer fica mapeado
+//     permanentemente (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT) e a
+//     escrita é um memcpy;
+//   - no OpenGL 3.3, cada envio mapeia só o seu intervalo com
+//     GL_MAP_UNSYNCHRONIZED_BIT, sem que o driver espere nem realoque.
+//
+// O buffer nunca é realocado: como os VAOs que o usam podem ser configurados
+// uma única vez, cada envio é alinhado ao tamanho do vértice e desenhado a
+// partir de "first" = deslocamento / tamanho do vértice.
+
+#define TRANSIENT_RING_FRAMES  3
+#define TRANSIENT_FRAME_BYTES  (512 * 1024)
+
+// Cria o buffer. Deve ser chamada com o contexto OpenGL atual, depois de
+// GLExtensions_Init().
+void TransientBuffer_Init();
+void TransientBuffer_Destroy();
+
+// Buffer a ser ligado como GL_ARRAY_BUFFER ao configurar os VAOs dos usuários
+GLuint TransientBuffer_Buffer();
+
+// Início do quadro: passa para o próximo trecho do anel, esperando a cerca
+// do quadro que o usou por último
+void TransientBuffer_BeginFrame();
+
+// Fim do quadro: cerca após os desenhos que leem o trecho atual
+void TransientBuffer_EndFrame();
+
+// Copia "size" bytes para o trecho do quadro atual, em um deslocamento
+// múltiplo de "stride", e retorna em "*first" o índice do primeiro vértice
+// (deslocamento / stride). Retorna false (e nada é enviado) se o trecho
+// estiver cheio.
+bool TransientBuffer_Upload(const void* data, size_t size, size_t stride, GLint* first);
+
+#endif // TRANSIENT_BUFFER_H
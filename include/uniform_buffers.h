@@ -0,0 +1,74 @@
+#ifndef UNIFORM_BUFFERS_H
+#define UNIFORM_BUFFERS_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// Uniform buffer objects (UBOs) compartilhados pelos shaders da cena.
+//
+// Dois blocos std140, declarados de forma idêntica nos shaders que os usam:
+//
+//   FrameUniforms  (binding UNIFORM_BINDING_FRAME): dados do quadro (câmera),
+//                  enviados uma vez por quadro e lidos por "shader_vertex.glsl",
+//                  "shader_fragment.glsl" e pelos shaders do skybox.
+//   ObjectUniforms (binding UNIFORM_BINDING_OBJECT): dados de um desenho.
+//                  Os de todos os desenhos do quadro vão para um anel de
+//                  UNIFORM_RING_FRAMES trechos com um único glBufferSubData();
+//                  cada desenho seleciona o seu com glBindBufferRange() (veja
+//                  RenderState_BindBufferRange() em render_queue.h).
+//
+// O anel evita escrever na região que a GPU ainda pode estar lendo do quadro
+// anterior. O OpenGL 3.3 não aceita "layout(binding = N)" em GLSL, então os
+// blocos são ligados aos bindings por UniformBuffers_BindBlocks() depois de
+// cada link (ou carga do cache de programas).
+
+#define UNIFORM_BINDING_FRAME  0
+#define UNIFORM_BINDING_OBJECT 1
+#define UNIFORM_RING_FRAMES    3
+
+// Layout std140 de "FrameUniforms"
+struct FrameUniforms
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 camera_position; // inverse(view) * (0,0,0,1), calculada uma vez por quadro
+};
+
+// Layout std140 de "ObjectUniforms"
+struct ObjectUniforms
+{
+    glm::mat4 model;
+    glm::mat4 normal_matrix; // inverse(transpose(model)), para as normais
+    glm::vec4 bbox_min;
+    glm::vec4 bbox_max;
+    glm::vec4 material_kd; // w = 1: usar a cor por vértice (atributo 3)
+};
+
+// Cria os buffers. Deve ser chamada com o contexto OpenGL atual.
+void UniformBuffers_Init();
+void UniformBuffers_Destroy();
+
+// Liga os blocos "FrameUniforms" e "ObjectUniforms" de "program_id" (os que
+// existirem) aos seus bindings
+void UniformBuffers_BindBlocks(GLuint program_id);
+
+// Envia os dados do quadro e avança o anel de ObjectUniforms
+void UniformBuffers_SetFrame(const FrameUniforms& frame);
+
+// Reserva "count" entradas do trecho do quadro atual e retorna a primeira.
+// As entradas ficam em memória da CPU até UniformBuffers_UploadObjects(),
+// que envia as "count" primeiras (no máximo as reservadas).
+ObjectUniforms* UniformBuffers_BeginObjects(size_t count);
+void UniformBuffers_UploadObjects(size_t count);
+
+// Trecho do buffer com a entrada "index" (de UniformBuffers_BeginObjects()),
+// para glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_OBJECT, ...)
+void UniformBuffers_ObjectRange(size_t index, GLuint* buffer, GLintptr* offset, GLsizeiptr* size);
+
+// Envia e seleciona os dados de um desenho avulso (fora do anel)
+void UniformBuffers_SetImmediateObject(const ObjectUniforms& object);
+
+#endif // UNIFORM_BUFFERS_H
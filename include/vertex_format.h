@@ -0,0 +1,72 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+// Formato compacto e intercalado de vértices usado por todas as malhas da cena
+// (e pela linha de pesca). Decodificado em "shader_vertex.glsl".
+//
+//   offset 0: posição   3 x GL_UNSIGNED_SHORT normalizado, quantizada contra a
+//                       bounding box do objeto (uniforms bbox_min/bbox_max)
+//   offset 6: normal    2 x GL_BYTE, codificação octaédrica em [-127, 127]
+//   offset 8: textura   2 x GL_HALF_FLOAT (somente se a malha tiver UVs)
+//   em seguida: cor     3 x GL_HALF_FLOAT + 2 bytes de preenchimento (somente
+//                       se algum objeto da malha usar mais de um material)
+//
+// São 12 bytes por vértice (8 sem coordenadas de textura), contra 40 (32) bytes
+// dos antigos streams vec4/vec4/vec2 em float. A cor difusa (Kd do .mtl) por
+// vértice acrescenta 8 bytes; sem ela o atributo "location = 3" fica
+// desabilitado e o shader usa a cor do objeto do bloco "ObjectUniforms".
+
+#define VERTEX_FORMAT_NORMALS   1 // Atributo "location = 1" presente
+#define VERTEX_FORMAT_TEXCOORDS 2 // Atributo "location = 2" presente
+#define VERTEX_FORMAT_COLORS    4 // Atributo "location = 3" presente
+
+// Atributo de vértice com a cor difusa do material (veja acima)
+#define VERTEX_FORMAT_COLOR_LOCATION 3
+
+// Primeiro dos três atributos (locations 4, 5 e 6) com as linhas da matriz
+// afim 3x4 de cada instância. Vêm de um buffer separado, com divisor 1; fora
+// de desenhos instanciados valem a identidade (VertexFormat_ResetInstanceAttributes()).
+#define VERTEX_FORMAT_INSTANCE_LOCATION 4
+
+struct PackedVertex
+{
+    GLushort position[3];
+    GLbyte   normal[2];
+    GLushort texcoord[2]; // Meio-float (IEEE 754 binary16)
+};
+
+// Bytes por vértice para a combinação de atributos "flags"
+size_t VertexFormat_Stride(unsigned int flags);
+
+// Posição da cor dentro de um vértice (logo após o PackedVertex, truncado ou não)
+size_t VertexFormat_ColorOffset(unsigned int flags);
+
+// Codificação dos atributos (CPU)
+void     VertexFormat_EncodePosition(const glm::vec3& position, const glm::vec3& bbox_min, const glm::vec3& bbox_max, GLushort out[3]);
+void     VertexFormat_EncodeNormal(const glm::vec3& normal, GLbyte out[2]);
+GLushort VertexFormat_EncodeHalf(float value);
+void     VertexFormat_EncodeColor(const glm::vec3& color, GLushort out[4]);
+
+// Decodificação de referência, idêntica à do vertex shader
+glm::vec3 VertexFormat_DecodeNormal(const GLbyte encoded[2]);
+
+// Configura os atributos 0 a 3 do VAO atual a partir do GL_ARRAY_BUFFER
+// atualmente ligado, que deve conter vértices neste formato.
+void VertexFormat_SetupAttributes(unsigned int flags);
+
+// Configura os atributos de instância do VAO atual a partir do GL_ARRAY_BUFFER
+// atualmente ligado (12 floats por instância), começando na instância
+// "first_instance". Sem glDrawElementsInstancedBaseInstance() no OpenGL 3.3,
+// cada objeto instanciado tem seu próprio VAO com o deslocamento embutido.
+void VertexFormat_SetupInstanceAttributes(size_t first_instance);
+
+// Valor corrente dos atributos de instância para VAOs que não os habilitam
+void VertexFormat_ResetInstanceAttributes();
+
+#endif // VERTEX_FORMAT_H
@@ -0,0 +1,43 @@
+#ifndef WATER_H
+#define WATER_H
+
+#include <cstddef>
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+// Superfície da água procedural.
+//
+// Não há malha: a água é uma grade de WATER_GRID_CELLS x WATER_GRID_CELLS
+// quadriláteros centrada na câmera, gerada no shader de vértice a partir de
+// gl_VertexID (glDrawArrays() com um VAO vazio). As linhas da grade ficam mais
+// próximas perto do centro e se afastam em direção à borda, então o detalhe
+// acompanha a distância até a câmera. Os vértices fora da área do lago são
+// presos à borda dela.
+//
+// A altura é uma soma de WATER_WAVES ondas senoidais, avaliada na GPU (variante
+// "water" do programa principal, PROCEDURAL_WATER_GRID em "shader_vertex.glsl")
+// e na CPU por Water_Heights(), com os mesmos parâmetros: o barco e a isca
+// acompanham exatamente a superfície desenhada.
+
+#define WATER_WAVES      4     // Uma onda por componente de um vec4 / __m128
+#define WATER_GRID_CELLS 128   // Quadriláteros por lado da grade
+#define WATER_GRID_RADIUS 64.0f  // Meio lado da grade, no mundo
+
+// Cria o VAO vazio da grade. "bounds_min"/"bounds_max" delimitam (em XZ, no
+// mundo) a área coberta pela água.
+void Water_Init(const glm::vec2& bounds_min, const glm::vec2& bounds_max);
+void Water_Destroy();
+
+// Altura da superfície (y no mundo) em (x[i], z[i]) no instante "time" (em
+// segundos, double; só a fase de cada onda, já reduzida, passa a float), para
+// i < count. Calculada com SSE quatro pontos por vez quando disponível.
+void Water_Heights(const float* x, const float* z, size_t count, double time, float* heights);
+float Water_Height(float x, float z, double time);
+
+// Desenha a superfície com o programa "program_id" (variante "water"), com
+// blending, centrada em "camera_position"
+void Water_Render(GLuint program_id, const glm::vec3& camera_position, double time);
+
+#endif // WATER_H
@@ -0,0 +1,239 @@
+// asset_loader.cpp - Carregamento de recursos em paralelo
+//
+// Um pool de threads executa a parte de CPU de cada recurso. Ao terminar, o
+// recurso é marcado como pronto e a thread do OpenGL, em AssetLoader_Finish(),
+// faz os uploads (VAOs, buffers e texturas) na ordem de submissão. Assim o tempo de
+// inicialização fica limitado pelo recurso mais lento, e não pela soma de
+// todos eles.
+
+#include "asset_loader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <condition_variable>
+
+#include <stb_image.h>
+
+struct AssetJob
+{
+    std::string           name;
+    std::function<void()> work;
+    std::function<void()> upload;
+    std::exception_ptr    error;
+    bool                  done;       // "work" terminou (protegido por g_Mutex)
+    double                work_ms;
+    double                upload_ms;
+};
+
+static std::vector<std::thread>  g_Workers;
+static std::vector<AssetJob*>    g_Jobs;      // Todos os recursos submetidos, em ordem
+static std::deque<AssetJob*>     g_Pending;   // Aguardando uma thread do pool
+static std::mutex                g_Mutex;
+static std::condition_variable   g_PendingCondition;
+static std::condition_variable   g_CompletedCondition;
+static bool                      g_Running = false;
+static bool                      g_Stopping = false;
+static std::chrono::steady_clock::time_point g_StartTime;
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void WorkerLoop()
+{
+    for (;;)
+    {
+        AssetJob* job;
+        {
+            std::unique_lock<std::mutex> lock(g_Mutex);
+            g_PendingCondition.wait(lock, [] { return g_Stopping || !g_Pending.empty(); });
+            if (g_Pending.empty())
+                return;
+            job = g_Pending.front();
+            g_Pending.pop_front();
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        try {
+            if (job->work)
+                job->work();
+        } catch (...) {
+            job->error = std::current_exception();
+        }
+        job->work_ms = MillisecondsSince(start);
+
+        {
+            std::lock_guard<std::mutex> lock(g_Mutex);
+            job->done = true;
+        }
+        g_CompletedCondition.notify_all();
+    }
+}
+
+static void StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_Mutex);
+        g_Stopping = true;
+    }
+    g_PendingCondition.notify_all();
+
+    for (size_t i = 0; i < g_Workers.size(); ++i)
+        g_Workers[i].join();
+
+    g_Workers.clear();
+    g_Running = false;
+}
+
+static void ClearJobs()
+{
+    for (size_t i = 0; i < g_Jobs.size(); ++i)
+        delete g_Jobs[i];
+    g_Jobs.clear();
+    g_Pending.clear();
+}
+
+bool DecodeImageFile(const char* filename, bool flip_vertically, int desired_channels, DecodedImage* image)
+{
+    // Nunca usamos stbi_set_flip_vertically_on_load() aqui: ele é um estado
+    // global da stb_image e as threads do pool decodificam em paralelo.
+    image->data = stbi_load(filename, &image->width, &image->height, &image->channels, desired_channels);
+    if (image->data == NULL)
+        return false;
+
+    if (desired_channels != 0)
+        image->channels = desired_channels;
+
+    if (flip_vertically)
+    {
+        size_t row_size = (size_t)image->width * image->channels;
+        std::vector<unsigned char> row(row_size);
+        for (int y = 0; y < image->height / 2; ++y)
+        {
+            unsigned char* top    = image->data + (size_t)y * row_size;
+            unsigned char* bottom = image->data + (size_t)(image->height - 1 - y) * row_size;
+            memcpy(row.data(), top, row_size);
+            memcpy(top, bottom, row_size);
+            memcpy(bottom, row.data(), row_size);
+        }
+    }
+
+    return true;
+}
+
+void FreeDecodedImage(DecodedImage* image)
+{
+    if (image->data != NULL)
+        stbi_image_free(image->data);
+    image->data = NULL;
+}
+
+void AssetLoader_Start(unsigned int num_threads)
+{
+    if (g_Running)
+        return;
+
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+        num_threads = 2;
+
+    stbi_set_flip_vertically_on_load(false);
+
+    g_Stopping = false;
+    g_Running = true;
+    g_StartTime = std::chrono::steady_clock::now();
+
+    for (unsigned int i = 0; i < num_threads; ++i)
+        g_Workers.push_back(std::thread(WorkerLoop));
+}
+
+void AssetLoader_Submit(const char* name, std::function<void()> work, std::function<void()> upload)
+{
+    // Fora de Start()/Finish(): execução síncrona na thread atual
+    if (!g_Running)
+    {
+        if (work)
+            work();
+        if (upload)
+            upload();
+        return;
+    }
+
+    AssetJob* job = new AssetJob;
+    job->name      = name;
+    job->work      = work;
+    job->upload    = upload;
+    job->work_ms   = 0.0;
+    job->upload_ms = 0.0;
+    job->done      = false;
+
+    {
+        std::lock_guard<std::mutex> lock(g_Mutex);
+        g_Jobs.push_back(job);
+        g_Pending.push_back(job);
+    }
+    g_PendingCondition.notify_one();
+}
+
+void AssetLoader_Finish()
+{
+    if (!g_Running)
+        return;
+
+    size_t num_jobs;
+    {
+        std::lock_guard<std::mutex> lock(g_Mutex);
+        num_jobs = g_Jobs.size();
+    }
+
+    // Uploads na ordem de submissão: o resultado (nomes em g_VirtualScene,
+    // unidades de textura) não depende de qual thread termina primeiro.
+    for (size_t i = 0; i < num_jobs; ++i)
+    {
+        AssetJob* job = g_Jobs[i];
+        {
+            std::unique_lock<std::mutex> lock(g_Mutex);
+            g_CompletedCondition.wait(lock, [job] { return job->done; });
+        }
+
+        if (job->error)
+        {
+            fprintf(stderr, "ERROR: Falha ao carregar \"%s\".\n", job->name.c_str());
+            std::exception_ptr error = job->error;
+            StopWorkers();
+            ClearJobs();
+            std::rethrow_exception(error);
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (job->upload)
+            job->upload();
+        job->upload_ms = MillisecondsSince(start);
+    }
+
+    unsigned int num_threads = (unsigned int)g_Workers.size();
+    StopWorkers();
+
+    double total_ms = MillisecondsSince(g_StartTime);
+    double sum_ms = 0.0;
+
+    printf("Tempo de carregamento dos recursos (%u threads):\n", num_threads);
+    for (size_t i = 0; i < g_Jobs.size(); ++i)
+    {
+        const AssetJob* job = g_Jobs[i];
+        printf("  %-32s CPU %8.1f ms   GPU %6.1f ms\n", job->name.c_str(), job->work_ms, job->upload_ms);
+        sum_ms += job->work_ms + job->upload_ms;
+    }
+    printf("  Total: %.1f ms (soma dos recursos: %.1f ms)\n", total_ms, sum_ms);
+
+    ClearJobs();
+}
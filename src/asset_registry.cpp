@@ -0,0 +1,209 @@
+// asset_registry.cpp - Registro de modelos e texturas com contagem de referências
+//
+// Veja asset_registry.h. As tabelas são vetores de entradas; entradas
+// liberadas vão para uma lista de livres e são reutilizadas com a geração
+// incrementada.
+
+#include "asset_registry.h"
+
+#include <cstdio>
+#include <map>
+
+// Handle = (geração << 16) | (índice + 1)
+static const unsigned int HANDLE_INDEX_BITS = 16;
+static const unsigned int HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+
+template <typename Asset>
+struct AssetTable
+{
+    std::vector<Asset>                  assets;
+    std::vector<unsigned int>           generations;
+    std::vector<unsigned int>           free_slots;
+    std::map<std::string, unsigned int> by_path;   // Caminho -> índice
+    unsigned int                        requests;  // Total de pedidos
+    unsigned int                        cache_hits; // Pedidos de recursos já carregados
+
+    AssetTable() : requests(0), cache_hits(0) {}
+};
+
+static AssetTable<ModelAsset>   g_Models;
+static AssetTable<TextureAsset> g_Textures;
+static std::vector<bool>        g_TextureUnitsInUse;
+
+static AssetHandle MakeHandle(unsigned int index, unsigned int generation)
+{
+    return (generation << HANDLE_INDEX_BITS) | (index + 1);
+}
+
+template <typename Asset>
+static Asset* Lookup(AssetTable<Asset>& table, AssetHandle handle)
+{
+    unsigned int slot = handle & HANDLE_INDEX_MASK;
+    if (slot == 0 || slot > table.assets.size())
+        return NULL;
+
+    unsigned int index = slot - 1;
+    if ((handle >> HANDLE_INDEX_BITS) != (table.generations[index] & 0xFFFFu) || table.assets[index].refcount <= 0)
+        return NULL;
+
+    return &table.assets[index];
+}
+
+template <typename Asset>
+static AssetHandle Acquire(AssetTable<Asset>& table, const char* path, bool* is_new)
+{
+    table.requests += 1;
+
+    std::map<std::string, unsigned int>::iterator found = table.by_path.find(path);
+    if (found != table.by_path.end())
+    {
+        unsigned int index = found->second;
+        table.assets[index].refcount += 1;
+        table.cache_hits += 1;
+        *is_new = false;
+        return MakeHandle(index, table.generations[index] & 0xFFFFu);
+    }
+
+    unsigned int index;
+    if (!table.free_slots.empty())
+    {
+        index = table.free_slots.back();
+        table.free_slots.pop_back();
+        table.assets[index] = Asset();
+    }
+    else
+    {
+        index = (unsigned int)table.assets.size();
+        table.assets.push_back(Asset());
+        table.generations.push_back(0);
+    }
+
+    Asset& asset = table.assets[index];
+    asset.path     = path;
+    asset.refcount = 1;
+    asset.loaded   = false;
+    table.by_path[asset.path] = index;
+
+    *is_new = true;
+    return MakeHandle(index, table.generations[index] & 0xFFFFu);
+}
+
+// Decrementa as referências; retorna true (e remove a entrada das tabelas) ao chegar em zero
+template <typename Asset>
+static bool Release(AssetTable<Asset>& table, AssetHandle handle, Asset* released)
+{
+    Asset* asset = Lookup(table, handle);
+    if (asset == NULL)
+        return false;
+
+    asset->refcount -= 1;
+    if (asset->refcount > 0)
+        return false;
+
+    unsigned int index = (handle & HANDLE_INDEX_MASK) - 1;
+    *released = *asset;
+    table.by_path.erase(asset->path);
+    table.assets[index] = Asset();
+    table.assets[index].refcount = 0;
+    table.generations[index] += 1;
+    table.free_slots.push_back(index);
+    return true;
+}
+
+static void DestroyModel(const ModelAsset& model)
+{
+    if (!model.vertex_arrays.empty())
+        glDeleteVertexArrays((GLsizei)model.vertex_arrays.size(), model.vertex_arrays.data());
+    if (!model.buffers.empty())
+        glDeleteBuffers((GLsizei)model.buffers.size(), model.buffers.data());
+}
+
+static void DestroyTexture(const TextureAsset& texture)
+{
+    if (texture.texture_id != 0)
+        glDeleteTextures(1, &texture.texture_id);
+    if (texture.sampler_id != 0)
+        glDeleteSamplers(1, &texture.sampler_id);
+    if (texture.texture_unit < g_TextureUnitsInUse.size())
+        g_TextureUnitsInUse[texture.texture_unit] = false;
+}
+
+ModelHandle AssetRegistry_AcquireModel(const char* path, bool* is_new)
+{
+    return Acquire(g_Models, path, is_new);
+}
+
+TextureHandle AssetRegistry_AcquireTexture(const char* path, bool* is_new)
+{
+    TextureHandle handle = Acquire(g_Textures, path, is_new);
+    if (*is_new)
+    {
+        // Menor unidade de textura livre. Os samplers do shader principal
+        // (BoatTexture = 0, FishTexture = 1, ...) dependem da ordem de carga.
+        GLuint unit = 0;
+        while (unit < g_TextureUnitsInUse.size() && g_TextureUnitsInUse[unit])
+            unit += 1;
+        if (unit == g_TextureUnitsInUse.size())
+            g_TextureUnitsInUse.push_back(false);
+        g_TextureUnitsInUse[unit] = true;
+
+        TextureAsset* texture = Lookup(g_Textures, handle);
+        texture->texture_id   = 0;
+        texture->sampler_id   = 0;
+        texture->texture_unit = unit;
+    }
+    return handle;
+}
+
+ModelAsset* AssetRegistry_GetModel(ModelHandle handle)
+{
+    return Lookup(g_Models, handle);
+}
+
+TextureAsset* AssetRegistry_GetTexture(TextureHandle handle)
+{
+    return Lookup(g_Textures, handle);
+}
+
+bool AssetRegistry_ReleaseModel(ModelHandle handle, ModelAsset* released)
+{
+    ModelAsset model;
+    if (!Release(g_Models, handle, &model))
+        return false;
+
+    DestroyModel(model);
+    if (released != NULL)
+        *released = model;
+    return true;
+}
+
+bool AssetRegistry_ReleaseTexture(TextureHandle handle)
+{
+    TextureAsset texture;
+    if (!Release(g_Textures, handle, &texture))
+        return false;
+
+    DestroyTexture(texture);
+    return true;
+}
+
+void AssetRegistry_ReleaseAll()
+{
+    for (size_t i = 0; i < g_Models.assets.size(); ++i)
+        if (g_Models.assets[i].refcount > 0)
+            DestroyModel(g_Models.assets[i]);
+    for (size_t i = 0; i < g_Textures.assets.size(); ++i)
+        if (g_Textures.assets[i].refcount > 0)
+            DestroyTexture(g_Textures.assets[i]);
+
+    g_Models   = AssetTable<ModelAsset>();
+    g_Textures = AssetTable<TextureAsset>();
+    g_TextureUnitsInUse.clear();
+}
+
+void AssetRegistry_PrintStats()
+{
+    printf("Registro de recursos: %d modelos, %d texturas carregados; %u de %u pedidos atendidos pelo cache.\n",
+        (int)g_Models.by_path.size(), (int)g_Textures.by_path.size(),
+        g_Models.cache_hits + g_Textures.cache_hits, g_Models.requests + g_Textures.requests);
+}
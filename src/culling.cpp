@@ -0,0 +1,216 @@
+// culling.cpp - Culling por frustum e BVH de objetos estáticos
+//
+// Veja culling.h. Os planos são extraídos da matriz projection*view pelo
+// método de Gribb e Hartmann; a caixa transformada usa o método de Arvo
+// (centro transformado e meia-extensão pelos valores absolutos da matriz).
+
+#include "culling.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+CullingStats g_CullingStats;
+CullingStats g_CullingStatsLast;
+
+Frustum Culling_ExtractFrustum(const glm::mat4& m)
+{
+    // Linhas da matriz (glm guarda colunas: m[coluna][linha])
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i)
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    Frustum frustum;
+    frustum.planes[0] = row[3] + row[0];
+    frustum.planes[1] = row[3] - row[0];
+    frustum.planes[2] = row[3] + row[1];
+    frustum.planes[3] = row[3] - row[1];
+    frustum.planes[4] = row[3] + row[2];
+    frustum.planes[5] = row[3] - row[2];
+
+    // Normalizamos para que dot(plane.xyz, p) + plane.w seja uma distância
+    for (int i = 0; i < 6; ++i)
+    {
+        float length = glm::length(glm::vec3(frustum.planes[i]));
+        if (length > 0.0f)
+            frustum.planes[i] /= length;
+    }
+    return frustum;
+}
+
+void Culling_TransformBox(const glm::mat4& model, const glm::vec3& bbox_min, const glm::vec3& bbox_max,
+                          glm::vec3* world_min, glm::vec3* world_max)
+{
+    glm::vec3 center = 0.5f * (bbox_min + bbox_max);
+    glm::vec3 extent = 0.5f * (bbox_max - bbox_min);
+
+    glm::vec3 world_center = glm::vec3(model * glm::vec4(center, 1.0f));
+    glm::vec3 world_extent;
+    for (int i = 0; i < 3; ++i)
+        world_extent[i] = std::fabs(model[0][i]) * extent.x
+                        + std::fabs(model[1][i]) * extent.y
+                        + std::fabs(model[2][i]) * extent.z;
+
+    *world_min = world_center - world_extent;
+    *world_max = world_center + world_extent;
+}
+
+int Culling_TestBox(const Frustum& frustum, const glm::vec3& box_min, const glm::vec3& box_max, unsigned int* plane_mask)
+{
+    g_CullingStats.tests += 1;
+
+    glm::vec3 center = 0.5f * (box_min + box_max);
+    glm::vec3 extent = 0.5f * (box_max - box_min);
+
+    int result = CULL_INSIDE;
+    for (int i = 0; i < 6; ++i)
+    {
+        unsigned int bit = 1u << i;
+        if (!(*plane_mask & bit))
+            continue;
+
+        const glm::vec4& plane = frustum.planes[i];
+        glm::vec3 normal = glm::vec3(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float radius = glm::dot(extent, glm::abs(normal));
+
+        if (distance + radius < 0.0f)
+            return CULL_OUTSIDE;
+        if (distance - radius >= 0.0f)
+            *plane_mask &= ~bit;   // Filhos não precisam testar este plano
+        else
+            result = CULL_INTERSECT;
+    }
+    return result;
+}
+
+struct BuildContext
+{
+    CullingBvh*                   bvh;
+    const std::vector<glm::vec3>* box_min;
+    const std::vector<glm::vec3>* box_max;
+    std::vector<glm::vec3>        centers;
+};
+
+struct CompareCenters
+{
+    const std::vector<glm::vec3>* centers;
+    int axis;
+    bool operator()(int a, int b) const
+    {
+        return (*centers)[a][axis] < (*centers)[b][axis];
+    }
+};
+
+// Preenche o nó "node" com os itens [first, first + count) de bvh->items,
+// dividindo-os pela mediana dos centros no maior eixo
+static void BuildNode(BuildContext* context, int node, int first, int count)
+{
+    CullingBvh* bvh = context->bvh;
+    std::vector<int>& items = bvh->items;
+
+    glm::vec3 bbox_min = (*context->box_min)[items[first]];
+    glm::vec3 bbox_max = (*context->box_max)[items[first]];
+    glm::vec3 center_min = context->centers[items[first]];
+    glm::vec3 center_max = center_min;
+    for (int i = first + 1; i < first + count; ++i)
+    {
+        bbox_min = glm::min(bbox_min, (*context->box_min)[items[i]]);
+        bbox_max = glm::max(bbox_max, (*context->box_max)[items[i]]);
+        center_min = glm::min(center_min, context->centers[items[i]]);
+        center_max = glm::max(center_max, context->centers[items[i]]);
+    }
+
+    bvh->nodes[node].bbox_min    = bbox_min;
+    bvh->nodes[node].bbox_max    = bbox_max;
+    bvh->nodes[node].first_item  = first;
+    bvh->nodes[node].num_items   = count;
+    bvh->nodes[node].first_child = -1;
+    if (count == 1)
+        return;   // Folha: a caixa do nó é a do item
+
+    glm::vec3 spread = center_max - center_min;
+    CompareCenters compare;
+    compare.centers = &context->centers;
+    compare.axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+    int half = count / 2;
+    std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count, compare);
+
+    // "nodes" pode ser realocado: não guardamos referências para nós
+    int child = (int)bvh->nodes.size();
+    bvh->nodes.resize(bvh->nodes.size() + 2);
+    bvh->nodes[node].first_child = child;
+    BuildNode(context, child,     first,        half);
+    BuildNode(context, child + 1, first + half, count - half);
+}
+
+void CullingBvh_Build(CullingBvh* bvh, const std::vector<glm::vec3>& box_min, const std::vector<glm::vec3>& box_max)
+{
+    bvh->nodes.clear();
+    bvh->items.resize(box_min.size());
+    if (box_min.empty())
+        return;
+
+    BuildContext context;
+    context.bvh = bvh;
+    context.box_min = &box_min;
+    context.box_max = &box_max;
+    context.centers.resize(box_min.size());
+    for (size_t i = 0; i < box_min.size(); ++i)
+    {
+        bvh->items[i] = (int)i;
+        context.centers[i] = 0.5f * (box_min[i] + box_max[i]);
+    }
+
+    bvh->nodes.reserve(2 * box_min.size());
+    bvh->nodes.resize(1);
+    BuildNode(&context, 0, 0, (int)box_min.size());
+}
+
+static void AcceptAll(const CullingBvh& bvh, const CullingBvhNode& node, std::vector<int>* visible)
+{
+    visible->insert(visible->end(), bvh.items.begin() + node.first_item, bvh.items.begin() + node.first_item + node.num_items);
+    g_CullingStats.visible += node.num_items;
+}
+
+static void QueryNode(const CullingBvh& bvh, const Frustum& frustum, int index, unsigned int plane_mask, std::vector<int>* visible)
+{
+    const CullingBvhNode& node = bvh.nodes[index];
+
+    int result = Culling_TestBox(frustum, node.bbox_min, node.bbox_max, &plane_mask);
+    if (result == CULL_OUTSIDE)
+    {
+        g_CullingStats.culled += node.num_items;
+        return;
+    }
+    if (result == CULL_INSIDE)
+    {
+        AcceptAll(bvh, node, visible);
+        return;
+    }
+
+    if (node.first_child < 0)
+    {
+        AcceptAll(bvh, node, visible);   // Folha na borda do frustum
+        return;
+    }
+
+    QueryNode(bvh, frustum, node.first_child,     plane_mask, visible);
+    QueryNode(bvh, frustum, node.first_child + 1, plane_mask, visible);
+}
+
+void CullingBvh_Query(const CullingBvh& bvh, const Frustum& frustum, std::vector<int>* visible)
+{
+    if (bvh.nodes.empty())
+        return;
+    QueryNode(bvh, frustum, 0, CULL_ALL_PLANES, visible);
+}
+
+void CullingStats_EndFrame()
+{
+    g_CullingStatsLast = g_CullingStats;
+    memset(&g_CullingStats, 0, sizeof(g_CullingStats));
+}
@@ -0,0 +1,543 @@
+// frame_timing.cpp - Tempo de CPU e de GPU das etapas do quadro
+//
+// Veja frame_timing.h. Cada quadro tem um registro no histórico (indexado por
+// quadro % TIMING_HISTORY_FRAMES) e um trecho no anel de consultas (quadro %
+// TIMING_QUERY_FRAMES). O registro é "fechado" no início do quadro seguinte,
+// quando o intervalo entre quadros é conhecido, e "resolvido" quando as
+// consultas de GPU do trecho são lidas ou descartadas; só então vai para o CSV.
+
+#include "frame_timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "shader_program.h"
+#include "transient_buffer.h"
+
+typedef std::chrono::steady_clock TimingClock;
+
+static const char* const PASS_NAMES[NUM_TIMING_PASSES] = {
+    "physics", "skybox", "opaque", "water", "hud", "swap"
+};
+
+// Etapas que enviam comandos ao OpenGL e por isso são medidas na GPU
+static const bool PASS_GPU[NUM_TIMING_PASSES] = {
+    false, true, true, true, true, false
+};
+
+// Cor de cada etapa no gráfico (RGB)
+static const GLubyte PASS_COLORS[NUM_TIMING_PASSES][3] = {
+    { 230, 150,  50 },   // physics
+    { 130, 180, 255 },   // skybox
+    {  80, 200,  80 },   // opaque
+    {  40, 110, 230 },   // water
+    { 230, 230,  80 },   // hud
+    { 200,  80, 200 },   // swap
+};
+
+struct TimingRecord
+{
+    unsigned int frame;
+    bool   closed;         // frame_ms conhecido
+    bool   gpu_resolved;   // consultas lidas ou descartadas
+    double frame_ms;
+    double gpu_frame_ms;   // Do primeiro início ao último fim na GPU
+    double cpu_ms[NUM_TIMING_PASSES];
+    double gpu_ms[NUM_TIMING_PASSES];
+};
+
+struct TimingQuerySlot
+{
+    unsigned int frame;
+    bool   pending;
+    bool   issued[NUM_TIMING_PASSES];
+    GLuint queries[NUM_TIMING_PASSES][2];   // Início e fim de cada etapa
+};
+
+struct GraphVertex
+{
+    float   x, y;
+    GLubyte color[4];
+};
+
+struct FrameTimingState
+{
+    bool initialized;
+
+    unsigned int           frame;   // 0 antes do primeiro FrameTiming_BeginFrame()
+    TimingClock::time_point frame_start;
+    TimingClock::time_point pass_start[NUM_TIMING_PASSES];
+    bool                    pass_gpu_open[NUM_TIMING_PASSES];
+
+    TimingRecord    history[TIMING_HISTORY_FRAMES];
+    TimingQuerySlot slots[TIMING_QUERY_FRAMES];
+
+    FILE*        csv;
+    unsigned int csv_next_frame;
+
+    GLuint program;
+    GLuint vertex_array;
+    std::vector<GraphVertex> vertices;
+};
+
+static FrameTimingState g_FrameTiming;
+
+static const GLchar* const GRAPH_VERTEX_SHADER = ""
+"#version 330\n"
+"layout (location = 0) in vec2 position;\n"
+"layout (location = 1) in vec4 color;\n"
+"out vec4 vertex_color;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(position, 0.0, 1.0);\n"
+"    vertex_color = color;\n"
+"}\n";
+
+static const GLchar* const GRAPH_FRAGMENT_SHADER = ""
+"#version 330\n"
+"in vec4 vertex_color;\n"
+"out vec4 color;\n"
+"void main()\n"
+"{\n"
+"    color = vertex_color;\n"
+"}\n";
+
+static TimingRecord& Record(unsigned int frame)
+{
+    return g_FrameTiming.history[frame % TIMING_HISTORY_FRAMES];
+}
+
+static double Milliseconds(TimingClock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void FrameTiming_Init()
+{
+    g_FrameTiming.frame = 0;
+    g_FrameTiming.csv = NULL;
+    for (int i = 0; i < TIMING_HISTORY_FRAMES; ++i)
+        memset(&g_FrameTiming.history[i], 0, sizeof(TimingRecord));
+
+    for (int i = 0; i < TIMING_QUERY_FRAMES; ++i)
+    {
+        TimingQuerySlot& slot = g_FrameTiming.slots[i];
+        memset(&slot, 0, sizeof(slot));
+        glGenQueries(2 * NUM_TIMING_PASSES, &slot.queries[0][0]);
+    }
+
+    g_FrameTiming.program = ShaderProgram_Create("shader_timing_graph",
+        "frame timing (vertex)", GRAPH_VERTEX_SHADER, "frame timing (fragment)", GRAPH_FRAGMENT_SHADER);
+
+    // O VAO aponta para o buffer transitório, que nunca é realocado
+    glGenVertexArrays(1, &g_FrameTiming.vertex_array);
+    glBindVertexArray(g_FrameTiming.vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, TransientBuffer_Buffer());
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GraphVertex), (const void*)offsetof(GraphVertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GraphVertex), (const void*)offsetof(GraphVertex, color));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    g_FrameTiming.initialized = true;
+}
+
+void FrameTiming_Destroy()
+{
+    if (!g_FrameTiming.initialized)
+        return;
+
+    FrameTiming_StopCsv();
+
+    for (int i = 0; i < TIMING_QUERY_FRAMES; ++i)
+        glDeleteQueries(2 * NUM_TIMING_PASSES, &g_FrameTiming.slots[i].queries[0][0]);
+    glDeleteVertexArrays(1, &g_FrameTiming.vertex_array);
+    glDeleteProgram(g_FrameTiming.program);
+
+    g_FrameTiming.vertex_array = 0;
+    g_FrameTiming.program = 0;
+    g_FrameTiming.initialized = false;
+}
+
+// Lê as consultas de um trecho. Sem "wait", não faz nada se alguma ainda não
+// estiver disponível.
+static bool ResolveSlot(TimingQuerySlot& slot, bool wait)
+{
+    if (!slot.pending)
+        return true;
+
+    if (!wait)
+    {
+        for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        {
+            if (!slot.issued[p])
+                continue;
+
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(slot.queries[p][1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return false;
+        }
+    }
+
+    TimingRecord& record = Record(slot.frame);
+    bool current = ( record.frame == slot.frame );
+
+    GLuint64 first_begin = 0, last_end = 0;
+    for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+    {
+        if (!slot.issued[p])
+            continue;
+
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(slot.queries[p][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.queries[p][1], GL_QUERY_RESULT, &end);
+        if (current)
+            record.gpu_ms[p] = (double)(end - begin) * 1e-6;
+
+        if (first_begin == 0 || begin < first_begin)
+            first_begin = begin;
+        if (end > last_end)
+            last_end = end;
+    }
+
+    if (current)
+    {
+        if (last_end > first_begin)
+            record.gpu_frame_ms = (double)(last_end - first_begin) * 1e-6;
+        record.gpu_resolved = true;
+    }
+    slot.pending = false;
+    return true;
+}
+
+// Trecho reutilizado antes de a GPU terminar: o quadro fica sem medida de GPU
+static void DropSlot(TimingQuerySlot& slot)
+{
+    if (!slot.pending)
+        return;
+
+    TimingRecord& record = Record(slot.frame);
+    if (record.frame == slot.frame)
+        record.gpu_resolved = true;
+    slot.pending = false;
+}
+
+static void WriteCsvRows()
+{
+    if (g_FrameTiming.csv == NULL)
+        return;
+
+    while (g_FrameTiming.csv_next_frame < g_FrameTiming.frame)
+    {
+        const TimingRecord& record = Record(g_FrameTiming.csv_next_frame);
+        if (record.frame != g_FrameTiming.csv_next_frame)
+        {
+            g_FrameTiming.csv_next_frame++;
+            continue;
+        }
+        if (!record.closed || !record.gpu_resolved)
+            break;
+
+        FILE* csv = g_FrameTiming.csv;
+        fprintf(csv, "%u,%.4f,", record.frame, record.frame_ms);
+        if (record.gpu_frame_ms >= 0.0)
+            fprintf(csv, "%.4f", record.gpu_frame_ms);
+        for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        {
+            fprintf(csv, ",%.4f,", record.cpu_ms[p]);
+            if (record.gpu_ms[p] >= 0.0)
+                fprintf(csv, "%.4f", record.gpu_ms[p]);
+        }
+        fprintf(csv, "\n");
+
+        g_FrameTiming.csv_next_frame++;
+    }
+}
+
+void FrameTiming_BeginFrame()
+{
+    TimingClock::time_point now = TimingClock::now();
+
+    if (g_FrameTiming.frame > 0)
+    {
+        TimingRecord& record = Record(g_FrameTiming.frame);
+        record.frame_ms = Milliseconds(now - g_FrameTiming.frame_start);
+        record.closed = true;
+    }
+
+    // Resultados que já chegaram, sem esperar pela GPU
+    if (g_FrameTiming.initialized)
+    {
+        for (int i = 0; i < TIMING_QUERY_FRAMES; ++i)
+            ResolveSlot(g_FrameTiming.slots[i], false);
+    }
+
+    g_FrameTiming.frame++;
+    g_FrameTiming.frame_start = now;
+
+    TimingRecord& record = Record(g_FrameTiming.frame);
+    memset(&record, 0, sizeof(record));
+    record.frame = g_FrameTiming.frame;
+    record.gpu_frame_ms = -1.0;
+    for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        record.gpu_ms[p] = -1.0;
+
+    TimingQuerySlot& slot = g_FrameTiming.slots[g_FrameTiming.frame % TIMING_QUERY_FRAMES];
+    DropSlot(slot);
+    slot.frame = g_FrameTiming.frame;
+    slot.pending = g_FrameTiming.initialized;
+    for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        slot.issued[p] = false;
+    if (!g_FrameTiming.initialized)
+        record.gpu_resolved = true;
+
+    WriteCsvRows();
+}
+
+void FrameTiming_BeginPass(TimingPass pass)
+{
+    g_FrameTiming.pass_start[pass] = TimingClock::now();
+
+    // Cada etapa é medida uma vez por quadro na GPU
+    TimingQuerySlot& slot = g_FrameTiming.slots[g_FrameTiming.frame % TIMING_QUERY_FRAMES];
+    if (g_FrameTiming.initialized && PASS_GPU[pass] && slot.frame == g_FrameTiming.frame && !slot.issued[pass])
+    {
+        glQueryCounter(slot.queries[pass][0], GL_TIMESTAMP);
+        g_FrameTiming.pass_gpu_open[pass] = true;
+    }
+}
+
+void FrameTiming_EndPass(TimingPass pass)
+{
+    TimingRecord& record = Record(g_FrameTiming.frame);
+    record.cpu_ms[pass] += Milliseconds(TimingClock::now() - g_FrameTiming.pass_start[pass]);
+
+    if (g_FrameTiming.pass_gpu_open[pass])
+    {
+        TimingQuerySlot& slot = g_FrameTiming.slots[g_FrameTiming.frame % TIMING_QUERY_FRAMES];
+        glQueryCounter(slot.queries[pass][1], GL_TIMESTAMP);
+        slot.issued[pass] = true;
+        g_FrameTiming.pass_gpu_open[pass] = false;
+    }
+}
+
+const char* FrameTiming_PassName(TimingPass pass)
+{
+    return PASS_NAMES[pass];
+}
+
+// Percentil pelo método do posto mais próximo; "values" é ordenado
+static double Percentile(std::vector<double>& values, double fraction)
+{
+    if (values.empty())
+        return -1.0;
+
+    size_t rank = (size_t)(fraction * values.size() + 0.999999);
+    rank = std::max((size_t)1, std::min(rank, values.size()));
+    return values[rank - 1];
+}
+
+void FrameTiming_Summarize(FrameTimingSummary* summary)
+{
+    std::vector<double> frame_ms, gpu_frame_ms;
+    frame_ms.reserve(TIMING_HISTORY_FRAMES);
+    gpu_frame_ms.reserve(TIMING_HISTORY_FRAMES);
+
+    double cpu_total[NUM_TIMING_PASSES] = { 0.0 };
+    double gpu_total[NUM_TIMING_PASSES] = { 0.0 };
+    unsigned int gpu_count[NUM_TIMING_PASSES] = { 0 };
+
+    for (int i = 0; i < TIMING_HISTORY_FRAMES; ++i)
+    {
+        const TimingRecord& record = g_FrameTiming.history[i];
+        if (record.frame == 0 || !record.closed)
+            continue;
+
+        frame_ms.push_back(record.frame_ms);
+        if (record.gpu_frame_ms >= 0.0)
+            gpu_frame_ms.push_back(record.gpu_frame_ms);
+
+        for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        {
+            cpu_total[p] += record.cpu_ms[p];
+            if (record.gpu_ms[p] >= 0.0)
+            {
+                gpu_total[p] += record.gpu_ms[p];
+                gpu_count[p] += 1;
+            }
+        }
+    }
+
+    std::sort(frame_ms.begin(), frame_ms.end());
+    std::sort(gpu_frame_ms.begin(), gpu_frame_ms.end());
+
+    summary->frames = (unsigned int)frame_ms.size();
+    summary->frame_p50 = Percentile(frame_ms, 0.50);
+    summary->frame_p95 = Percentile(frame_ms, 0.95);
+    summary->frame_p99 = Percentile(frame_ms, 0.99);
+    summary->gpu_p50 = Percentile(gpu_frame_ms, 0.50);
+    summary->gpu_p95 = Percentile(gpu_frame_ms, 0.95);
+    summary->gpu_p99 = Percentile(gpu_frame_ms, 0.99);
+
+    for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+    {
+        summary->cpu_ms[p] = frame_ms.empty() ? -1.0 : cpu_total[p] / frame_ms.size();
+        summary->gpu_ms[p] = gpu_count[p] == 0 ? -1.0 : gpu_total[p] / gpu_count[p];
+    }
+}
+
+static void AddQuad(float x0, float y0, float x1, float y1, GLubyte r, GLubyte g, GLubyte b, GLubyte a)
+{
+    GraphVertex v[4] = {
+        { x0, y0, { r, g, b, a } },
+        { x1, y0, { r, g, b, a } },
+        { x1, y1, { r, g, b, a } },
+        { x0, y1, { r, g, b, a } },
+    };
+    std::vector<GraphVertex>& vertices = g_FrameTiming.vertices;
+    vertices.push_back(v[0]); vertices.push_back(v[1]); vertices.push_back(v[2]);
+    vertices.push_back(v[0]); vertices.push_back(v[2]); vertices.push_back(v[3]);
+}
+
+void FrameTiming_DrawGraph(const FrameTimingSummary& summary, float x0, float y0, float x1, float y1)
+{
+    if (!g_FrameTiming.initialized || g_FrameTiming.frame < 2)
+        return;
+
+    // Escala vertical: pelo menos 33 ms (30 fps), e folga acima do p99 para
+    // que os picos raros fiquem visíveis sem achatar o resto do gráfico
+    double scale_ms = std::max(1000.0 / 30.0, 1.25 * summary.frame_p99);
+    float height = y1 - y0;
+    float pixel = height * 0.01f;
+
+    std::vector<GraphVertex>& vertices = g_FrameTiming.vertices;
+    vertices.clear();
+
+    AddQuad(x0, y0, x1, y1, 0, 0, 0, 128);
+
+    // Linhas de referência: 60 e 30 fps
+    const double reference_ms[2] = { 1000.0 / 60.0, 1000.0 / 30.0 };
+    for (int i = 0; i < 2; ++i)
+    {
+        float y = y0 + (float)(reference_ms[i] / scale_ms) * height;
+        AddQuad(x0, y, x1, y + pixel * 0.5f, 255, 255, 255, 64);
+    }
+
+    float bar_width = (x1 - x0) / TIMING_GRAPH_FRAMES;
+    for (int i = 0; i < TIMING_GRAPH_FRAMES; ++i)
+    {
+        // O quadro mais recente fechado fica na direita
+        unsigned int frame = g_FrameTiming.frame - TIMING_GRAPH_FRAMES + i;
+        if (frame == 0 || frame > g_FrameTiming.frame)
+            continue;
+
+        const TimingRecord& record = Record(frame);
+        if (record.frame != frame || !record.closed)
+            continue;
+
+        float bx0 = x0 + i * bar_width;
+        float bx1 = bx0 + bar_width * 0.8f;
+
+        double stacked_ms = 0.0;
+        for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        {
+            double ms = std::min(record.cpu_ms[p], scale_ms - stacked_ms);
+            if (ms <= 0.0)
+                continue;
+
+            float by0 = y0 + (float)(stacked_ms / scale_ms) * height;
+            float by1 = y0 + (float)((stacked_ms + ms) / scale_ms) * height;
+            AddQuad(bx0, by0, bx1, by1, PASS_COLORS[p][0], PASS_COLORS[p][1], PASS_COLORS[p][2], 220);
+            stacked_ms += ms;
+        }
+
+        double frame_ms = std::min(record.frame_ms, scale_ms);
+        if (frame_ms > stacked_ms)
+        {
+            float by0 = y0 + (float)(stacked_ms / scale_ms) * height;
+            float by1 = y0 + (float)(frame_ms / scale_ms) * height;
+            AddQuad(bx0, by0, bx1, by1, 128, 128, 128, 220);
+        }
+
+        if (record.gpu_frame_ms >= 0.0)
+        {
+            float gy = y0 + (float)(std::min(record.gpu_frame_ms, scale_ms) / scale_ms) * height;
+            AddQuad(bx0, gy - pixel, bx1, gy, 255, 255, 255, 255);
+        }
+    }
+
+    GLint first;
+    if (!TransientBuffer_Upload(vertices.data(), vertices.size() * sizeof(GraphVertex), sizeof(GraphVertex), &first))
+        return;
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
+
+    glUseProgram(g_FrameTiming.program);
+    glBindVertexArray(g_FrameTiming.vertex_array);
+
+    glDrawArrays(GL_TRIANGLES, first, (GLsizei)vertices.size());
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
+}
+
+bool FrameTiming_StartCsv(const char* filename)
+{
+    FrameTiming_StopCsv();
+
+    FILE* csv = fopen(filename, "w");
+    if (csv == NULL)
+    {
+        fprintf(stderr, "ERROR: não foi possível criar \"%s\".\n", filename);
+        return false;
+    }
+
+    fprintf(csv, "frame,frame_ms,gpu_frame_ms");
+    for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+        fprintf(csv, ",%s_cpu_ms,%s_gpu_ms", PASS_NAMES[p], PASS_NAMES[p]);
+    fprintf(csv, "\n");
+
+    g_FrameTiming.csv = csv;
+    g_FrameTiming.csv_next_frame = g_FrameTiming.frame + 1;
+    printf("Gravando tempos dos quadros em \"%s\"\n", filename);
+    return true;
+}
+
+void FrameTiming_StopCsv()
+{
+    if (g_FrameTiming.csv == NULL)
+        return;
+
+    // Os quadros já fechados que ainda esperam pela GPU são lidos agora,
+    // esperando: a gravação terminou e um atraso aqui não distorce nada
+    if (g_FrameTiming.initialized)
+    {
+        for (int i = 0; i < TIMING_QUERY_FRAMES; ++i)
+        {
+            TimingQuerySlot& slot = g_FrameTiming.slots[i];
+            if (slot.frame != g_FrameTiming.frame)
+                ResolveSlot(slot, true);
+        }
+    }
+    WriteCsvRows();
+
+    fclose(g_FrameTiming.csv);
+    g_FrameTiming.csv = NULL;
+    printf("Gravação dos tempos dos quadros encerrada\n");
+}
+
+bool FrameTiming_IsRecordingCsv()
+{
+    return g_FrameTiming.csv != NULL;
+}
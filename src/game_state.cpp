@@ -56,6 +56,8 @@ bool g_A_pressed = false;
 bool g_S_pressed = false;
 bool g_D_pressed = false;
 
+double g_SimulationTime = 0.0;
+
 ZoneType GetZoneTypeAtPosition(glm::vec3 position) {
     float half_map = MAP_SIZE / 2.0f;
     
@@ -0,0 +1,98 @@
+// gl_extensions.cpp - Carregamento de funcionalidades opcionais do OpenGL
+//
+// Veja gl_extensions.h.
+
+#include "gl_extensions.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <GLFW/glfw3.h>
+
+GLExtensions g_GLExtensions;
+
+PFNGLGETPROGRAMBINARYPROC  glext_GetProgramBinary  = NULL;
+PFNGLPROGRAMBINARYPROC     glext_ProgramBinary     = NULL;
+PFNGLPROGRAMPARAMETERIPROC glext_ProgramParameteri = NULL;
+PFNGLBUFFERSTORAGEPROC     glext_BufferStorage     = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_MultiDrawElementsIndirect = NULL;
+PFNGLGETPROGRAMRESOURCEINDEXPROC   glext_GetProgramResourceIndex   = NULL;
+PFNGLSHADERSTORAGEBLOCKBINDINGPROC glext_ShaderStorageBlockBinding = NULL;
+
+static bool VersionAtLeast(int major, int minor)
+{
+    return g_GLExtensions.version_major > major
+        || (g_GLExtensions.version_major == major && g_GLExtensions.version_minor >= minor);
+}
+
+bool GLExtensions_Has(const char* name)
+{
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void GLExtensions_Init()
+{
+    memset(&g_GLExtensions, 0, sizeof(g_GLExtensions));
+    glGetIntegerv(GL_MAJOR_VERSION, &g_GLExtensions.version_major);
+    glGetIntegerv(GL_MINOR_VERSION, &g_GLExtensions.version_minor);
+
+    // Program binaries: núcleo no 4.1, extensão ARB (mesmos nomes de função) antes disso
+    if (VersionAtLeast(4, 1) || GLExtensions_Has("GL_ARB_get_program_binary"))
+    {
+        glext_GetProgramBinary  = (PFNGLGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+        glext_ProgramBinary     = (PFNGLPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+        glext_ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+
+        // Um driver pode anunciar a extensão sem oferecer nenhum formato binário
+        GLint num_formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+
+        g_GLExtensions.program_binary = glext_GetProgramBinary != NULL && glext_ProgramBinary != NULL
+                                     && glext_ProgramParameteri != NULL && num_formats > 0;
+    }
+
+    // Armazenamento imutável de buffers: núcleo no 4.4
+    if (VersionAtLeast(4, 4) || GLExtensions_Has("GL_ARB_buffer_storage"))
+    {
+        glext_BufferStorage = (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+        g_GLExtensions.buffer_storage = glext_BufferStorage != NULL;
+    }
+
+    // Desenho indireto (veja multi_draw.h): glMultiDrawElementsIndirect() e
+    // shader storage buffers são núcleo no 4.3; o índice do desenho no shader
+    // (gl_DrawIDARB) precisa da extensão, núcleo só no GLSL 4.60
+    if (VersionAtLeast(4, 3) && GLExtensions_Has("GL_ARB_shader_draw_parameters"))
+    {
+        glext_MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)glfwGetProcAddress("glMultiDrawElementsIndirect");
+        glext_GetProgramResourceIndex   = (PFNGLGETPROGRAMRESOURCEINDEXPROC)glfwGetProcAddress("glGetProgramResourceIndex");
+        glext_ShaderStorageBlockBinding = (PFNGLSHADERSTORAGEBLOCKBINDINGPROC)glfwGetProcAddress("glShaderStorageBlockBinding");
+        g_GLExtensions.multi_draw_indirect = glext_MultiDrawElementsIndirect != NULL
+                                          && glext_GetProgramResourceIndex != NULL
+                                          && glext_ShaderStorageBlockBinding != NULL;
+    }
+
+    // Framebuffer sRGB: com GL_FRAMEBUFFER_SRGB habilitado o OpenGL converte
+    // as cores escritas (lineares) para sRGB. O framebuffer da janela só é
+    // sRGB se foi pedido (GLFW_SRGB_CAPABLE) e o sistema ofereceu um.
+    GLint draw_framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+    GLint encoding = GL_LINEAR;
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, draw_framebuffer == 0 ? GL_BACK_LEFT : GL_COLOR_ATTACHMENT0,
+        GL_FRAMEBUFFER_ATTACHMENT_COLOR_ENCODING, &encoding);
+    g_GLExtensions.srgb_framebuffer = encoding == GL_SRGB;
+
+    printf("OpenGL %d.%d: program binaries %s, buffer storage %s, desenho indireto %s, framebuffer %s.\n",
+        g_GLExtensions.version_major, g_GLExtensions.version_minor,
+        g_GLExtensions.program_binary ? "disponíveis" : "indisponíveis",
+        g_GLExtensions.buffer_storage ? "disponível" : "indisponível",
+        g_GLExtensions.multi_draw_indirect ? "disponível" : "indisponível",
+        g_GLExtensions.srgb_framebuffer ? "sRGB" : "linear");
+}
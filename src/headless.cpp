@@ -0,0 +1,130 @@
+// headless.cpp - Modo sem janela visível
+//
+// Veja headless.h.
+
+#include "headless.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include <GLFW/glfw3.h>
+
+struct HeadlessState
+{
+    int    width;
+    int    height;
+    int    max_frames;
+
+    GLuint framebuffer;
+    GLuint color_buffer;
+    GLuint depth_buffer;
+
+    // Contagem e tempo dos quadros. O primeiro quadro (compilação de shaders,
+    // envio de texturas) fica fora da média.
+    int    frames;
+    double first_frame_end;
+    double last_frame_end;
+};
+
+static HeadlessState g_Headless;
+
+bool Headless_ParseSize(const char* text, int* width, int* height)
+{
+    int w, h;
+    char trailing;
+    if (sscanf(text, "%dx%d%c", &w, &h, &trailing) != 2 || w <= 0 || h <= 0)
+        return false;
+
+    *width = w;
+    *height = h;
+    return true;
+}
+
+bool Headless_Init(int width, int height, int max_frames)
+{
+    memset(&g_Headless, 0, sizeof(g_Headless));
+    g_Headless.width      = width;
+    g_Headless.height     = height;
+    g_Headless.max_frames = max_frames;
+
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_size);
+    if (width > max_size || height > max_size)
+    {
+        fprintf(stderr, "ERROR: framebuffer %dx%d maior que o máximo do OpenGL (%d).\n", width, height, max_size);
+        return false;
+    }
+
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    GLsizei samples = max_samples < HEADLESS_SAMPLES ? max_samples : HEADLESS_SAMPLES;
+
+    glGenRenderbuffers(1, &g_Headless.color_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, g_Headless.color_buffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_SRGB8_ALPHA8, width, height);
+
+    glGenRenderbuffers(1, &g_Headless.depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, g_Headless.depth_buffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &g_Headless.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, g_Headless.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, g_Headless.color_buffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, g_Headless.depth_buffer);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: framebuffer do modo headless incompleto (0x%04x).\n", status);
+        Headless_Destroy();
+        return false;
+    }
+
+    printf("Modo headless: framebuffer %dx%d, %d amostras", width, height, (int)samples);
+    if (max_frames > 0)
+        printf(", %d quadros", max_frames);
+    printf(".\n");
+    return true;
+}
+
+void Headless_Destroy()
+{
+    if (g_Headless.framebuffer != 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &g_Headless.framebuffer);
+    }
+    glDeleteRenderbuffers(1, &g_Headless.color_buffer);
+    glDeleteRenderbuffers(1, &g_Headless.depth_buffer);
+    g_Headless.framebuffer = 0;
+    g_Headless.color_buffer = 0;
+    g_Headless.depth_buffer = 0;
+}
+
+bool Headless_EndFrame()
+{
+    glFinish();
+
+    double now = glfwGetTime();
+    if (g_Headless.frames == 0)
+        g_Headless.first_frame_end = now;
+    g_Headless.last_frame_end = now;
+    g_Headless.frames++;
+
+    return g_Headless.max_frames > 0 && g_Headless.frames >= g_Headless.max_frames;
+}
+
+void Headless_PrintSummary()
+{
+    int measured = g_Headless.frames - 1;
+    if (measured <= 0)
+    {
+        printf("Modo headless: %d quadros desenhados.\n", g_Headless.frames);
+        return;
+    }
+
+    double ms = 1000.0 * (g_Headless.last_frame_end - g_Headless.first_frame_end) / measured;
+    printf("Modo headless: %d quadros desenhados, %.3f ms por quadro (%.1f fps), sem contar o primeiro.\n",
+        g_Headless.frames, ms, ms > 0.0 ? 1000.0 / ms : 0.0);
+}
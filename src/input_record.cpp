@@ -0,0 +1,390 @@
+// input_record.cpp - Gravação e reprodução da entrada do jogador
+//
+// Veja input_record.h. A gravação escreve direto no arquivo (FILE* já usa um
+// buffer); a reprodução lê o arquivo inteiro para a memória no início, então
+// nenhum quadro reproduzido espera pelo disco.
+
+#include "input_record.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+static const char INPUT_RECORD_MAGIC[4] = { 'C', 'D', 'I', 'N' };
+static const unsigned char INPUT_RECORD_VERSION = 1;
+
+enum InputRecordType
+{
+    RECORD_FRAME = 0,
+    RECORD_KEY,
+    RECORD_BUTTON,
+    RECORD_CURSOR,
+    RECORD_SCROLL
+};
+
+enum InputRecordMode
+{
+    MODE_OFF = 0,
+    MODE_RECORDING,
+    MODE_REPLAYING
+};
+
+struct InputRecordState
+{
+    InputRecordMode mode;
+    GLFWwindow*     window;
+
+    // Callbacks do jogo, chamados pelos callbacks deste módulo
+    GLFWkeyfun         key_callback;
+    GLFWmousebuttonfun button_callback;
+    GLFWcursorposfun   cursor_callback;
+    GLFWscrollfun      scroll_callback;
+
+    // Gravação
+    FILE* file;
+
+    // Reprodução
+    std::vector<unsigned char> data;
+    size_t position;
+    double cursor_x;
+    double cursor_y;
+
+    unsigned int frames;
+    unsigned int events;
+};
+
+static InputRecordState g_InputRecord;
+
+// ---------------------------------------------------------------------
+// Escrita e leitura dos campos em little-endian
+
+static void PutBytes(uint64_t value, int count)
+{
+    for (int i = 0; i < count; ++i)
+        fputc((int)((value >> (8 * i)) & 0xFF), g_InputRecord.file);
+}
+
+static void PutFloat(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutBytes(bits, 4);
+}
+
+static void PutDouble(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    PutBytes(bits, 8);
+}
+
+static bool GetBytes(int count, uint64_t* value)
+{
+    if (g_InputRecord.position + count > g_InputRecord.data.size())
+        return false;
+
+    uint64_t result = 0;
+    for (int i = 0; i < count; ++i)
+        result |= (uint64_t)g_InputRecord.data[g_InputRecord.position + i] << (8 * i);
+    g_InputRecord.position += count;
+    *value = result;
+    return true;
+}
+
+static bool GetFloat(float* value)
+{
+    uint64_t bits;
+    if (!GetBytes(4, &bits))
+        return false;
+    uint32_t bits32 = (uint32_t)bits;
+    memcpy(value, &bits32, sizeof(*value));
+    return true;
+}
+
+static bool GetDouble(double* value)
+{
+    uint64_t bits;
+    if (!GetBytes(8, &bits))
+        return false;
+    memcpy(value, &bits, sizeof(*value));
+    return true;
+}
+
+// ---------------------------------------------------------------------
+// Callbacks instalados na janela
+
+static void RecordKeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (g_InputRecord.mode == MODE_REPLAYING)
+    {
+        // Só ESC passa: o jogo fecha a janela e a reprodução termina
+        if (key == GLFW_KEY_ESCAPE && g_InputRecord.key_callback)
+            g_InputRecord.key_callback(window, key, scancode, action, mods);
+        return;
+    }
+
+    fputc(RECORD_KEY, g_InputRecord.file);
+    PutBytes((uint16_t)(int16_t)key, 2);
+    PutBytes((uint16_t)(int16_t)scancode, 2);
+    PutBytes((uint8_t)action, 1);
+    PutBytes((uint8_t)mods, 1);
+    g_InputRecord.events++;
+
+    if (g_InputRecord.key_callback)
+        g_InputRecord.key_callback(window, key, scancode, action, mods);
+}
+
+static void RecordMouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
+{
+    if (g_InputRecord.mode == MODE_REPLAYING)
+        return;
+
+    fputc(RECORD_BUTTON, g_InputRecord.file);
+    PutBytes((uint8_t)button, 1);
+    PutBytes((uint8_t)action, 1);
+    PutBytes((uint8_t)mods, 1);
+    g_InputRecord.events++;
+
+    if (g_InputRecord.button_callback)
+        g_InputRecord.button_callback(window, button, action, mods);
+}
+
+static void RecordCursorPosCallback(GLFWwindow* window, double x, double y)
+{
+    if (g_InputRecord.mode == MODE_REPLAYING)
+        return;
+
+    fputc(RECORD_CURSOR, g_InputRecord.file);
+    PutDouble(x);
+    PutDouble(y);
+    g_InputRecord.events++;
+
+    if (g_InputRecord.cursor_callback)
+        g_InputRecord.cursor_callback(window, x, y);
+}
+
+static void RecordScrollCallback(GLFWwindow* window, double x_offset, double y_offset)
+{
+    if (g_InputRecord.mode == MODE_REPLAYING)
+        return;
+
+    fputc(RECORD_SCROLL, g_InputRecord.file);
+    PutDouble(x_offset);
+    PutDouble(y_offset);
+    g_InputRecord.events++;
+
+    if (g_InputRecord.scroll_callback)
+        g_InputRecord.scroll_callback(window, x_offset, y_offset);
+}
+
+static void InstallCallbacks(GLFWwindow* window)
+{
+    g_InputRecord.window          = window;
+    g_InputRecord.key_callback    = glfwSetKeyCallback(window, RecordKeyCallback);
+    g_InputRecord.button_callback = glfwSetMouseButtonCallback(window, RecordMouseButtonCallback);
+    g_InputRecord.cursor_callback = glfwSetCursorPosCallback(window, RecordCursorPosCallback);
+    g_InputRecord.scroll_callback = glfwSetScrollCallback(window, RecordScrollCallback);
+}
+
+// ---------------------------------------------------------------------
+
+bool InputRecord_StartRecording(GLFWwindow* window, const char* filename)
+{
+    InputRecord_Stop();
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: não foi possível criar \"%s\".\n", filename);
+        return false;
+    }
+
+    fwrite(INPUT_RECORD_MAGIC, 1, sizeof(INPUT_RECORD_MAGIC), file);
+    fputc(INPUT_RECORD_VERSION, file);
+
+    g_InputRecord.mode   = MODE_RECORDING;
+    g_InputRecord.file   = file;
+    g_InputRecord.frames = 0;
+    g_InputRecord.events = 0;
+    InstallCallbacks(window);
+
+    printf("Gravando a entrada em \"%s\"\n", filename);
+    return true;
+}
+
+bool InputRecord_StartReplay(GLFWwindow* window, const char* filename)
+{
+    InputRecord_Stop();
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: não foi possível abrir \"%s\".\n", filename);
+        return false;
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.insert(data.end(), chunk, chunk + count);
+    fclose(file);
+
+    if (data.size() < sizeof(INPUT_RECORD_MAGIC) + 1
+        || memcmp(data.data(), INPUT_RECORD_MAGIC, sizeof(INPUT_RECORD_MAGIC)) != 0
+        || data[sizeof(INPUT_RECORD_MAGIC)] != INPUT_RECORD_VERSION)
+    {
+        fprintf(stderr, "ERROR: \"%s\" não é uma gravação de entrada válida.\n", filename);
+        return false;
+    }
+
+    g_InputRecord.mode     = MODE_REPLAYING;
+    g_InputRecord.data.swap(data);
+    g_InputRecord.position = sizeof(INPUT_RECORD_MAGIC) + 1;
+    g_InputRecord.frames   = 0;
+    g_InputRecord.events   = 0;
+    glfwGetCursorPos(window, &g_InputRecord.cursor_x, &g_InputRecord.cursor_y);
+    InstallCallbacks(window);
+
+    printf("Reproduzindo a entrada de \"%s\"\n", filename);
+    return true;
+}
+
+void InputRecord_Stop()
+{
+    if (g_InputRecord.mode == MODE_OFF)
+        return;
+
+    GLFWwindow* window = g_InputRecord.window;
+    glfwSetKeyCallback(window, g_InputRecord.key_callback);
+    glfwSetMouseButtonCallback(window, g_InputRecord.button_callback);
+    glfwSetCursorPosCallback(window, g_InputRecord.cursor_callback);
+    glfwSetScrollCallback(window, g_InputRecord.scroll_callback);
+
+    if (g_InputRecord.mode == MODE_RECORDING)
+    {
+        long bytes = ftell(g_InputRecord.file);
+        fclose(g_InputRecord.file);
+        g_InputRecord.file = NULL;
+        printf("Gravação da entrada encerrada: %u quadros, %u eventos, %ld bytes\n",
+            g_InputRecord.frames, g_InputRecord.events, bytes);
+    }
+    else
+    {
+        std::vector<unsigned char>().swap(g_InputRecord.data);
+        g_InputRecord.position = 0;
+        printf("Reprodução da entrada encerrada: %u quadros, %u eventos\n",
+            g_InputRecord.frames, g_InputRecord.events);
+    }
+
+    g_InputRecord.mode = MODE_OFF;
+}
+
+bool InputRecord_IsRecording()
+{
+    return g_InputRecord.mode == MODE_RECORDING;
+}
+
+bool InputRecord_IsReplaying()
+{
+    return g_InputRecord.mode == MODE_REPLAYING;
+}
+
+// Entrega os eventos gravados até o próximo FRAME (ou o fim do arquivo).
+// Retorna false se o arquivo estiver corrompido.
+static bool ReplayEvents()
+{
+    GLFWwindow* window = g_InputRecord.window;
+    std::vector<unsigned char>& data = g_InputRecord.data;
+
+    while (g_InputRecord.position < data.size() && data[g_InputRecord.position] != RECORD_FRAME)
+    {
+        unsigned char type = data[g_InputRecord.position++];
+        uint64_t a, b, c, d;
+        double x, y;
+        bool ok;
+
+        switch (type)
+        {
+        case RECORD_KEY:
+            ok = GetBytes(2, &a) && GetBytes(2, &b) && GetBytes(1, &c) && GetBytes(1, &d);
+            if (ok && g_InputRecord.key_callback)
+                g_InputRecord.key_callback(window, (int16_t)(uint16_t)a, (int16_t)(uint16_t)b, (int)c, (int)d);
+            break;
+        case RECORD_BUTTON:
+            ok = GetBytes(1, &a) && GetBytes(1, &b) && GetBytes(1, &c);
+            if (ok && g_InputRecord.button_callback)
+                g_InputRecord.button_callback(window, (int)a, (int)b, (int)c);
+            break;
+        case RECORD_CURSOR:
+            ok = GetDouble(&x) && GetDouble(&y);
+            if (ok)
+            {
+                g_InputRecord.cursor_x = x;
+                g_InputRecord.cursor_y = y;
+                if (g_InputRecord.cursor_callback)
+                    g_InputRecord.cursor_callback(window, x, y);
+            }
+            break;
+        case RECORD_SCROLL:
+            ok = GetDouble(&x) && GetDouble(&y);
+            if (ok && g_InputRecord.scroll_callback)
+                g_InputRecord.scroll_callback(window, x, y);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (!ok)
+        {
+            fprintf(stderr, "ERROR: gravação de entrada corrompida (posição %lu).\n", (unsigned long)g_InputRecord.position);
+            return false;
+        }
+        g_InputRecord.events++;
+    }
+    return true;
+}
+
+bool InputRecord_BeginFrame(float* delta_time)
+{
+    if (g_InputRecord.mode == MODE_RECORDING)
+    {
+        fputc(RECORD_FRAME, g_InputRecord.file);
+        PutFloat(*delta_time);
+        g_InputRecord.frames++;
+        return true;
+    }
+
+    if (g_InputRecord.mode != MODE_REPLAYING)
+        return true;
+
+    // Eventos gravados antes do primeiro quadro
+    if (!ReplayEvents() || g_InputRecord.position >= g_InputRecord.data.size())
+        return false;
+
+    g_InputRecord.position++;   // RECORD_FRAME
+    if (!GetFloat(delta_time))
+        return false;
+
+    g_InputRecord.frames++;
+    return true;
+}
+
+void InputRecord_EndFrame()
+{
+    if (g_InputRecord.mode == MODE_REPLAYING)
+        ReplayEvents();
+}
+
+void InputRecord_GetCursorPos(GLFWwindow* window, double* x, double* y)
+{
+    if (g_InputRecord.mode == MODE_REPLAYING)
+    {
+        *x = g_InputRecord.cursor_x;
+        *y = g_InputRecord.cursor_y;
+        return;
+    }
+    glfwGetCursorPos(window, x, y);
+}
@@ -1,6 +1,9 @@
 #include <cmath>
 #include <cstdio>
+#include <cerrno>
+#include <climits>
 #include <cstdlib>
+#include <cstring>
 
 // Headers abaixo são específicos de C++
 #include <set>
@@ -8,11 +11,15 @@
 #include <stack>
 #include <string>
 #include <vector>
+#include <memory>
 #include <limits>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <chrono>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>   // Criação de contexto OpenGL 3.3
@@ -22,11 +29,11 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 
 // Headers da biblioteca para carregar modelos obj
 #include <tiny_obj_loader.h>
 
-#include <stb_image.h>
 
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
@@ -36,6 +43,25 @@
 #include "rod_system.h"
 #include "collision.h"
 #include "skybox.h"
+#include "mesh_cache.h"
+#include "vertex_format.h"
+#include "mesh_simplify.h"
+#include "mesh_instancing.h"
+#include "asset_loader.h"
+#include "asset_registry.h"
+#include "gl_extensions.h"
+#include "shader_program.h"
+#include "render_queue.h"
+#include "uniform_buffers.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "transient_buffer.h"
+#include "terrain.h"
+#include "water.h"
+#include "multi_draw.h"
+#include "headless.h"
+#include "frame_timing.h"
+#include "input_record.h"
 
 // Estrutura que representa um modelo geométrico carregado a partir de um
 // arquivo ".obj". Veja https://en.wikipedia.org/wiki/Wavefront_.obj_file .
@@ -96,17 +122,28 @@ struct ObjModel
 };
 
 
+// Identificador de um objeto da cena virtual: índice nos vetores
+// g_DrawRecords, g_LodStates e g_SceneObjects. Obtido uma única vez a partir do
+// nome com FindSceneObject(); nenhuma busca por nome acontece ao desenhar.
+typedef int SceneObjectHandle;
+#define INVALID_SCENE_OBJECT (-1)
+
 // Declaração de várias funções utilizadas em main().  Essas estão definidas
 // logo após a definição de main() neste arquivo.
-void BuildTrianglesAndAddToVirtualScene(ObjModel*); // Constrói representação de um ObjModel como malha de triângulos para renderização
-void ComputeNormals(ObjModel* model); // Computa normais de um ObjModel, caso não existam.
-void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU
-void LoadTextureImage(const char* filename); // Função que carrega imagens de textura
-void DrawVirtualObject(const char* object_name); // Desenha um objeto armazenado em g_VirtualScene
-GLuint LoadShader_Vertex(const char* filename);   // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char* filename); // Carrega um fragment shader
-void LoadShader(const char* filename, GLuint shader_id); // Função utilizada pelas duas acima
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
+void BuildMeshData(ObjModel* model, MeshData* mesh, unsigned int build_flags = 0); // Constrói os streams de vértices/índices de um ObjModel
+void AddMeshToVirtualScene(const MeshView& mesh, ModelAsset* asset = NULL); // Envia streams para a GPU e adiciona objetos em g_VirtualScene
+ModelHandle LoadModelToVirtualScene(const char* filename, unsigned int build_flags = 0); // Carrega um ".obj" (ou sua versão cozida) para g_VirtualScene
+void UnloadModel(ModelHandle handle); // Libera uma referência a um modelo, removendo seus objetos de g_VirtualScene
+void ComputeNormals(ObjModel* model, unsigned int num_threads = 1); // Computa normais de um ObjModel, caso não existam.
+int BenchmarkComputeNormals(); // Compara ComputeNormals() com a versão anterior (--benchmark-normals)
+int BenchmarkRenderSubmit(GLFWwindow* window); // Compara o envio da fila nos caminhos OpenGL 3.3 e indireto (--benchmark-submit)
+void LoadShadersFromFiles(); // Carrega os shaders de vértice e fragmento, criando um programa de GPU por material
+TextureHandle LoadTextureImage(const char* filename); // Função que carrega imagens de textura
+void UploadTextureImage(const DecodedImage& image, TextureAsset* texture); // Envia imagem decodificada para a GPU
+SceneObjectHandle FindSceneObject(const std::string& name); // Handle de um objeto da cena virtual (INVALID_SCENE_OBJECT se não existir)
+void DrawVirtualObject(SceneObjectHandle object, const glm::mat4& model); // Desenha um objeto da cena virtual
+void SubmitVirtualObject(SceneObjectHandle object, const glm::mat4& model, int object_id, int pass = RENDER_PASS_OPAQUE); // Enfileira um desenho em g_RenderQueue
+void FlushRenderQueue(); // Ordena e desenha os pacotes de g_RenderQueue
 void PrintObjModelInfo(ObjModel*); // Função para debugging
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
@@ -115,10 +152,13 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow* window);
 float TextRendering_CharWidth(GLFWwindow* window);
 void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_Flush(); // Desenha de uma vez o texto de TextRendering_PrintString()
 
 // Funções abaixo renderizam como texto na janela OpenGL algumas matrizes e
 // outras informações do programa. Definidas após main().
 void TextRendering_ShowFramesPerSecond(GLFWwindow* window);
+void TextRendering_ShowRenderStats(GLFWwindow* window);
+void TextRendering_ShowFrameTiming(GLFWwindow* window);
 
 // Funções callback para comunicação com o sistema operacional e interação do
 // usuário. Veja mais comentários nas definições das mesmas, abaixo.
@@ -129,30 +169,115 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
 void CursorPosCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 
-// Definimos uma estrutura que armazenará dados necessários para renderizar
-// cada objeto da cena virtual.
-struct SceneObject
+// Dados lidos a cada desenho de um objeto. Ficam contíguos em g_DrawRecords,
+// separados do nome e dos demais dados usados só no carregamento.
+struct DrawRecord
 {
-    std::string  name;        // Nome do objeto
-    size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
-    size_t       num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
-    GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
     GLuint       vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
+    GLenum       rendering_mode; // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
     glm::vec3    bbox_min; // Axis-Aligned Bounding Box do objeto
     glm::vec3    bbox_max;
     glm::vec3    material_kd; // Cor difusa do material (do arquivo .mtl)
+    bool         vertex_colors; // Cor no VBO (atributo 3 habilitado); material_kd não é usado
+
+    // Objetos instanciados (veja mesh_instancing.h) são desenhados
+    // num_instances vezes, cada uma com sua transformação, em um VAO próprio.
+    // bounds_min/bounds_max envolvem todas as instâncias e instance_scale é a
+    // maior escala entre elas (sem instâncias: a bbox e 1).
+    GLsizei      num_instances;
+    glm::vec3    bounds_min;
+    glm::vec3    bounds_max;
+    float        instance_scale;
+
+    // Níveis de detalhe (veja mesh_simplify.h); lods[0] é a malha completa.
+    // num_lods == 0 indica uma entrada livre (objeto descarregado).
+    int          num_lods;
+    MeshLod      lods[MESH_MAX_LODS];
+};
+
+// LOD escolhido para cada desenho de um objeto no quadro (o mesmo objeto
+// pode ser desenhado várias vezes, ex. "cube"). Usado para a histerese.
+struct LodState
+{
+    std::vector<int> lod_state;
+    unsigned int     lod_frame; // Quadro em que lod_draws foi zerado
+    size_t           lod_draws; // Desenhos deste objeto no quadro atual
+};
+
+// Dados de cada objeto da cena virtual que não são usados ao desenhar
+struct SceneObject
+{
+    std::string  name;        // Nome do objeto
+    size_t       first_index; // Índice do primeiro vértice dentro do vetor indices[] definido em BuildMeshData()
+    size_t       num_indices; // Número de índices do objeto dentro do vetor indices[] definido em BuildMeshData()
 };
 
 // Abaixo definimos variáveis globais utilizadas em várias funções do código.
 
-// A cena virtual é uma lista de objetos nomeados, guardados em um dicionário
-// (map).  Veja dentro da função BuildTrianglesAndAddToVirtualScene() como que são incluídos
-// objetos dentro da variável g_VirtualScene, e veja na função main() como
-// estes são acessados.
-std::map<std::string, SceneObject> g_VirtualScene;
+// A cena virtual é uma lista de objetos nomeados. O dicionário (map)
+// g_VirtualScene só associa nomes a handles e é consultado no carregamento;
+// os dados dos objetos ficam nos vetores abaixo, indexados pelo handle. Veja
+// dentro da função AddMeshToVirtualScene() como que são incluídos objetos, e
+// veja RenderScene() como estes são acessados.
+std::map<std::string, SceneObjectHandle> g_VirtualScene;
+std::vector<DrawRecord>        g_DrawRecords;
+std::vector<LodState>          g_LodStates;
+std::vector<SceneObject>       g_SceneObjects;
+std::vector<SceneObjectHandle> g_FreeSceneObjects; // Entradas de objetos descarregados
+
+// Incrementado sempre que objetos entram ou saem da cena, para que handles
+// guardados por nome sejam resolvidos de novo (veja ResolveRenderObjects()).
+unsigned int g_VirtualSceneRevision = 0;
 
 // Razão de proporção da janela (largura/altura). Veja função FramebufferSizeCallback().
 float g_ScreenRatio = 1.0f;
+int   g_FramebufferHeight = 600; // Altura em pixels, usada na seleção de LODs
+
+// Seleção de níveis de detalhe em DrawVirtualObject(). O erro geométrico de
+// cada LOD, projetado na tela, deve ficar abaixo de g_LodMaxPixelError pixels.
+// Para trocar para um LOD mais grosseiro exigimos uma folga (histerese), de
+// modo que objetos próximos do limite não fiquem alternando entre dois LODs.
+const size_t MIN_TRIANGLES_FOR_LODS = 256;
+const float  LOD_HYSTERESIS = 0.7f;
+float g_LodMaxPixelError = 0.5f;
+bool  g_LodEnabled = true;
+
+// Câmera do quadro atual, definidas em RenderScene() para DrawVirtualObject()
+glm::mat4 g_CameraView;
+glm::mat4 g_CameraProjection;
+Frustum   g_CameraFrustum;     // Planos de g_CameraProjection*g_CameraView
+
+// Culling por frustum em SubmitVirtualObject() e SubmitStaticScene() (veja culling.h)
+bool g_FrustumCullingEnabled = true;
+
+// Culling por oclusão das árvores e cubos na FASE DE PESCA, quando a câmera
+// fica no nível da água e o terreno esconde boa parte deles (veja occlusion.h)
+bool g_OcclusionCullingEnabled = true;
+unsigned int g_FrameNumber = 0;
+
+// Desenhos do quadro atual, ordenados por FlushRenderQueue() (veja render_queue.h)
+RenderQueue g_RenderQueue;
+
+// Auxiliares de FlushRenderQueue(), reaproveitados entre quadros: programa
+// indireto e entrada no anel de ObjectUniforms de cada pacote
+std::vector<GLuint> g_RenderQueueIndirectPrograms;
+std::vector<size_t> g_RenderQueueObjectEntries;
+
+// Backend indireto para os opacos da fila (veja multi_draw.h). É opcional: só
+// com "--multi-draw" (ou "--benchmark-submit") pedimos um contexto OpenGL 4.5
+// e compilamos as variantes indiretas dos programas. Nesse caso ele começa
+// ligado e a tecla M alterna com o caminho OpenGL 3.3.
+bool   g_MultiDrawRequested = false;
+bool   g_MultiDrawEnabled = false;
+
+// Tempo de CPU gasto no último FlushRenderQueue()
+double g_FlushRenderQueueMs = 0.0;
+
+// Backend indireto pedido e oferecido pelo contexto
+static bool MultiDrawAvailable()
+{
+    return g_MultiDrawRequested && g_GLExtensions.multi_draw_indirect;
+}
 
 // "g_LeftMouseButtonPressed = true" se o usuário está com o botão esquerdo do mouse
 // pressionado no momento atual. Veja função MouseButtonCallback().
@@ -173,25 +298,138 @@ bool g_Q_pressed = false;
 bool g_E_pressed = false;
 bool g_DebugFirstMouse = true;
 
+// Passo fixo da simulação. UpdateGamePhysics() acumula o tempo real de cada
+// quadro e avança a simulação em passos de SIMULATION_STEP segundos, no
+// máximo SIMULATION_MAX_STEPS por quadro (depois disso o tempo restante é
+// descartado, e o jogo fica mais lento em vez de travar). O desenho não é
+// limitado: cada quadro desenha o estado interpolado entre os dois últimos
+// passos (g_Render*, calculado por InterpolateRenderState()).
+#define SIMULATION_RATE      120
+#define SIMULATION_STEP      (1.0f / SIMULATION_RATE)
+#define SIMULATION_MAX_STEPS 12
+
+float g_SimulationAccumulator = 0.0f; // Tempo real ainda não simulado
+unsigned long g_SimulationSteps = 0;  // Passos dados desde o início
+
+// Estado antes do último passo
+Boat g_PreviousBoat;
+Fish g_PreviousFish;
+Bait g_PreviousBait;
+glm::vec3 g_PreviousDebugCameraPos;
+
+// Estado desenhado neste quadro
+Boat g_RenderBoat;
+Fish g_RenderFish;
+Bait g_RenderBait;
+glm::vec3 g_RenderDebugCameraPos;
+double g_RenderTime = 0.0; // Tempo da simulação correspondente (ondas)
+
 // Variável que controla se o texto informativo será mostrado na tela.
 bool g_ShowInfoText = true;
 
-// Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
-GLuint g_GpuProgramID = 0;
-GLint g_model_uniform;
-GLint g_view_uniform;
-GLint g_projection_uniform;
-GLint g_object_id_uniform;
-GLint g_bbox_min_uniform;
-GLint g_bbox_max_uniform;
-GLint g_material_kd_uniform;
+// Gráfico e percentis dos tempos dos quadros (veja frame_timing.h), junto ao
+// texto informativo
+bool g_ShowFrameTiming = true;
+
+// Valores de "object_id": o material de cada desenho, que escolhe a variante
+// do programa de GPU (veja g_ShaderVariants)
+#define MAP             0
+#define BOAT            1
+#define FISH            2
+#define BAIT            3
+#define HOOK            4
+#define ROD             5
+#define FISHING_LINE    6
+#define TREE            7
+#define WATER           8
+#define CUBE            9
+#define NUM_OBJECT_IDS  10
+
+// Variantes do programa de GPU principal. "shader_vertex.glsl" e
+// "shader_fragment.glsl" são compilados uma vez por variante, com as linhas
+// "defines" inseridas logo após "#version": cada programa contém só o caminho
+// do seu material, sem desvios por object_id a cada fragmento.
+struct ShaderVariant
+{
+    const char* name;     // Sufixo do nome no cache de programas
+    const char* defines;
+};
+
+// Índices em g_ShaderVariants (mesma ordem)
+enum ShaderVariantId
+{
+    SHADER_VARIANT_MTL,
+    SHADER_VARIANT_BOAT,
+    SHADER_VARIANT_FISH,
+    SHADER_VARIANT_BAIT,
+    SHADER_VARIANT_HOOK,
+    SHADER_VARIANT_ROD,
+    SHADER_VARIANT_FISHING_LINE,
+    SHADER_VARIANT_WATER,
+    SHADER_VARIANT_CUBE,
+    SHADER_VARIANT_TERRAIN,
+    SHADER_VARIANT_FALLBACK,
+    NUM_SHADER_VARIANTS
+};
+
+static const ShaderVariant g_ShaderVariants[NUM_SHADER_VARIANTS] = {
+    { "mtl",          "#define MATERIAL_MTL\n" },
+    { "boat",         "#define MATERIAL_BOAT\n" },
+    { "fish",         "#define MATERIAL_FISH\n#define GOURAUD_SHADING\n" },
+    { "bait",         "#define MATERIAL_BAIT\n" },
+    { "hook",         "#define MATERIAL_HOOK\n" },
+    { "rod",          "#define MATERIAL_ROD\n" },
+    { "fishing_line", "#define MATERIAL_FISHING_LINE\n" },
+    { "water",        "#define MATERIAL_WATER\n#define PROCEDURAL_WATER_GRID\n" },
+    { "cube",         "#define MATERIAL_CUBE\n" },
+    { "terrain",      "#define MATERIAL_MTL\n#define SMOOTH_MATERIAL_COLOR\n" },
+    { "fallback",     "" },
+};
 
-// Número de texturas carregadas pela função LoadTextureImage()
-GLuint g_NumLoadedTextures = 0;
+// Variante de cada valor de "object_id"
+static const ShaderVariantId g_ObjectShaderVariant[NUM_OBJECT_IDS] = {
+    SHADER_VARIANT_TERRAIN,      // MAP
+    SHADER_VARIANT_BOAT,         // BOAT
+    SHADER_VARIANT_FISH,         // FISH
+    SHADER_VARIANT_BAIT,         // BAIT
+    SHADER_VARIANT_HOOK,         // HOOK
+    SHADER_VARIANT_ROD,          // ROD
+    SHADER_VARIANT_FISHING_LINE, // FISHING_LINE
+    SHADER_VARIANT_MTL,          // TREE
+    SHADER_VARIANT_WATER,        // WATER
+    SHADER_VARIANT_CUBE,         // CUBE
+};
+
+// Programas de GPU (shaders) de cada variante. Veja função LoadShadersFromFiles().
+GLuint g_GpuPrograms[NUM_SHADER_VARIANTS] = { 0 };
+
+// Versões das variantes para o backend indireto (MULTI_DRAW_INDIRECT); 0 se
+// o contexto não oferece o backend
+GLuint g_GpuProgramsIndirect[NUM_SHADER_VARIANTS] = { 0 };
+
+// Programa que desenha objetos com o valor "object_id"
+static GLuint GpuProgramForObject(int object_id)
+{
+    if (object_id < 0 || object_id >= NUM_OBJECT_IDS)
+        return g_GpuPrograms[SHADER_VARIANT_FALLBACK];
+    return g_GpuPrograms[g_ObjectShaderVariant[object_id]];
+}
+
+// Versão indireta da variante de "program_id" (0 se não houver)
+static GLuint IndirectGpuProgram(GLuint program_id)
+{
+    for (int variant = 0; variant < NUM_SHADER_VARIANTS; ++variant)
+        if (g_GpuPrograms[variant] == program_id)
+            return g_GpuProgramsIndirect[variant];
+    return 0;
+}
 
 // Skybox global
 Skybox g_Skybox;
 
+// Terreno em blocos com geomipmapping (veja terrain.h)
+Terrain g_Terrain;
+
 // Variáveis auxiliares para controle do mouse na fase de pesca
 double g_FishingLastCursorX = 0.0;
 double g_FishingLastCursorY = 0.0;
@@ -200,7 +438,7 @@ bool g_FishingFirstMouse = true;
 glm::vec4 camera_view_vector;
 
 // Funções de inicialização e renderização
-GLFWwindow* InitializeWindow();
+GLFWwindow* InitializeWindow(int width, int height, bool visible);
 void SetupCallbacks(GLFWwindow* window);
 void InitializeOpenGL();
 void LoadGameResources();
@@ -215,12 +453,13 @@ void RenderScene(GLFWwindow* window, const glm::mat4& view, const glm::mat4& pro
 const glm::vec3 g_RodOffset = glm::vec3(-0.250f, -0.220f, 0.320f);
 glm::vec4 g_RodTip = glm::vec4(4.0f, 41.0f, 4.0f, 1.0f);
 
-// Função para calcular a posição da ponta da vara no mundo
-glm::vec3 GetRodTipPosition() {
-    float corrected_rotation = g_Boat.rotation_y + g_CameraTheta;
+// Função para calcular a posição da ponta da vara no mundo, a partir do barco
+// simulado (g_Boat) ou do desenhado (g_RenderBoat)
+glm::vec3 GetRodTipPosition(const Boat& boat) {
+    float corrected_rotation = boat.rotation_y + g_CameraTheta;
     
     // WATER_SURFACE_Y + 0.8f para altura dos olhos
-    glm::mat4 model = Matrix_Translate(g_Boat.position.x, g_Boat.position.y + WATER_SURFACE_Y + 0.8f, g_Boat.position.z)
+    glm::mat4 model = Matrix_Translate(boat.position.x, boat.position.y + WATER_SURFACE_Y + 0.8f, boat.position.z)
           * Matrix_Rotate_Y(corrected_rotation)
           * Matrix_Translate(g_RodOffset.x, g_RodOffset.y, g_RodOffset.z)
           * Matrix_Rotate_Y(-M_PI_2)
@@ -278,14 +517,14 @@ void FirstPersonCameraConfig (GLFWwindow* window) {
 
 // Função para configurar câmera primeira pessoa (Fase de Pesca)
 void SetupFirstPersonCamera(glm::mat4& view, glm::vec4& camera_position) {
-    float corrected_rotation = g_Boat.rotation_y + g_CameraTheta; 
+    float corrected_rotation = g_RenderBoat.rotation_y + g_CameraTheta; 
     
     float look_x = sin(corrected_rotation) * cos(g_CameraPhi);
     float look_y = -sin(g_CameraPhi);
     float look_z = cos(corrected_rotation) * cos(g_CameraPhi);
     
     // WATER_SURFACE_Y + 0.8f para altura dos olhos
-    glm::vec4 camera_position_c = glm::vec4(g_Boat.position.x, g_Boat.position.y + WATER_SURFACE_Y + 0.8f, g_Boat.position.z, 1.0f);
+    glm::vec4 camera_position_c = glm::vec4(g_RenderBoat.position.x, g_RenderBoat.position.y + WATER_SURFACE_Y + 0.8f, g_RenderBoat.position.z, 1.0f);
     
     camera_view_vector = glm::vec4(look_x, look_y, look_z, 0.0f);
     glm::vec4 camera_up_vector = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
@@ -305,14 +544,40 @@ void SetupDebugCamera(glm::mat4& view, glm::vec4& camera_position) {
     forward.z =  cos(yaw) * cos(pitch);
     forward = glm::normalize(forward);
 
-    camera_position = glm::vec4(g_DebugCameraPos, 1.0f);
+    camera_position = glm::vec4(g_RenderDebugCameraPos, 1.0f);
     camera_view_vector = glm::vec4(forward, 0.0f);
     glm::vec4 camera_up_vector = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
 
     view = Matrix_Camera_View(camera_position, camera_view_vector, camera_up_vector);
 }
 
-void UpdateGamePhysics(float deltaTime, GLFWwindow* window) {
+// O barco flutua na superfície da água: altura média e inclinação a partir de
+// quatro pontos do casco (proa, popa, bombordo e boreste), em uma consulta só
+static void UpdateBoatFloating() {
+    const float half_length = 0.8f;
+    const float half_width  = 0.4f;
+
+    // Frente do barco (sentido de W) e lado direito, no plano XZ
+    float forward_x = -sin(g_Boat.rotation_y), forward_z = -cos(g_Boat.rotation_y);
+    float right_x   =  cos(g_Boat.rotation_y), right_z   = -sin(g_Boat.rotation_y);
+
+    float x[4] = { g_Boat.position.x + forward_x * half_length, g_Boat.position.x - forward_x * half_length,
+                   g_Boat.position.x + right_x * half_width,    g_Boat.position.x - right_x * half_width };
+    float z[4] = { g_Boat.position.z + forward_z * half_length, g_Boat.position.z - forward_z * half_length,
+                   g_Boat.position.z + right_z * half_width,    g_Boat.position.z - right_z * half_width };
+    float h[4];
+    Water_Heights(x, z, 4, g_SimulationTime, h);
+
+    // position.y é o deslocamento em relação a WATER_SURFACE_Y
+    g_Boat.position.y = 0.25f * (h[0] + h[1] + h[2] + h[3]) - WATER_SURFACE_Y;
+    g_Boat.pitch = atan2(h[0] - h[1], 2.0f * half_length);
+    g_Boat.roll  = atan2(h[2] - h[3], 2.0f * half_width);
+}
+
+// Um passo da simulação, de deltaTime segundos
+static void StepGamePhysics(float deltaTime, GLFWwindow* window) {
+    g_SimulationTime += deltaTime;
+
     if (g_CurrentCamera == DEBUG_CAMERA) {
         float yaw = g_CameraTheta;
         glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -350,7 +615,6 @@ void UpdateGamePhysics(float deltaTime, GLFWwindow* window) {
         if (g_D_pressed) {
             g_Boat.rotation_y -= 2.0f * deltaTime;
         }
-        g_Boat.position.y = 0.0f;
         
         if (!IsValidBoatPosition(g_Boat.position)) {
             g_Boat.position = old_position;
@@ -393,7 +657,8 @@ void UpdateGamePhysics(float deltaTime, GLFWwindow* window) {
                 g_Bait.position += g_Bait.velocity * deltaTime;
                 
                 // Verificar se a isca atingiu a água
-                if (TestSpherePlane(g_Bait.position, g_Bait.radius, WATER_SURFACE_Y)) {
+                float water_y = Water_Height(g_Bait.position.x, g_Bait.position.z, g_SimulationTime);
+                if (TestSpherePlane(g_Bait.position, g_Bait.radius, water_y)) {
                     g_Bait.is_in_water = true;
                     g_Bait.velocity = glm::vec3(0.0f);
                     g_Bait.position.y = UNDERWATER_DEPTH;
@@ -429,6 +694,10 @@ void UpdateGamePhysics(float deltaTime, GLFWwindow* window) {
             g_Bait.velocity.z = control_velocity.z;
             g_Bait.velocity.y = 0.0f;
 
+            // A isca balança com as ondas, sempre à mesma profundidade
+            g_Bait.position.y = Water_Height(g_Bait.position.x, g_Bait.position.z, g_SimulationTime)
+                              + (UNDERWATER_DEPTH - WATER_SURFACE_Y);
+
             if (TestSphereSphere(g_Bait.position, g_Bait.radius, g_Fish.position, 0.2f)) {
                 printf("PEIXE CAPTURADO!\n");
                 g_CurrentGameState = NAVIGATION_PHASE;
@@ -439,21 +708,229 @@ void UpdateGamePhysics(float deltaTime, GLFWwindow* window) {
             }
         }
     }
+
+    UpdateBoatFloating();
+}
+
+void UpdateGamePhysics(float deltaTime, GLFWwindow* window) {
+    g_SimulationAccumulator += deltaTime;
+
+    int steps = 0;
+    while (g_SimulationAccumulator >= SIMULATION_STEP) {
+        if (steps == SIMULATION_MAX_STEPS) {
+            g_SimulationAccumulator = fmodf(g_SimulationAccumulator, SIMULATION_STEP);
+            break;
+        }
+
+        g_PreviousBoat = g_Boat;
+        g_PreviousFish = g_Fish;
+        g_PreviousBait = g_Bait;
+        g_PreviousDebugCameraPos = g_DebugCameraPos;
+
+        StepGamePhysics(SIMULATION_STEP, window);
+        g_SimulationAccumulator -= SIMULATION_STEP;
+        g_SimulationSteps++;
+        steps++;
+    }
+}
+
+// Menor diferença entre dois ângulos (radianos), em [-pi, pi]
+static float AngleDelta(float from, float to) {
+    float delta = fmodf(to - from + (float)M_PI, 2.0f * (float)M_PI);
+    if (delta < 0.0f)
+        delta += 2.0f * (float)M_PI;
+    return delta - (float)M_PI;
+}
+
+// Calcula o estado desenhado (g_Render*): interpolação entre o estado antes e
+// depois do último passo, na fração do passo que já se passou. A isca não é
+// interpolada quando muda de fase (lançada, na água, recolhida): nesse caso
+// ela "salta" de lugar, e é desenhada onde está.
+void InterpolateRenderState() {
+    g_RenderBoat = g_Boat;
+    g_RenderFish = g_Fish;
+    g_RenderBait = g_Bait;
+    g_RenderDebugCameraPos = g_DebugCameraPos;
+    g_RenderTime = g_SimulationTime;
+
+    if (g_SimulationSteps == 0)
+        return;
+
+    float alpha = g_SimulationAccumulator / SIMULATION_STEP;
+    float beta  = 1.0f - alpha;
+
+    g_RenderBoat.position   = glm::mix(g_PreviousBoat.position, g_Boat.position, alpha);
+    g_RenderBoat.rotation_y = g_Boat.rotation_y - beta * AngleDelta(g_PreviousBoat.rotation_y, g_Boat.rotation_y);
+    g_RenderBoat.pitch      = glm::mix(g_PreviousBoat.pitch, g_Boat.pitch, alpha);
+    g_RenderBoat.roll       = glm::mix(g_PreviousBoat.roll, g_Boat.roll, alpha);
+
+    g_RenderFish.position   = glm::mix(g_PreviousFish.position, g_Fish.position, alpha);
+    g_RenderFish.rotation_y = g_Fish.rotation_y - beta * AngleDelta(g_PreviousFish.rotation_y, g_Fish.rotation_y);
+
+    if (g_PreviousBait.is_launched == g_Bait.is_launched && g_PreviousBait.is_in_water == g_Bait.is_in_water)
+        g_RenderBait.position = glm::mix(g_PreviousBait.position, g_Bait.position, alpha);
+
+    g_RenderDebugCameraPos = glm::mix(g_PreviousDebugCameraPos, g_DebugCameraPos, alpha);
+    g_RenderTime = g_SimulationTime - beta * SIMULATION_STEP;
+}
+
+// Opções de linha de comando, impressas quando alguma é inválida
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+        "Uso: %s [opções] [arquivo.obj]\n"
+        "  --benchmark-normals    mede ComputeNormals() e encerra (sem janela)\n"
+        "  --benchmark-submit     mede FlushRenderQueue() (precisa da cena carregada)\n"
+        "  --multi-draw           usa o backend de desenho indireto (multi_draw.h)\n"
+        "  --headless[=LxA]       sem janela visível, em um framebuffer de LxA pixels\n"
+        "  --frames N             no modo headless, encerra depois de N quadros\n"
+        "  --timing-csv ARQUIVO   grava os tempos de cada quadro (frame_timing.h)\n"
+        "  --record ARQUIVO       grava a entrada do jogador (input_record.h)\n"
+        "  --replay ARQUIVO       reproduz uma gravação e encerra ao fim dela\n"
+        "  arquivo.obj            modelo extra carregado na cena\n",
+        program);
+}
+
+// Valor da opção argv[*i], que ocupa o argumento seguinte. NULL (com a
+// mensagem de erro já impressa) se ele faltar ou for outra opção.
+static const char* OptionValue(int argc, char* argv[], int* i)
+{
+    if ( *i + 1 >= argc || strncmp(argv[*i + 1], "--", 2) == 0 )
+    {
+        fprintf(stderr, "ERROR: a opção %s precisa de um valor.\n", argv[*i]);
+        return NULL;
+    }
+    *i += 1;
+    return argv[*i];
 }
 
 int main(int argc, char* argv[])
 {
-    GLFWwindow* window = InitializeWindow();
+    // Opções: veja PrintUsage()
+    bool benchmark_normals = false;
+    bool benchmark_submit = false;
+    bool headless = false;
+    int headless_width = 1000, headless_height = 800;
+    int headless_frames = 0;
+    const char* model_filename = NULL;
+    const char* timing_csv = NULL;
+    const char* record_filename = NULL;
+    const char* replay_filename = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* value = NULL;
+        if ( strcmp(argv[i], "--benchmark-normals") == 0 )
+            benchmark_normals = true;
+        else if ( strcmp(argv[i], "--benchmark-submit") == 0 )
+        {
+            // Compara os dois caminhos de envio
+            benchmark_submit = true;
+            g_MultiDrawRequested = true;
+        }
+        else if ( strcmp(argv[i], "--multi-draw") == 0 )
+            g_MultiDrawRequested = true;
+        else if ( strcmp(argv[i], "--headless") == 0 )
+            headless = true;
+        else if ( strncmp(argv[i], "--headless=", 11) == 0 )
+        {
+            headless = true;
+            if ( !Headless_ParseSize(argv[i] + 11, &headless_width, &headless_height) )
+            {
+                fprintf(stderr, "ERROR: tamanho inválido \"%s\" (esperado LARGURAxALTURA).\n", argv[i] + 11);
+                PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if ( strcmp(argv[i], "--frames") == 0 )
+        {
+            if ( (value = OptionValue(argc, argv, &i)) == NULL )
+            {
+                PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+
+            char* end = NULL;
+            errno = 0;
+            long frames = strtol(value, &end, 10);
+            if ( end == value || *end != '\0' || errno != 0 || frames <= 0 || frames > INT_MAX )
+            {
+                fprintf(stderr, "ERROR: número de quadros inválido \"%s\" (esperado um inteiro positivo).\n", value);
+                PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            headless_frames = (int)frames;
+        }
+        else if ( strcmp(argv[i], "--timing-csv") == 0 || strcmp(argv[i], "--record") == 0 || strcmp(argv[i], "--replay") == 0 )
+        {
+            const char* option = argv[i];
+            if ( (value = OptionValue(argc, argv, &i)) == NULL )
+            {
+                PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+
+            if ( strcmp(option, "--timing-csv") == 0 )
+                timing_csv = value;
+            else if ( strcmp(option, "--record") == 0 )
+                record_filename = value;
+            else
+                replay_filename = value;
+        }
+        else if ( strncmp(argv[i], "--", 2) == 0 )
+        {
+            fprintf(stderr, "ERROR: opção desconhecida \"%s\".\n", argv[i]);
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if ( Headless_ParseSize(argv[i], &headless_width, &headless_height) )
+        {
+            // Ex. "--headless 800x600": o tamanho não é um arquivo de modelo
+            fprintf(stderr, "ERROR: \"%s\" não é um arquivo de modelo; para o tamanho use --headless=%s.\n", argv[i], argv[i]);
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else if ( model_filename != NULL )
+        {
+            fprintf(stderr, "ERROR: mais de um arquivo de modelo (\"%s\" e \"%s\").\n", model_filename, argv[i]);
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else
+            model_filename = argv[i];
+    }
+
+    // Modo de linha de comando que não abre janela
+    if ( benchmark_normals )
+        return BenchmarkComputeNormals();
+
+    // Sem entrada do usuário a janela invisível nunca é fechada (uma
+    // reprodução termina sozinha)
+    if ( headless && headless_frames <= 0 && replay_filename == NULL )
+        headless_frames = 1000;
+
+    GLFWwindow* window = headless ? InitializeWindow(headless_width, headless_height, false)
+                                  : InitializeWindow(1000, 800, true);
 
     SetupCallbacks(window);
 
+    // O framebuffer do modo headless é ligado antes de qualquer recurso ser
+    // criado: GLExtensions_Init() verifica se ele é sRGB
+    if ( headless )
+    {
+        if ( !Headless_Init(headless_width, headless_height, headless_frames) )
+        {
+            glfwTerminate();
+            return EXIT_FAILURE;
+        }
+        FramebufferSizeCallback(window, headless_width, headless_height);
+    }
+
     LoadGameResources();
     InitializeRodSystem();
 
-    if ( argc > 1 )
+    if ( model_filename != NULL )
     {
-        ObjModel model(argv[1]);
-        BuildTrianglesAndAddToVirtualScene(&model);
+        LoadModelToVirtualScene(model_filename);
     }
 
     // Inicializamos o código para renderização de texto.
@@ -472,8 +949,25 @@ int main(int argc, char* argv[])
     // =====================================================================
     InitializeGameState();
 
+    int exit_code = 0;
+    if ( benchmark_submit )
+        exit_code = BenchmarkRenderSubmit(window);
+    else if ( timing_csv != NULL )
+        FrameTiming_StartCsv(timing_csv);
+
+    if ( !benchmark_submit && replay_filename != NULL )
+    {
+        if ( !InputRecord_StartReplay(window, replay_filename) )
+            exit_code = EXIT_FAILURE;
+    }
+    else if ( !benchmark_submit && record_filename != NULL )
+    {
+        if ( !InputRecord_StartRecording(window, record_filename) )
+            exit_code = EXIT_FAILURE;
+    }
+
     // Ficamos em um loop infinito, renderizando, até que o usuário feche a janela
-    while (!glfwWindowShouldClose(window))
+    while (!benchmark_submit && exit_code == 0 && !glfwWindowShouldClose(window))
     {
         // Calcular deltaTime para animações baseadas em tempo
         static float last_time = 0.0f;
@@ -481,7 +975,15 @@ int main(int argc, char* argv[])
         float deltaTime = current_time - last_time;
         last_time = current_time;
 
+        // Numa reprodução, o passo de tempo é o da sessão gravada
+        if ( !InputRecord_BeginFrame(&deltaTime) )
+            break;
+
+        FrameTiming_BeginFrame();
+
+        FrameTiming_BeginPass(TIMING_PHYSICS);
         UpdateGamePhysics(deltaTime, window);
+        FrameTiming_EndPass(TIMING_PHYSICS);
 
      
         glClearColor(0.1f, 0.3f, 0.6f, 1.0f);
@@ -489,10 +991,6 @@ int main(int argc, char* argv[])
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-        // os shaders de vértice e fragmentos).
-        glUseProgram(g_GpuProgramID);
-
 
         // =====================================================================
         // Configurar câmera baseada no tipo de câmera ativo
@@ -512,41 +1010,100 @@ int main(int argc, char* argv[])
         // chamada abaixo faz a troca dos buffers, mostrando para o usuário
         // tudo que foi renderizado pelas funções acima.
         // Veja o link: https://en.wikipedia.org/w/index.php?title=Multiple_buffering&oldid=793452829#Double_buffering_in_computer_graphics
-        glfwSwapBuffers(window);
+        //
+        // No modo headless nada é mostrado: o quadro fica no framebuffer de
+        // headless.h, e a janela é fechada ao fim do número de quadros pedido.
+        FrameTiming_BeginPass(TIMING_SWAP);
+        if ( headless )
+        {
+            if ( Headless_EndFrame() )
+                glfwSetWindowShouldClose(window, GL_TRUE);
+        }
+        else
+        {
+            glfwSwapBuffers(window);
+        }
+        FrameTiming_EndPass(TIMING_SWAP);
 
         // Verificamos com o sistema operacional se houve alguma interação do
         // usuário (teclado, mouse, ...). Caso positivo, as funções de callback
         // definidas anteriormente usando glfwSet*Callback() serão chamadas
         // pela biblioteca GLFW.
         glfwPollEvents();
+        InputRecord_EndFrame();
     }
 
+    if ( headless && !benchmark_submit )
+        Headless_PrintSummary();
+
+    InputRecord_Stop();
+
+    // Liberamos modelos e texturas ainda carregados antes de destruir o contexto
+    FrameTiming_Destroy();
+    AssetRegistry_ReleaseAll();
+    Terrain_Destroy(&g_Terrain);
+    Water_Destroy();
+    Occlusion_Destroy();
+    TransientBuffer_Destroy();
+    UniformBuffers_Destroy();
+    Headless_Destroy();
+
     // Finalizamos o uso dos recursos do sistema operacional
     glfwTerminate();
 
     // Fim do programa
-    return 0;
+    return exit_code;
 }
 
-// Função que carrega uma imagem para ser utilizada como textura
-void LoadTextureImage(const char* filename)
+// Função que carrega uma imagem para ser utilizada como textura. A leitura do
+// disco é feita pelo pipeline de carregamento (veja asset_loader.h), em uma
+// thread do pool; o envio para a GPU é feito em UploadTextureImage(). Uma
+// imagem já carregada não é lida de novo: apenas ganha mais uma referência.
+TextureHandle LoadTextureImage(const char* filename)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    // A unidade de textura é reservada pelo registro já na submissão, para que
+    // a ordem das texturas não dependa da ordem em que as threads terminam.
+    bool is_new;
+    TextureHandle handle = AssetRegistry_AcquireTexture(filename, &is_new);
+    if ( !is_new )
+        return handle;
+
+    std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+    std::string path(filename);
+
+    // Como em LoadModelToVirtualScene(): se a submissão síncrona falhar, a
+    // entrada do registro (e sua unidade de textura) é liberada.
+    try {
+        AssetLoader_Submit(filename,
+            [image, path]() {
+                // Primeiro fazemos a leitura da imagem do disco
+                if ( !DecodeImageFile(path.c_str(), true, 3, image.get()) )
+                {
+                    fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", path.c_str());
+                    throw std::runtime_error("Erro ao carregar imagem.");
+                }
+            },
+            [image, handle]() {
+                TextureAsset* texture = AssetRegistry_GetTexture(handle);
+                if ( texture != NULL )
+                    UploadTextureImage(*image, texture);
+                FreeDecodedImage(image.get());
+            });
+    } catch (...) {
+        AssetRegistry_ReleaseTexture(handle);
+        throw;
+    }
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+    return handle;
+}
 
-    if ( data == NULL )
-    {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
+// Envia uma imagem já decodificada para a GPU, na unidade de textura reservada
+// para "texture" no registro de recursos
+void UploadTextureImage(const DecodedImage& image, TextureAsset* texture)
+{
+    printf("Carregando imagem \"%s\"... OK (%dx%d).\n", texture->path.c_str(), image.width, image.height);
 
-    printf("OK (%dx%d).\n", width, height);
+    GLuint textureunit = texture->texture_unit;
 
     // Agora criamos objetos na GPU com OpenGL para armazenar a textura
     GLuint texture_id;
@@ -568,92 +1125,598 @@ void LoadTextureImage(const char* filename)
     glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
     glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 
-    GLuint textureunit = g_NumLoadedTextures;
     glActiveTexture(GL_TEXTURE0 + textureunit);
     glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
     glGenerateMipmap(GL_TEXTURE_2D);
     glBindSampler(textureunit, sampler_id);
 
-    stbi_image_free(data);
+    texture->texture_id = texture_id;
+    texture->sampler_id = sampler_id;
+    texture->loaded     = true;
+}
 
-    g_NumLoadedTextures += 1;
+// Escolhe o nível de detalhe de um desenho de "object" com a matriz "model".
+// O erro geométrico de cada LOD (espaço do objeto) é convertido para pixels
+// usando a escala da matriz "model" e o tamanho projetado de uma unidade à
+// distância do objeto; usamos o LOD mais grosseiro cujo erro fica abaixo de
+// g_LodMaxPixelError.
+int SelectLod(const DrawRecord& object, LodState& state, const glm::mat4& model)
+{
+    if (state.lod_frame != g_FrameNumber)
+    {
+        state.lod_frame = g_FrameNumber;
+        state.lod_draws = 0;
+    }
+    size_t instance = state.lod_draws++;
+    if (instance >= state.lod_state.size())
+        state.lod_state.push_back(0);
+    int& current = state.lod_state[instance];
+
+    if (object.num_lods <= 1 || !g_LodEnabled)
+        return current = 0;
+
+    // Esfera envolvente da bounding box, no sistema de coordenadas da câmera.
+    // Todas as instâncias de um objeto usam o mesmo LOD, escolhido pela mais
+    // próxima possível e pela maior escala.
+    glm::vec3 center = 0.5f * (object.bounds_min + object.bounds_max);
+    float radius = 0.5f * glm::length(object.bounds_max - object.bounds_min);
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    radius = radius * scale;
+    scale  = scale * object.instance_scale;
+    glm::vec4 center_view = g_CameraView * model * glm::vec4(center, 1.0f);
+
+    // Distância até o ponto mais próximo da esfera (câmera dentro: LOD 0)
+    float distance = glm::length(glm::vec3(center_view)) - radius;
+    if (distance <= 0.1f)
+        return current = 0;
+
+    float pixels_per_unit = std::fabs(g_CameraProjection[1][1]) * 0.5f * g_FramebufferHeight / distance;
+
+    int visible_limit = 0;    // LOD mais grosseiro com erro aceitável
+    int hysteresis_limit = 0; // O mesmo, com a folga para trocar para LODs mais grosseiros
+    for (int lod = 1; lod < object.num_lods; ++lod)
+    {
+        float error_pixels = object.lods[lod].error * scale * pixels_per_unit;
+        if (error_pixels <= g_LodMaxPixelError)
+            visible_limit = lod;
+        if (error_pixels <= g_LodMaxPixelError * LOD_HYSTERESIS)
+            hysteresis_limit = lod;
+    }
+
+    if (current > visible_limit)
+        current = visible_limit;       // Erro ficaria visível: refinamos imediatamente
+    else if (hysteresis_limit > current)
+        current = hysteresis_limit;
+
+    return current;
 }
 
-// Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
-// dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char* object_name)
+// Retorna o handle do objeto de nome "name", ou INVALID_SCENE_OBJECT. Deve
+// ser usada no carregamento ou quando g_VirtualSceneRevision mudar, nunca a
+// cada desenho.
+SceneObjectHandle FindSceneObject(const std::string& name)
 {
+    std::map<std::string, SceneObjectHandle>::const_iterator it = g_VirtualScene.find(name);
+    return it != g_VirtualScene.end() ? it->second : INVALID_SCENE_OBJECT;
+}
+
+// Função que desenha um objeto da cena virtual, com a matriz de modelagem
+// "model". O nível de detalhe é escolhido por SelectLod(). Handles inválidos
+// ou de objetos já descarregados são ignorados.
+void DrawVirtualObject(SceneObjectHandle handle, const glm::mat4& model)
+{
+    if (handle < 0 || handle >= (SceneObjectHandle)g_DrawRecords.size())
+        return;
+
+    const DrawRecord& object = g_DrawRecords[handle];
+    if (object.num_lods == 0)
+        return;
+
+    // Matriz "model", bounding box e cor do material já estão no trecho de
+    // ObjectUniforms ligado por FlushRenderQueue() (veja uniform_buffers.h).
+    // O VAO passa pelo cache de render_queue.h: se for o mesmo do desenho
+    // anterior, não é ligado de novo.
     // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
-    // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
-    // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
-
-    // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
-    // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(g_bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(g_bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
-
-    // Setamos a cor do material do arquivo .mtl
-    glm::vec3 material_kd = g_VirtualScene[object_name].material_kd;
-    glUniform3f(g_material_kd_uniform, material_kd.x, material_kd.y, material_kd.z);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
+    // vértices apontados pelo VAO criado pela função AddMeshToVirtualScene(). Veja
+    // comentários detalhados dentro da definição de AddMeshToVirtualScene().
+    RenderState_BindVertexArray(object.vertex_array_object_id);
+
+    const MeshLod& lod = object.lods[SelectLod(object, g_LodStates[handle], model)];
+
+    // Pedimos para a GPU rasterizar os vértices do nível de detalhe escolhido,
+    // apontados pelo VAO, com o modo do objeto (rendering_mode). Veja os
+    // índices de cada nível em BuildMeshData(), e veja
     // a documentação da função glDrawElements() em
     // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void*)(g_VirtualScene[object_name].first_index * sizeof(GLuint))
-    );
+    if (object.num_instances > 0)
+    {
+        glDrawElementsInstanced(
+            object.rendering_mode,
+            lod.num_indices,
+            GL_UNSIGNED_INT,
+            (void*)(lod.first_index * sizeof(GLuint)),
+            object.num_instances
+        );
+
+        // Após um desenho com os atributos de instância habilitados, o valor
+        // corrente deles fica indefinido para os próximos VAOs
+        VertexFormat_ResetInstanceAttributes();
+    }
+    else
+    {
+        glDrawElements(
+            object.rendering_mode,
+            lod.num_indices,
+            GL_UNSIGNED_INT,
+            (void*)(lod.first_index * sizeof(GLuint))
+        );
+    }
+    RenderState_CountDraw();
+}
+
+// Enfileira um desenho que já passou pelo culling (veja SubmitVirtualObject()).
+// "occlusion_query", se não for 0, condiciona o desenho (veja occlusion.h).
+static void EnqueueVirtualObject(SceneObjectHandle handle, const glm::mat4& model, int object_id, int pass, GLuint occlusion_query = 0)
+{
+    const DrawRecord& object = g_DrawRecords[handle];
+
+    glm::vec3 center = 0.5f * (object.bounds_min + object.bounds_max);
+    glm::vec4 center_view = g_CameraView * model * glm::vec4(center, 1.0f);
+
+    RenderPacket packet;
+    packet.program_id = GpuProgramForObject(object_id);
+    packet.vertex_array_object_id = object.vertex_array_object_id;
+    packet.scene_object = handle;
+    packet.model = model;
+    packet.occlusion_query = occlusion_query;
+    packet.sort_key = RenderQueue_MakeKey(pass, packet.program_id, packet.vertex_array_object_id,
+        -center_view.z, (uint32_t)g_RenderQueue.packets.size());
+    RenderQueue_Submit(&g_RenderQueue, packet);
+}
+
+// Enfileira um desenho de "handle" com a matriz "model" e o valor "object_id"
+// do shader, se a caixa envolvente do objeto (com todas as instâncias) tocar
+// o frustum da câmera do quadro atual. A profundidade usada na ordenação é a
+// do centro da caixa na câmera (g_CameraView).
+void SubmitVirtualObject(SceneObjectHandle handle, const glm::mat4& model, int object_id, int pass)
+{
+    if (handle < 0 || handle >= (SceneObjectHandle)g_DrawRecords.size())
+        return;
+
+    const DrawRecord& object = g_DrawRecords[handle];
+    if (object.num_lods == 0)
+        return;
+
+    if (g_FrustumCullingEnabled)
+    {
+        glm::vec3 world_min, world_max;
+        Culling_TransformBox(model, object.bounds_min, object.bounds_max, &world_min, &world_max);
+
+        unsigned int plane_mask = CULL_ALL_PLANES;
+        if (Culling_TestBox(g_CameraFrustum, world_min, world_max, &plane_mask) == CULL_OUTSIDE)
+        {
+            g_CullingStats.culled += 1;
+            return;
+        }
+    }
+
+    g_CullingStats.visible += 1;
+    EnqueueVirtualObject(handle, model, object_id, pass);
+}
+
+// Preenche os dados de shader de um pacote (bloco "ObjectUniforms")
+static void FillObjectUniforms(const RenderPacket& packet, ObjectUniforms* uniforms)
+{
+    const DrawRecord& object = g_DrawRecords[packet.scene_object];
+
+    memset(uniforms, 0, sizeof(ObjectUniforms));
+    uniforms->model    = packet.model;
+
+    // Matriz das normais, calculada aqui uma vez por desenho em vez de em
+    // cada vértice (veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf)
+    uniforms->normal_matrix = glm::inverseTranspose(packet.model);
+    uniforms->bbox_min = glm::vec4(object.bbox_min, 1.0f);
+    uniforms->bbox_max = glm::vec4(object.bbox_max, 1.0f);
+
+    // Cor do material do arquivo .mtl. Objetos com vários materiais (e lotes
+    // estáticos) trazem a cor no VBO (atributo 3); w indica ao shader qual usar.
+    uniforms->material_kd = glm::vec4(object.material_kd, object.vertex_colors ? 1.0f : 0.0f);
+}
+
+// Desenha os pacotes order[begin..end) da fila, todos com o mesmo VAO, com
+// o backend indireto (o programa já deve estar ligado): um
+// glMultiDrawElementsIndirect() no lugar de um glDrawElements() por pacote,
+// com os dados de cada desenho no lote em vez de no anel de ObjectUniforms.
+static void DrawVirtualObjectsIndirect(size_t begin, size_t end)
+{
+    const RenderPacket& first = g_RenderQueue.packets[g_RenderQueue.order[begin]];
+    RenderState_BindVertexArray(first.vertex_array_object_id);
+
+    GLenum mode = GL_TRIANGLES;
+    size_t batched = 0;
+    bool instanced = false;
+    for (size_t i = begin; i < end; ++i)
+    {
+        const RenderPacket& packet = g_RenderQueue.packets[g_RenderQueue.order[i]];
+        const DrawRecord& object = g_DrawRecords[packet.scene_object];
+        if (object.num_lods == 0)
+            continue;
+
+        // Um lote só tem um modo de rasterização
+        if (batched > 0 && object.rendering_mode != mode)
+        {
+            MultiDraw_Flush(mode);
+            batched = 0;
+        }
+        mode = object.rendering_mode;
+
+        const MeshLod& lod = object.lods[SelectLod(object, g_LodStates[packet.scene_object], packet.model)];
+        ObjectUniforms uniforms;
+        FillObjectUniforms(packet, &uniforms);
+        MultiDraw_Add(uniforms, (GLuint)lod.num_indices, (GLuint)lod.first_index, object.num_instances);
+        batched += 1;
+        instanced = instanced || object.num_instances > 0;
+    }
+    MultiDraw_Flush(mode);
+
+    if (instanced)
+        VertexFormat_ResetInstanceAttributes();
+}
+
+// Desenha os pacotes enfileirados por SubmitVirtualObject() na ordem das
+// chaves: opacos sem blending, depois transparentes com blending (que fica
+// ligado, como esperam a linha de pesca e o texto desenhados em seguida).
+//
+// Os dados de todos os pacotes são enviados de uma vez para o anel de
+// ObjectUniforms; cada desenho só liga o seu trecho. Pacotes seguidos com
+// dados idênticos (ex. o mesmo objeto em vários VAOs) reaproveitam a entrada
+// anterior, e o cache de estado evita até o glBindBufferRange().
+//
+// Com g_MultiDrawEnabled, os opacos sem consulta de oclusão não passam pelo
+// anel: cada sequência deles com o mesmo programa e VAO (vizinhos pela chave)
+// vira um único desenho indireto (veja DrawVirtualObjectsIndirect()).
+void FlushRenderQueue()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RenderQueue_Sort(&g_RenderQueue);
+
+    size_t count = g_RenderQueue.order.size();
+
+    // Programa indireto de cada pacote desenhado pelo backend indireto (0: caminho 3.3)
+    std::vector<GLuint>& indirect_program = g_RenderQueueIndirectPrograms;
+    indirect_program.assign(count, 0);
+    if (g_MultiDrawEnabled)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const RenderPacket& packet = g_RenderQueue.packets[g_RenderQueue.order[i]];
+            if (RenderQueue_Pass(packet) == RENDER_PASS_OPAQUE && packet.occlusion_query == 0)
+                indirect_program[i] = IndirectGpuProgram(packet.program_id);
+        }
+    }
+
+    std::vector<size_t>& entry = g_RenderQueueObjectEntries;
+    entry.resize(count);
+    ObjectUniforms* objects = UniformBuffers_BeginObjects(count);
+    size_t num_objects = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (indirect_program[i] != 0)
+            continue;
+
+        ObjectUniforms* uniforms = &objects[num_objects];
+        FillObjectUniforms(g_RenderQueue.packets[g_RenderQueue.order[i]], uniforms);
+        if (num_objects > 0 && memcmp(uniforms, uniforms - 1, sizeof(ObjectUniforms)) == 0)
+        {
+            entry[i] = num_objects - 1;
+            continue;
+        }
+        entry[i] = num_objects++;
+    }
+    UniformBuffers_UploadObjects(num_objects);
+
+    // Outros códigos (skybox, texto, linha de pesca) alteram o estado sem
+    // passar pelo cache
+    RenderState_Invalidate();
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    for (size_t i = 0; i < g_RenderQueue.order.size(); ++i)
+    {
+        const RenderPacket& packet = g_RenderQueue.packets[g_RenderQueue.order[i]];
+
+        RenderState_SetBlend(RenderQueue_Pass(packet) == RENDER_PASS_TRANSPARENT);
+
+        if (indirect_program[i] != 0)
+        {
+            size_t end = i + 1;
+            while (end < count && indirect_program[end] == indirect_program[i]
+                && g_RenderQueue.packets[g_RenderQueue.order[end]].vertex_array_object_id == packet.vertex_array_object_id)
+                ++end;
+
+            RenderState_UseProgram(indirect_program[i]);
+            DrawVirtualObjectsIndirect(i, end);
+            i = end - 1;
+            continue;
+        }
+
+        RenderState_UseProgram(packet.program_id);
+
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+        UniformBuffers_ObjectRange(entry[i], &buffer, &offset, &size);
+        RenderState_BindBufferRange(UNIFORM_BINDING_OBJECT, buffer, offset, size);
+
+        // Objetos ocultos no quadro anterior são descartados pela GPU, sem
+        // esperar pelo resultado da consulta
+        if (packet.occlusion_query != 0)
+        {
+            glBeginConditionalRender(packet.occlusion_query, GL_QUERY_NO_WAIT);
+            DrawVirtualObject(packet.scene_object, packet.model);
+            glEndConditionalRender();
+        }
+        else
+        {
+            DrawVirtualObject(packet.scene_object, packet.model);
+        }
+    }
 
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
     // alterar o mesmo. Isso evita bugs.
     glBindVertexArray(0);
+    RenderState_Invalidate();
+    RenderQueue_Clear(&g_RenderQueue);
+
+    g_FlushRenderQueueMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Insere as linhas "defines" logo após a diretiva "#version" (que precisa ser
+// a primeira linha do código GLSL)
+static std::string InjectShaderDefines(const std::string& source, const std::string& defines)
+{
+    size_t line_end = source.find('\n');
+    if (source.compare(0, 8, "#version") != 0 || line_end == std::string::npos)
+        return defines + source;
+    return source.substr(0, line_end + 1) + defines + source.substr(line_end + 1);
 }
 
 // Função que carrega os shaders de vértices e de fragmentos que serão
 // utilizados para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
 //
+// Cada variante de g_ShaderVariants vira um programa próprio.
 void LoadShadersFromFiles()
 {
-    GLuint vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    GLuint fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
-
-    // Deletamos o programa de GPU anterior, caso ele exista.
-    if ( g_GpuProgramID != 0 )
-        glDeleteProgram(g_GpuProgramID);
-
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    g_GpuProgramID = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
-
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-    // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
-    g_model_uniform      = glGetUniformLocation(g_GpuProgramID, "model"); // Variável da matriz "model"
-    g_view_uniform       = glGetUniformLocation(g_GpuProgramID, "view"); // Variável da matriz "view" em shader_vertex.glsl
-    g_projection_uniform = glGetUniformLocation(g_GpuProgramID, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    g_object_id_uniform  = glGetUniformLocation(g_GpuProgramID, "object_id"); // Variável "object_id" em shader_fragment.glsl
-    g_bbox_min_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_min");
-    g_bbox_max_uniform   = glGetUniformLocation(g_GpuProgramID, "bbox_max");
-    g_material_kd_uniform = glGetUniformLocation(g_GpuProgramID, "material_kd"); // Cor difusa do material
-
-    // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
-    glUseProgram(g_GpuProgramID);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "BoatTexture"), 0);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "FishTexture"), 1);
-    glUniform1i(glGetUniformLocation(g_GpuProgramID, "CubeTexture"), 2);
+    const char* vertex_filename   = "../../src/shader_vertex.glsl";
+    const char* fragment_filename = "../../src/shader_fragment.glsl";
+
+    // Lemos as fontes antes de compilar: se um binário do programa com estas
+    // mesmas fontes já estiver em disco (veja program_cache.h), não há nada
+    // para compilar nem linkar.
+    std::string vertex_source   = ShaderProgram_ReadFile(vertex_filename);
+    std::string fragment_source = ShaderProgram_ReadFile(fragment_filename);
+
+    // Sem framebuffer sRGB a correção gamma volta para o fragment shader
+    std::string common_defines;
+    if ( !g_GLExtensions.srgb_framebuffer )
+        common_defines = "#define GAMMA_CORRECT_OUTPUT\n";
+
+    // Com o backend indireto (veja multi_draw.h) cada variante é compilada
+    // também com MULTI_DRAW_INDIRECT, em g_GpuProgramsIndirect
+    const char* indirect_defines =
+        "#extension GL_ARB_shader_draw_parameters : require\n"
+        "#extension GL_ARB_shader_storage_buffer_object : require\n"
+        "#define MULTI_DRAW_INDIRECT\n";
+    int num_program_sets = MultiDrawAvailable() ? 2 : 1;
+
+    for (int program_set = 0; program_set < num_program_sets; ++program_set)
+    for (int variant = 0; variant < NUM_SHADER_VARIANTS; ++variant)
+    {
+        bool indirect = ( program_set == 1 );
+        GLuint* programs = indirect ? g_GpuProgramsIndirect : g_GpuPrograms;
+
+        std::string defines = (indirect ? indirect_defines : "") + std::string(g_ShaderVariants[variant].defines) + common_defines;
+        std::string variant_vertex_source   = InjectShaderDefines(vertex_source, defines);
+        std::string variant_fragment_source = InjectShaderDefines(fragment_source, defines);
+
+        // Criamos um programa de GPU com as fontes da variante (ou o
+        // carregamos do cache, veja shader_program.h)
+        std::string name = std::string(indirect ? "shader_main_indirect_" : "shader_main_") + g_ShaderVariants[variant].name;
+        GLuint program_id = ShaderProgram_Create(name.c_str(),
+            vertex_filename, variant_vertex_source.c_str(),
+            fragment_filename, variant_fragment_source.c_str());
+
+        // Deletamos o programa de GPU anterior, caso ele exista.
+        if ( programs[variant] != 0 )
+            glDeleteProgram(programs[variant]);
+
+        programs[variant] = program_id;
+
+        // As matrizes, a bounding box e a cor estão nos blocos
+        // "FrameUniforms" e "ObjectUniforms" dos shaders. Ligamos os blocos aos
+        // uniform buffers (veja uniform_buffers.h); a ligação é estado do
+        // programa e precisa ser refeita também para programas vindos do cache.
+        UniformBuffers_BindBlocks(program_id);
+        if ( indirect )
+            MultiDraw_BindBlocks(program_id);
+
+        // Variáveis em "shader_fragment.glsl" para acesso das imagens de
+        // textura (cada variante declara no máximo uma delas)
+        glUseProgram(program_id);
+        glUniform1i(glGetUniformLocation(program_id, "BoatTexture"), 0);
+        glUniform1i(glGetUniformLocation(program_id, "FishTexture"), 1);
+        glUniform1i(glGetUniformLocation(program_id, "CubeTexture"), 2);
+    }
     glUseProgram(0);
+
+    // Objetos não instanciados usam a identidade como transformação de instância
+    VertexFormat_ResetInstanceAttributes();
 }
 
 // Função que computa as normais de um ObjModel, caso elas não tenham sido
 // especificadas dentro do arquivo ".obj"
-void ComputeNormals(ObjModel* model)
+//
+// A normal de cada vértice é calculada pelo método proposto por Gouraud: a
+// média das normais de todas as faces que compartilham este vértice e que
+// pertencem ao mesmo "smoothing group". Cada par (vértice, smoothing group)
+// distinto vira uma normal em attrib.normals.
+//
+// Tudo é feito em uma única passada pelos triângulos, em tempo linear: o par
+// (vértice, grupo) é mapeado para uma posição ("slot") de um vetor plano de
+// acumuladores. O primeiro grupo visto em cada vértice usa um vetor indexado
+// pelo vértice; apenas vértices que aparecem em mais de um grupo (bordas entre
+// grupos) passam pela tabela hash. Com num_threads > 1 as normais das faces são
+// calculadas em paralelo, dividindo os triângulos em intervalos.
+void ComputeNormals(ObjModel* model, unsigned int num_threads)
+{
+    if ( !model->attrib.normals.empty() )
+        return;
+
+    // Numeração global dos triângulos: os de "shape" começam em first_triangle[shape]
+    std::vector<size_t> first_triangle(model->shapes.size() + 1, 0);
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
+        assert(model->shapes[shape].mesh.smoothing_group_ids.size() == num_triangles);
+        first_triangle[shape + 1] = first_triangle[shape] + num_triangles;
+    }
+    size_t total_triangles = first_triangle.back();
+
+    // Primeiro computamos as normais para todos os TRIÂNGULOS (não
+    // normalizadas: o módulo é proporcional à área do triângulo).
+    std::vector<glm::vec4> face_normals(total_triangles);
+    auto compute_face_normals = [&](size_t begin, size_t end)
+    {
+        size_t shape = std::upper_bound(first_triangle.begin(), first_triangle.end(), begin) - first_triangle.begin() - 1;
+        for (size_t t = begin; t < end; ++t)
+        {
+            while (t >= first_triangle[shape + 1])
+                ++shape;
+
+            const tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+            size_t triangle = t - first_triangle[shape];
+            assert(mesh.num_face_vertices[triangle] == 3);
+
+            glm::vec4  vertices[3];
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                tinyobj::index_t idx = mesh.indices[3*triangle + vertex];
+                const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
+                const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
+                const float vz = model->attrib.vertices[3*idx.vertex_index + 2];
+                vertices[vertex] = glm::vec4(vx,vy,vz,1.0);
+            }
+
+            const glm::vec4  a = vertices[0];
+            const glm::vec4  b = vertices[1];
+            const glm::vec4  c = vertices[2];
+
+            face_normals[t] = crossproduct(b-a,c-a);
+        }
+    };
+
+    if (num_threads <= 1 || total_triangles < 4096)
+    {
+        compute_face_normals(0, total_triangles);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        size_t chunk = (total_triangles + num_threads - 1) / num_threads;
+        for (size_t begin = 0; begin < total_triangles; begin += chunk)
+            threads.push_back(std::thread(compute_face_normals, begin, std::min(begin + chunk, total_triangles)));
+        for (size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+    }
+
+    // Segundo, acumulamos as normais das faces em um slot por par (vértice, grupo)
+    const unsigned int no_slot = std::numeric_limits<unsigned int>::max();
+    size_t num_vertices = model->attrib.vertices.size() / 3;
+
+    std::vector<unsigned int> primary_slot(num_vertices, no_slot); // Slot do primeiro grupo visto no vértice
+    std::vector<unsigned int> primary_group(num_vertices, 0);
+    std::unordered_map<unsigned long long, unsigned int> other_slots; // Demais grupos, chave (vértice << 32 | grupo)
+
+    std::vector<glm::vec4> slot_normals;
+    std::vector<int>       slot_num_triangles;
+    std::vector<unsigned int> corner_slots(3*total_triangles);
+    slot_normals.reserve(num_vertices);
+    slot_num_triangles.reserve(num_vertices);
+
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        const tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        size_t num_triangles = mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            size_t t = first_triangle[shape] + triangle;
+            unsigned int sgroup = mesh.smoothing_group_ids[triangle];
+
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+            {
+                size_t vertex_index = (size_t)mesh.indices[3*triangle + vertex].vertex_index;
+                unsigned int slot = primary_slot[vertex_index];
+
+                if (slot == no_slot)
+                {
+                    slot = (unsigned int)slot_normals.size();
+                    primary_slot[vertex_index]  = slot;
+                    primary_group[vertex_index] = sgroup;
+                    slot_normals.push_back(glm::vec4(0.0f,0.0f,0.0f,0.0f));
+                    slot_num_triangles.push_back(0);
+                }
+                else if (primary_group[vertex_index] != sgroup)
+                {
+                    unsigned long long key = ((unsigned long long)vertex_index << 32) | sgroup;
+                    std::pair<std::unordered_map<unsigned long long, unsigned int>::iterator, bool> inserted
+                        = other_slots.insert(std::make_pair(key, (unsigned int)slot_normals.size()));
+                    slot = inserted.first->second;
+                    if (inserted.second)
+                    {
+                        slot_normals.push_back(glm::vec4(0.0f,0.0f,0.0f,0.0f));
+                        slot_num_triangles.push_back(0);
+                    }
+                }
+
+                slot_normals[slot] += face_normals[t];
+                slot_num_triangles[slot] += 1;
+                corner_slots[3*t + vertex] = slot;
+            }
+        }
+    }
+
+    // Computamos a média das normais acumuladas
+    model->attrib.normals.reserve( 3*slot_normals.size() );
+    for (size_t slot = 0; slot < slot_normals.size(); ++slot)
+    {
+        glm::vec4 n = slot_normals[slot] / (float)slot_num_triangles[slot];
+        n /= norm(n);
+
+        model->attrib.normals.push_back( n.x );
+        model->attrib.normals.push_back( n.y );
+        model->attrib.normals.push_back( n.z );
+    }
+
+    // Escrevemos os índices das normais para os vértices dos triângulos
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+    {
+        tinyobj::mesh_t& mesh = model->shapes[shape].mesh;
+        size_t num_triangles = mesh.num_face_vertices.size();
+
+        for (size_t triangle = 0; triangle < num_triangles; ++triangle)
+        {
+            size_t t = first_triangle[shape] + triangle;
+            for (size_t vertex = 0; vertex < 3; ++vertex)
+                mesh.indices[3*triangle + vertex].normal_index = (int)corner_slots[3*t + vertex];
+        }
+    }
+}
+
+// Versão anterior de ComputeNormals(), que percorre todos os triângulos uma
+// vez para cada smoothing group (tempo O(grupos x triângulos)). Mantida apenas
+// como referência para BenchmarkComputeNormals().
+static void ComputeNormals_PerGroup(ObjModel* model)
 {
     if ( !model->attrib.normals.empty() )
         return;
@@ -765,42 +1828,368 @@ void ComputeNormals(ObjModel* model)
                 }
             }
         }
-
+
+    }
+}
+
+// Remove as normais de um ObjModel, para forçar ComputeNormals() a recalculá-las
+static void StripNormals(ObjModel* model)
+{
+    model->attrib.normals.clear();
+    for (size_t shape = 0; shape < model->shapes.size(); ++shape)
+        for (size_t i = 0; i < model->shapes[shape].mesh.indices.size(); ++i)
+            model->shapes[shape].mesh.indices[i].normal_index = -1;
+}
+
+// Executa "compute" sobre cópias de "source" e retorna o menor tempo (ms)
+template <typename Function>
+static double TimeComputeNormals(const ObjModel& source, Function compute, ObjModel* result)
+{
+    const int repetitions = 5;
+    double best_ms = std::numeric_limits<double>::max();
+    for (int r = 0; r < repetitions; ++r)
+    {
+        ObjModel model = source;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        compute(&model);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        best_ms = std::min(best_ms, ms);
+        if (r == 0)
+            *result = model;
+    }
+    return best_ms;
+}
+
+// Maior ângulo (graus) entre as normais de cada canto de triângulo de dois modelos
+static double MaxNormalAngle(const ObjModel& a, const ObjModel& b)
+{
+    double max_angle = 0.0;
+    for (size_t shape = 0; shape < a.shapes.size(); ++shape)
+    {
+        for (size_t i = 0; i < a.shapes[shape].mesh.indices.size(); ++i)
+        {
+            int na = a.shapes[shape].mesh.indices[i].normal_index;
+            int nb = b.shapes[shape].mesh.indices[i].normal_index;
+            double d = a.attrib.normals[3*na+0]*b.attrib.normals[3*nb+0]
+                     + a.attrib.normals[3*na+1]*b.attrib.normals[3*nb+1]
+                     + a.attrib.normals[3*na+2]*b.attrib.normals[3*nb+2];
+            d = std::min(1.0, std::max(-1.0, d));
+            if (d == d) // Ignora normais degeneradas (NaN) em ambas as versões
+                max_angle = std::max(max_angle, std::acos(d) * 180.0 / M_PI);
+        }
+    }
+    return max_angle;
+}
+
+// Mede ComputeNormals() contra ComputeNormals_PerGroup() em bait.obj e
+// terrain.obj (normais do arquivo descartadas). O terceiro caso força muitos
+// smoothing groups em bait.obj (um a cada 64 triângulos), que é onde a versão
+// anterior degrada. Execute a partir de bin/Linux: "./main --benchmark-normals".
+int BenchmarkComputeNormals()
+{
+    const char* filenames[] = { "../../data/models/bait.obj", "../../data/models/terrain.obj", "../../data/models/bait.obj" };
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    printf("\nComputeNormals(): por grupo (anterior) x passada única (1 e %u threads), melhor de 5\n", num_threads);
+
+    for (size_t f = 0; f < sizeof(filenames)/sizeof(filenames[0]); ++f)
+    {
+        ObjModel source(filenames[f]);
+        StripNormals(&source);
+
+        bool many_groups = (f == 2);
+        std::set<unsigned int> groups;
+        size_t num_triangles = 0;
+        for (size_t shape = 0; shape < source.shapes.size(); ++shape)
+        {
+            std::vector<unsigned int>& ids = source.shapes[shape].mesh.smoothing_group_ids;
+            for (size_t t = 0; t < ids.size(); ++t)
+            {
+                if (many_groups)
+                    ids[t] = (unsigned int)((num_triangles + t) / 64) + 1;
+                groups.insert(ids[t]);
+            }
+            num_triangles += ids.size();
+        }
+
+        ObjModel reference = source, single = source, threaded = source;
+        double reference_ms = TimeComputeNormals(source, [](ObjModel* m) { ComputeNormals_PerGroup(m); }, &reference);
+        double single_ms    = TimeComputeNormals(source, [](ObjModel* m) { ComputeNormals(m, 1); }, &single);
+        double threaded_ms  = TimeComputeNormals(source, [num_threads](ObjModel* m) { ComputeNormals(m, num_threads); }, &threaded);
+
+        printf("%s%s: %d triângulos, %d smoothing groups\n", filenames[f], many_groups ? " (grupos sintéticos)" : "",
+            (int)num_triangles, (int)groups.size());
+        printf("  anterior %9.2f ms | passada única %8.2f ms (%6.1fx) | %u threads %8.2f ms (%6.1fx) | diferença máx. %.4f graus\n",
+            reference_ms, single_ms, reference_ms / single_ms,
+            num_threads, threaded_ms, reference_ms / threaded_ms,
+            std::max(MaxNormalAngle(reference, single), MaxNormalAngle(reference, threaded)));
+    }
+
+    return 0;
+}
+
+// Mede o tempo de CPU de FlushRenderQueue() (ordenação, dados dos objetos e
+// chamadas ao OpenGL) com a cena inicial do jogo, no caminho OpenGL 3.3 e no
+// backend indireto. Cada quadro termina com glFinish(), para que o tempo de
+// envio não inclua esperas pela GPU de quadros anteriores.
+int BenchmarkRenderSubmit(GLFWwindow* window)
+{
+    const int warmup_frames = 20;
+    const int measured_frames = 300;
+
+    printf("\nFlushRenderQueue(): OpenGL 3.3 x desenho indireto, média de %d quadros\n", measured_frames);
+
+    bool multi_draw_enabled = g_MultiDrawEnabled;
+    int num_paths = MultiDrawAvailable() ? 2 : 1;
+    double path_ms[2] = { 0.0, 0.0 };
+    for (int path = 0; path < num_paths; ++path)
+    {
+        g_MultiDrawEnabled = ( path == 1 );
+
+        double total_ms = 0.0;
+        for (int frame = 0; frame < warmup_frames + measured_frames; ++frame)
+        {
+            glClearColor(0.1f, 0.3f, 0.6f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            glm::mat4 view;
+            glm::vec4 camera_position;
+            glm::mat4 projection;
+            UpdateCameras(view, camera_position, projection);
+            RenderScene(window, view, projection);
+            glFinish();
+
+            if (frame >= warmup_frames)
+                total_ms += g_FlushRenderQueueMs;
+        }
+        path_ms[path] = total_ms / measured_frames;
+
+        printf("  %-17s %8.4f ms | %u chamadas de desenho, %u desenhos indiretos\n",
+            path == 0 ? "OpenGL 3.3" : "desenho indireto", path_ms[path],
+            g_RenderStatsLast.draws, g_RenderStatsLast.indirect_draws);
+    }
+
+    if (num_paths == 2)
+        printf("  envio %.2fx mais rápido com desenho indireto\n", path_ms[0] / path_ms[1]);
+    else
+        printf("  desenho indireto indisponível neste contexto OpenGL\n");
+
+    g_MultiDrawEnabled = multi_draw_enabled;
+    return 0;
+}
+
+// Chave de soldagem de vértices: a tupla (posição, normal, textura) de índices
+// da tinyobjloader. Dois cantos de triângulo com a mesma tupla são o mesmo
+// vértice e podem compartilhar uma única entrada nos buffers.
+struct VertexWeldKey
+{
+    int vertex_index;
+    int normal_index;
+    int texcoord_index;
+    int material_id;    // A cor do material também é um atributo de vértice
+
+    bool operator==(const VertexWeldKey& other) const
+    {
+        return vertex_index   == other.vertex_index
+            && normal_index   == other.normal_index
+            && texcoord_index == other.texcoord_index
+            && material_id    == other.material_id;
+    }
+};
+
+struct VertexWeldKeyHash
+{
+    size_t operator()(const VertexWeldKey& key) const
+    {
+        size_t h = (size_t)(unsigned int)key.vertex_index * 73856093u;
+        h ^= (size_t)(unsigned int)key.normal_index   * 19349663u;
+        h ^= (size_t)(unsigned int)key.texcoord_index * 83492791u;
+        h ^= (size_t)(unsigned int)key.material_id    * 2654435761u;
+        return h;
+    }
+};
+
+// Número médio de execuções do vertex shader por triângulo (ACMR), simulando
+// uma cache pós-transformação FIFO de "cache_size" entradas. Vale 3.0 quando
+// nenhum vértice é reaproveitado e tende a ~0.5 em malhas regulares ideais.
+static float ComputeVertexCacheACMR(const GLuint* indices, size_t num_indices, size_t cache_size)
+{
+    if (num_indices < 3)
+        return 0.0f;
+
+    std::vector<GLuint> fifo(cache_size, (GLuint)-1);
+    size_t head = 0;
+    size_t misses = 0;
+
+    for (size_t i = 0; i < num_indices; ++i)
+    {
+        if (std::find(fifo.begin(), fifo.end(), indices[i]) != fifo.end())
+            continue;
+
+        fifo[head] = indices[i];
+        head = (head + 1) % cache_size;
+        misses += 1;
+    }
+
+    return (float)misses / (float)(num_indices / 3);
+}
+
+// Região da grade de MESH_BUILD_CLUSTERS de cada objeto de "mesh": a célula
+// do plano XZ de [bounds_min, bounds_max] onde fica o centro da sua bbox
+std::vector<int> ComputeClusterCells(const MeshData& mesh, const glm::vec3& bounds_min, const glm::vec3& bounds_max)
+{
+    glm::vec3 size = bounds_max - bounds_min;
+    std::vector<int> cells(mesh.shapes.size());
+    for (size_t shape = 0; shape < mesh.shapes.size(); ++shape)
+    {
+        glm::vec3 center = 0.5f * (mesh.shapes[shape].bbox_min + mesh.shapes[shape].bbox_max);
+        int x = size.x > 0.0f ? (int)((center.x - bounds_min.x) / size.x * MESH_CLUSTER_GRID) : 0;
+        int z = size.z > 0.0f ? (int)((center.z - bounds_min.z) / size.z * MESH_CLUSTER_GRID) : 0;
+        x = std::min(std::max(x, 0), MESH_CLUSTER_GRID - 1);
+        z = std::min(std::max(z, 0), MESH_CLUSTER_GRID - 1);
+        cells[shape] = z * MESH_CLUSTER_GRID + x;
+    }
+    return cells;
+}
+
+// Junta os objetos não instanciados de uma malha no primeiro deles, que
+// mantém o nome. Usada para geometria estática desenhada sempre com a mesma
+// matriz "model" e o mesmo object_id (ex. as árvores): a malha resultante é
+// desenhada com uma única chamada, e a cor de cada objeto original continua
+// disponível como atributo de vértice (veja BuildMeshData()). Objetos
+// instanciados continuam separados, pois cada um tem suas transformações.
+//
+// Se "cells" não for NULL (veja ComputeClusterCells()), é feito um lote por
+// região em vez de um só, para que o culling descarte as regiões fora da tela.
+void MergeMeshShapes(MeshData* mesh, const std::vector<int>* cells)
+{
+    std::vector<int> cell_of(mesh->shapes.size(), 0);
+    if (cells)
+        cell_of = *cells;
+
+    // Objetos comuns primeiro, agrupados por região e contíguos nos streams
+    std::vector<size_t> order;
+    for (int cell = 0; cell < MESH_CLUSTER_GRID*MESH_CLUSTER_GRID; ++cell)
+        for (size_t shape = 0; shape < mesh->shapes.size(); ++shape)
+            if (mesh->shapes[shape].num_instances == 0 && cell_of[shape] == cell)
+                order.push_back(shape);
+
+    size_t num_merged = order.size();
+    if (num_merged <= 1)
+        return;
+
+    for (size_t shape = 0; shape < mesh->shapes.size(); ++shape)
+        if (mesh->shapes[shape].num_instances > 0)
+            order.push_back(shape);
+    MeshData_ReorderShapes(mesh, order);
+
+    std::vector<MeshShape> shapes;
+    for (size_t first = 0; first < num_merged; )
+    {
+        MeshShape merged = mesh->shapes[first];
+        size_t shape = first + 1;
+        for ( ; shape < num_merged && cell_of[order[shape]] == cell_of[order[first]]; ++shape)
+        {
+            const MeshShape& theshape = mesh->shapes[shape];
+            merged.num_indices  += theshape.num_indices;
+            merged.num_vertices += theshape.num_vertices;
+            merged.bbox_min = glm::min(merged.bbox_min, theshape.bbox_min);
+            merged.bbox_max = glm::max(merged.bbox_max, theshape.bbox_max);
+        }
+        merged.lods[0].num_indices = merged.num_indices;
+        shapes.push_back(merged);
+        first = shape;
     }
+
+    printf("  Lote estático \"%s\": %d objetos -> %d\n", shapes[0].name.c_str(), (int)num_merged, (int)shapes.size());
+    shapes.insert(shapes.end(), mesh->shapes.begin() + num_merged, mesh->shapes.end());
+    mesh->shapes.swap(shapes);
 }
 
-// Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
+// Constrói os streams de vértices e índices (triângulos) de um ObjModel, para
+// futura renderização. Nenhuma chamada OpenGL é feita aqui; veja
+// AddMeshToVirtualScene() para o envio dos streams para a GPU.
+//
+// Os cantos dos triângulos são soldados: cada tupla (posição, normal, textura,
+// material) distinta vira um único vértice, e indices[] aponta para eles. A
+// soldagem é feita por objeto (shape), de modo que os vértices de cada objeto
+// ficam contíguos nos buffers.
+//
+// A cor difusa (Kd) do material de cada triângulo é gravada por vértice em
+// color_coefficients; se todos os objetos usarem um único material cada, o
+// stream é descartado e a cor do objeto (MeshShape::material_kd) basta.
+//
+// "build_flags" (MESH_BUILD_*) liga a detecção de cópias, que viram instâncias
+// de um protótipo (veja mesh_instancing.h), e o lote estático dos objetos
+// restantes (veja MergeMeshShapes()), nessa ordem.
+void BuildMeshData(ObjModel* model, MeshData* mesh, unsigned int build_flags)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
-
-    std::vector<GLuint> indices;
-    std::vector<float>  model_coefficients;
-    std::vector<float>  normal_coefficients;
-    std::vector<float>  texture_coefficients;
+    std::vector<GLuint>& indices              = mesh->indices;
+    std::vector<float>&  model_coefficients   = mesh->model_coefficients;
+    std::vector<float>&  normal_coefficients  = mesh->normal_coefficients;
+    std::vector<float>&  texture_coefficients = mesh->texture_coefficients;
+    std::vector<float>&  color_coefficients   = mesh->color_coefficients;
+
+    // Obtém a cor do material do arquivo .mtl (cor padrão caso não tenha material)
+    std::vector<glm::vec3> material_colors(model->materials.size());
+    for (size_t i = 0; i < model->materials.size(); ++i)
+        material_colors[i] = glm::vec3(model->materials[i].diffuse[0], model->materials[i].diffuse[1], model->materials[i].diffuse[2]);
+    const glm::vec3 default_color = glm::vec3(0.8f, 0.8f, 0.8f);
+
+    // Tamanho de um vértice nos buffers: posição vec4 + normal vec4 + textura vec2
+    const size_t vertex_size = 4*sizeof(float)
+                             + (model->attrib.normals.empty()   ? 0 : 4*sizeof(float))
+                             + (model->attrib.texcoords.empty() ? 0 : 2*sizeof(float));
+    const size_t acmr_cache_size = 32;
+
+    std::unordered_map<VertexWeldKey, GLuint, VertexWeldKeyHash> welded;
 
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
         size_t first_index = indices.size();
+        size_t first_vertex = model_coefficients.size() / 4;
         size_t num_triangles = model->shapes[shape].mesh.num_face_vertices.size();
 
-        const float minval = std::numeric_limits<float>::min();
+        welded.clear();
+        welded.reserve(3*num_triangles);
+
+        // lowest(), não min(): min() é o menor float positivo, e objetos
+        // inteiramente abaixo de zero ficariam com bbox_max errado
+        const float minval = std::numeric_limits<float>::lowest();
         const float maxval = std::numeric_limits<float>::max();
 
         glm::vec3 bbox_min = glm::vec3(maxval,maxval,maxval);
         glm::vec3 bbox_max = glm::vec3(minval,minval,minval);
 
+        const std::vector<int>& material_ids = model->shapes[shape].mesh.material_ids;
+        int first_material_id = material_ids.empty() ? -1 : material_ids[0];
+        if (first_material_id >= (int)material_colors.size())
+            first_material_id = -1;
+
         for (size_t triangle = 0; triangle < num_triangles; ++triangle)
         {
             assert(model->shapes[shape].mesh.num_face_vertices[triangle] == 3);
 
+            int material_id = triangle < material_ids.size() ? material_ids[triangle] : -1;
+            if (material_id < 0 || material_id >= (int)material_colors.size())
+                material_id = -1;
+            const glm::vec3& color = material_id >= 0 ? material_colors[material_id] : default_color;
+
             for (size_t vertex = 0; vertex < 3; ++vertex)
             {
                 tinyobj::index_t idx = model->shapes[shape].mesh.indices[3*triangle + vertex];
 
-                indices.push_back(first_index + 3*triangle + vertex);
+                VertexWeldKey key = { idx.vertex_index, idx.normal_index, idx.texcoord_index, material_id };
+                GLuint new_index = (GLuint)(model_coefficients.size() / 4);
+
+                std::pair<std::unordered_map<VertexWeldKey, GLuint, VertexWeldKeyHash>::iterator, bool> inserted
+                    = welded.insert(std::make_pair(key, new_index));
+
+                indices.push_back(inserted.first->second);
+
+                // Vértice já emitido por outro triângulo deste objeto
+                if (!inserted.second)
+                    continue;
 
                 const float vx = model->attrib.vertices[3*idx.vertex_index + 0];
                 const float vy = model->attrib.vertices[3*idx.vertex_index + 1];
@@ -811,6 +2200,10 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
                 model_coefficients.push_back( vz ); // Z
                 model_coefficients.push_back( 1.0f ); // W
 
+                color_coefficients.push_back( color.r );
+                color_coefficients.push_back( color.g );
+                color_coefficients.push_back( color.b );
+
                 bbox_min.x = std::min(bbox_min.x, vx);
                 bbox_min.y = std::min(bbox_min.y, vy);
                 bbox_min.z = std::min(bbox_min.z, vz);
@@ -846,241 +2239,403 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel* model)
 
         size_t last_index = indices.size() - 1;
 
-        SceneObject theobject;
-        theobject.name           = model->shapes[shape].name;
-        theobject.first_index    = first_index; // Primeiro índice
-        theobject.num_indices    = last_index - first_index + 1; // Número de indices
-        theobject.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
-
-        theobject.bbox_min = bbox_min;
-        theobject.bbox_max = bbox_max;
-
-        // Obtém a cor do material do arquivo .mtl
-        int material_id = model->shapes[shape].mesh.material_ids.empty() ? -1 : model->shapes[shape].mesh.material_ids[0];
-        if (material_id >= 0 && material_id < (int)model->materials.size()) {
-            theobject.material_kd = glm::vec3(
-                model->materials[material_id].diffuse[0],
-                model->materials[material_id].diffuse[1],
-                model->materials[material_id].diffuse[2]
-            );
-        } else {
-            // Cor padrão caso não tenha material
-            theobject.material_kd = glm::vec3(0.8f, 0.8f, 0.8f);
-        }
+        MeshShape theshape;
+        theshape.name        = model->shapes[shape].name;
+        theshape.first_index = first_index; // Primeiro índice
+        theshape.num_indices = last_index - first_index + 1; // Número de indices
+        theshape.first_vertex = first_vertex;
+        theshape.num_vertices = model_coefficients.size() / 4 - first_vertex;
+        theshape.bbox_min    = bbox_min;
+        theshape.bbox_max    = bbox_max;
+        theshape.first_instance = 0;
+        theshape.num_instances  = 0;
+
+        theshape.num_lods             = 1;
+        theshape.lods[0].first_index = theshape.first_index;
+        theshape.lods[0].num_indices = theshape.num_indices;
+        theshape.lods[0].error       = 0.0f;
+
+        // Cor do objeto: a do material do primeiro triângulo
+        if (first_material_id >= 0)
+            theshape.material_kd = material_colors[first_material_id];
+        else
+            theshape.material_kd = default_color;
 
-        // Se o nome já existe, adiciona um sufixo único
-        std::string object_name = model->shapes[shape].name;
-        int suffix = 0;
-        while (g_VirtualScene.find(object_name) != g_VirtualScene.end()) {
-            suffix++;
-            object_name = model->shapes[shape].name + "_" + std::to_string(suffix);
+        mesh->shapes.push_back(theshape);
+
+        // Relatório da soldagem: memória de vértices e execuções do vertex
+        // shader por triângulo (ACMR) antes (sem índices compartilhados) e depois.
+        size_t num_corners  = theshape.num_indices;
+        size_t num_vertices = theshape.num_vertices;
+        if (num_corners > 0)
+        {
+            float acmr = ComputeVertexCacheACMR(&indices[first_index], num_corners, acmr_cache_size);
+            printf("  Soldagem \"%s\": %d -> %d vertices (%.1f KiB -> %.1f KiB, -%.0f%%), ACMR 3.00 -> %.2f (-%.0f%% vertex shader)\n",
+                theshape.name.c_str(),
+                (int)num_corners, (int)num_vertices,
+                num_corners*vertex_size/1024.0f, num_vertices*vertex_size/1024.0f,
+                100.0f*(1.0f - (float)num_vertices/(float)num_corners),
+                acmr, 100.0f*(1.0f - acmr/3.0f));
         }
-        theobject.name = object_name;
-        g_VirtualScene[object_name] = theobject;
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
-    GLint  number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Limites da malha inteira, que definem a grade de MESH_BUILD_CLUSTERS
+    glm::vec3 bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (size_t shape = 0; shape < mesh->shapes.size(); ++shape)
+    {
+        bounds_min = glm::min(bounds_min, mesh->shapes[shape].bbox_min);
+        bounds_max = glm::max(bounds_max, mesh->shapes[shape].bbox_max);
+    }
+    bool clusters = (build_flags & MESH_BUILD_CLUSTERS) != 0;
+
+    if (build_flags & MESH_BUILD_INSTANCING)
+    {
+        std::vector<int> cells = ComputeClusterCells(*mesh, bounds_min, bounds_max);
+        MeshInstancing_Detect(mesh, clusters ? &cells : NULL);
+    }
 
-    if ( !normal_coefficients.empty() )
+    if (build_flags & MESH_BUILD_STATIC_BATCH)
     {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        location = 1; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        std::vector<int> cells = ComputeClusterCells(*mesh, bounds_min, bounds_max);
+        MergeMeshShapes(mesh, clusters ? &cells : NULL);
+    }
+
+    // Níveis de detalhe (veja mesh_simplify.h). Os índices dos LODs vão para o
+    // final de indices[], depois das malhas completas de todos os objetos.
+    for (size_t shape = 0; shape < mesh->shapes.size(); ++shape)
+    {
+        MeshShape& theshape = mesh->shapes[shape];
+        if (theshape.num_indices < 3*MIN_TRIANGLES_FOR_LODS)
+            continue;
+
+        std::vector<size_t> targets;
+        for (int lod = 1; lod < MESH_MAX_LODS; ++lod)
+            targets.push_back(theshape.num_indices >> lod); // 1/2, 1/4, 1/8 dos triângulos
+
+        std::vector<SimplifiedLod> lods = MeshSimplify_BuildLods(
+            model_coefficients.data(),
+            normal_coefficients.size() == model_coefficients.size() ? normal_coefficients.data() : NULL,
+            theshape.first_vertex, theshape.num_vertices,
+            &indices[theshape.first_index], theshape.num_indices, targets);
+
+        std::string report;
+        for (size_t lod = 0; lod < lods.size(); ++lod)
+        {
+            MeshLod& thelod = theshape.lods[theshape.num_lods++];
+            thelod.first_index = indices.size();
+            thelod.num_indices = lods[lod].indices.size();
+            thelod.error       = lods[lod].error;
+            indices.insert(indices.end(), lods[lod].indices.begin(), lods[lod].indices.end());
+
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), " -> %d (erro %.2g)", (int)(thelod.num_indices / 3), thelod.error);
+            report += buffer;
+        }
+        printf("  LODs \"%s\": %d triângulos%s\n", theshape.name.c_str(), (int)(theshape.num_indices / 3), report.c_str());
     }
 
-    if ( !texture_coefficients.empty() )
+    // As cores por vértice só são necessárias se algum objeto (inclusive um
+    // lote estático) tiver vértices com cor diferente da cor do objeto
+    bool needs_vertex_colors = false;
+    for (size_t shape = 0; shape < mesh->shapes.size() && !needs_vertex_colors; ++shape)
     {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2; // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        const MeshShape& theshape = mesh->shapes[shape];
+        for (size_t v = theshape.first_vertex; v < theshape.first_vertex + theshape.num_vertices; ++v)
+            if (glm::vec3(color_coefficients[3*v], color_coefficients[3*v + 1], color_coefficients[3*v + 2]) != theshape.material_kd)
+            {
+                needs_vertex_colors = true;
+                break;
+            }
     }
+    if (!needs_vertex_colors)
+        color_coefficients.clear();
+
+    // Vértices intercalados e quantizados que de fato vão para a GPU
+    MeshData_PackVertices(mesh);
+}
+
+// Envia os streams de uma malha para a GPU (VAO + buffers) e adiciona seus
+// objetos em g_VirtualScene. Objetos instanciados ganham um VAO próprio. Os ponteiros de "mesh" podem apontar diretamente
+// para um arquivo cozido mapeado em memória (veja mesh_cache.cpp). Se "asset"
+// não for NULL, os VAOs, os buffers e os nomes dos objetos criados são
+// registrados nele, para que possam ser liberados depois.
+void AddMeshToVirtualScene(const MeshView& mesh, ModelAsset* asset)
+{
+    GLuint vertex_array_object_id;
+    glGenVertexArrays(1, &vertex_array_object_id);
+    glBindVertexArray(vertex_array_object_id);
+
+    // Um único buffer com os vértices intercalados no formato compacto de
+    // vertex_format.h; os atributos são decodificados em "shader_vertex.glsl".
+    GLuint VBO_vertices_id;
+    glGenBuffers(1, &VBO_vertices_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices_id);
+    glBufferData(GL_ARRAY_BUFFER, mesh.num_vertices * VertexFormat_Stride(mesh.vertex_flags), mesh.vertices, GL_STATIC_DRAW);
+    VertexFormat_SetupAttributes(mesh.vertex_flags);
 
     GLuint indices_id;
     glGenBuffers(1, &indices_id);
 
     // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.num_indices * sizeof(GLuint), mesh.indices, GL_STATIC_DRAW);
     // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0); // XXX Errado!
     //
 
+    // Transformações dos objetos instanciados (veja mesh_instancing.h)
+    GLuint instances_id = 0;
+    if (mesh.num_instances > 0)
+    {
+        glGenBuffers(1, &instances_id);
+        glBindBuffer(GL_ARRAY_BUFFER, instances_id);
+        glBufferData(GL_ARRAY_BUFFER, mesh.num_instances * MESH_INSTANCE_FLOATS * sizeof(float), mesh.instance_transforms, GL_STATIC_DRAW);
+    }
+
     // "Desligamos" o VAO, evitando assim que operações posteriores venham a
     // alterar o mesmo. Isso evita bugs.
     glBindVertexArray(0);
-}
-
-// Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char* filename)
-{
-    // Criamos um identificador (ID) para este shader, informando que o mesmo
-    // será aplicado nos vértices.
-    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
+    std::vector<GLuint> vertex_arrays(1, vertex_array_object_id);
 
-    // Retorna o ID gerado acima
-    return vertex_shader_id;
-}
+    for (size_t shape = 0; shape < mesh.shapes->size(); ++shape)
+    {
+        const MeshShape& theshape = (*mesh.shapes)[shape];
 
-// Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char* filename)
-{
-    // Criamos um identificador (ID) para este shader, informando que o mesmo
-    // será aplicado nos fragmentos.
-    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+        SceneObject theobject;
+        theobject.first_index    = theshape.first_index; // Primeiro índice
+        theobject.num_indices    = theshape.num_indices; // Número de indices
 
-    // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
+        DrawRecord record;
+        record.rendering_mode = GL_TRIANGLES;       // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+        record.vertex_array_object_id = vertex_array_object_id;
 
-    // Retorna o ID gerado acima
-    return fragment_shader_id;
-}
+        record.bbox_min = theshape.bbox_min;
+        record.bbox_max = theshape.bbox_max;
 
-// Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
-// um arquivo GLSL e faz sua compilação.
-void LoadShader(const char* filename, GLuint shader_id)
-{
-    // Lemos o arquivo de texto indicado pela variável "filename"
-    // e colocamos seu conteúdo em memória, apontado pela variável
-    // "shader_string".
-    std::ifstream file;
-    try {
-        file.exceptions(std::ifstream::failbit);
-        file.open(filename);
-    } catch ( std::exception& e ) {
-        fprintf(stderr, "ERROR: Cannot open file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
-    std::stringstream shader;
-    shader << file.rdbuf();
-    std::string str = shader.str();
-    const GLchar* shader_string = str.c_str();
-    const GLint   shader_string_length = static_cast<GLint>( str.length() );
+        record.material_kd = theshape.material_kd;
+        record.vertex_colors = (mesh.vertex_flags & VERTEX_FORMAT_COLORS) != 0;
 
-    // Define o código do shader GLSL, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
+        record.num_instances  = (GLsizei)theshape.num_instances;
+        record.bounds_min     = theshape.bbox_min;
+        record.bounds_max     = theshape.bbox_max;
+        record.instance_scale = 1.0f;
 
-    // Compila o código do shader GLSL (em tempo de execução)
-    glCompileShader(shader_id);
+        if (theshape.num_instances > 0)
+        {
+            // Sem glDrawElementsInstancedBaseInstance() no OpenGL 3.3: o VAO
+            // do objeto já aponta para a sua primeira transformação
+            glGenVertexArrays(1, &record.vertex_array_object_id);
+            glBindVertexArray(record.vertex_array_object_id);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO_vertices_id);
+            VertexFormat_SetupAttributes(mesh.vertex_flags);
+            glBindBuffer(GL_ARRAY_BUFFER, instances_id);
+            VertexFormat_SetupInstanceAttributes(theshape.first_instance);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            vertex_arrays.push_back(record.vertex_array_object_id);
+
+            // Caixa envolvente dos cantos da bbox transformados por instância
+            record.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+            record.bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+            for (size_t i = 0; i < theshape.num_instances; ++i)
+            {
+                const float* m = mesh.instance_transforms + (theshape.first_instance + i) * MESH_INSTANCE_FLOATS;
+                glm::mat4 transform = glm::transpose(glm::mat4(
+                    m[0], m[1], m[2],  m[3],
+                    m[4], m[5], m[6],  m[7],
+                    m[8], m[9], m[10], m[11],
+                    0.0f, 0.0f, 0.0f,  1.0f));
+
+                for (int corner = 0; corner < 8; ++corner)
+                {
+                    glm::vec4 p = transform * glm::vec4(
+                        (corner & 1) ? theshape.bbox_max.x : theshape.bbox_min.x,
+                        (corner & 2) ? theshape.bbox_max.y : theshape.bbox_min.y,
+                        (corner & 4) ? theshape.bbox_max.z : theshape.bbox_min.z,
+                        1.0f);
+                    record.bounds_min = glm::min(record.bounds_min, glm::vec3(p));
+                    record.bounds_max = glm::max(record.bounds_max, glm::vec3(p));
+                }
 
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
+                for (int column = 0; column < 3; ++column)
+                    record.instance_scale = std::max(record.instance_scale, glm::length(glm::vec3(transform[column])));
+            }
+        }
 
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
+        record.num_lods = theshape.num_lods;
+        for (int lod = 0; lod < theshape.num_lods; ++lod)
+            record.lods[lod] = theshape.lods[lod];
 
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
+        LodState lod_state;
+        lod_state.lod_frame = 0;
+        lod_state.lod_draws = 0;
 
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
-    {
-        std::string  output;
+        // Se o nome já existe, adiciona um sufixo único
+        std::string object_name = theshape.name;
+        int suffix = 0;
+        while (g_VirtualScene.find(object_name) != g_VirtualScene.end()) {
+            suffix++;
+            object_name = theshape.name + "_" + std::to_string(suffix);
+        }
+        theobject.name = object_name;
 
-        if ( !compiled_ok )
+        // Reutilizamos entradas de objetos descarregados, se houver
+        SceneObjectHandle handle;
+        if (!g_FreeSceneObjects.empty())
         {
-            output += "ERROR: OpenGL compilation of \"";
-            output += filename;
-            output += "\" failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
+            handle = g_FreeSceneObjects.back();
+            g_FreeSceneObjects.pop_back();
+            g_DrawRecords[handle]  = record;
+            g_LodStates[handle]    = lod_state;
+            g_SceneObjects[handle] = theobject;
         }
         else
         {
-            output += "WARNING: OpenGL compilation of \"";
-            output += filename;
-            output += "\".\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
+            handle = (SceneObjectHandle)g_DrawRecords.size();
+            g_DrawRecords.push_back(record);
+            g_LodStates.push_back(lod_state);
+            g_SceneObjects.push_back(theobject);
         }
+        g_VirtualScene[object_name] = handle;
+        g_VirtualSceneRevision += 1;
 
-        fprintf(stderr, "%s", output.c_str());
+        if (asset != NULL)
+            asset->object_names.push_back(object_name);
     }
 
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
+    if (asset != NULL)
+    {
+        asset->vertex_arrays = vertex_arrays;
+        asset->buffers.push_back(VBO_vertices_id);
+        asset->buffers.push_back(indices_id);
+        if (instances_id != 0)
+            asset->buffers.push_back(instances_id);
+        asset->loaded = true;
+    }
 }
 
-// Esta função cria um programa de GPU, o qual contém obrigatoriamente um
-// Vertex Shader e um Fragment Shader.
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
+// Malha pronta para ser enviada para a GPU, vinda do arquivo cozido ou do OBJ.
+// Preenchida por PrepareModel() em uma thread do pipeline de carregamento.
+struct PreparedModel
 {
-    // Criamos um identificador (ID) para este programa de GPU
-    GLuint program_id = glCreateProgram();
-
-    // Definição dos dois shaders GLSL que devem ser executados pelo programa
-    glAttachShader(program_id, vertex_shader_id);
-    glAttachShader(program_id, fragment_shader_id);
-
-    // Linkagem dos shaders acima ao programa
-    glLinkProgram(program_id);
+    std::string  filename;
+    unsigned int build_flags; // MESH_BUILD_*
+    ModelHandle  handle;
+    CookedMesh  cooked;
+    MeshData    mesh;
+    bool        from_cache;
+};
 
-    // Verificamos se ocorreu algum erro durante a linkagem
-    GLint linked_ok = GL_FALSE;
-    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+// Parte de CPU do carregamento de um modelo: mapeia a versão cozida ou, se ela
+// não existir/estiver desatualizada, lê o OBJ, computa normais, constrói os
+// streams e regrava a versão cozida. Não faz chamadas OpenGL.
+void PrepareModel(PreparedModel* prepared)
+{
+    const char* filename = prepared->filename.c_str();
 
-    // Imprime no terminal qualquer erro de linkagem
-    if ( linked_ok == GL_FALSE )
-    {
-        GLint log_length = 0;
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &log_length);
+    prepared->from_cache = MeshCache_Open(filename, prepared->build_flags, &prepared->cooked);
+    if (prepared->from_cache)
+        return;
 
-        // Alocamos memória para guardar o log de compilação.
-        // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-        GLchar* log = new GLchar[log_length];
+    ObjModel model(filename);
 
-        glGetProgramInfoLog(program_id, log_length, &log_length, log);
+    // Uma thread só: PrepareModel() já roda em paralelo, um modelo por thread
+    // do pool de asset_loader.h, e dividir cada modelo em mais threads só
+    // disputaria os mesmos núcleos. O caminho com várias threads de
+    // ComputeNormals() é medido em --benchmark-normals.
+    ComputeNormals(&model);
 
-        std::string output;
+    BuildMeshData(&model, &prepared->mesh, prepared->build_flags);
+    MeshCache_Write(filename, prepared->build_flags, prepared->mesh);
 
-        output += "ERROR: OpenGL linking of program failed.\n";
-        output += "== Start of link log\n";
-        output += log;
-        output += "\n== End of link log\n";
+    const MeshData& mesh = prepared->mesh;
+    size_t num_vertices = mesh.model_coefficients.size() / 4;
+    size_t float_bytes  = (mesh.model_coefficients.size() + mesh.normal_coefficients.size() + mesh.texture_coefficients.size() + mesh.color_coefficients.size()) * sizeof(float);
+    if (num_vertices > 0)
+        printf("  Formato compacto \"%s\": %d -> %d bytes/vertice (%.1f KiB -> %.1f KiB)\n",
+            filename, (int)(float_bytes / num_vertices), (int)VertexFormat_Stride(mesh.vertex_flags),
+            float_bytes / 1024.0f, mesh.vertices.size() / 1024.0f);
+}
 
-        // A chamada "delete" em C++ é equivalente ao "free()" do C
-        delete [] log;
+// Parte OpenGL do carregamento de um modelo (thread do OpenGL)
+void UploadPreparedModel(PreparedModel* prepared)
+{
+    if (prepared->from_cache)
+    {
+        printf("Carregando malha cozida de \"%s\"... ", prepared->filename.c_str());
+        AddMeshToVirtualScene(prepared->cooked.view, AssetRegistry_GetModel(prepared->handle));
+        printf("OK (%d objetos).\n", (int)prepared->cooked.shapes.size());
+        MeshCache_Close(&prepared->cooked);
+    }
+    else
+    {
+        AddMeshToVirtualScene(MeshData_View(prepared->mesh), AssetRegistry_GetModel(prepared->handle));
+        prepared->mesh = MeshData();
+    }
+}
 
-        fprintf(stderr, "%s", output.c_str());
+// Carrega um modelo ".obj" e adiciona seus objetos em g_VirtualScene. Se
+// existir uma versão cozida e atualizada do modelo (veja mesh_cache.cpp), ela é
+// mapeada em memória e enviada diretamente para a GPU, sem passar pela
+// tinyobjloader. Caso contrário, o OBJ é lido e a versão cozida é regravada.
+// Dentro de LoadGameResources() a leitura acontece em paralelo (asset_loader.h).
+// Carregar de novo um modelo já presente no registro de recursos não lê nem
+// envia nada: retorna o mesmo handle, com mais uma referência. "build_flags"
+// (MESH_BUILD_*, veja mesh_cache.h) só vale para o primeiro carregamento.
+ModelHandle LoadModelToVirtualScene(const char* filename, unsigned int build_flags)
+{
+    bool is_new;
+    ModelHandle handle = AssetRegistry_AcquireModel(filename, &is_new);
+    if ( !is_new )
+        return handle;
+
+    std::shared_ptr<PreparedModel> prepared = std::make_shared<PreparedModel>();
+    prepared->filename = filename;
+    prepared->build_flags = build_flags;
+    prepared->handle = handle;
+    prepared->from_cache = false;
+
+    // Fora do pipeline paralelo a submissão é síncrona e pode lançar exceção;
+    // nesse caso nem a entrada do registro nem os objetos já adicionados a
+    // g_VirtualScene devem sobreviver.
+    try {
+        AssetLoader_Submit(filename,
+            [prepared]() { PrepareModel(prepared.get()); },
+            [prepared]() { UploadPreparedModel(prepared.get()); });
+    } catch (...) {
+        UnloadModel(handle);
+        throw;
     }
 
-    // Os "Shader Objects" podem ser marcados para deleção após serem linkados 
-    glDeleteShader(vertex_shader_id);
-    glDeleteShader(fragment_shader_id);
+    return handle;
+}
+
+// Libera uma referência a um modelo. Quando a última referência é liberada o
+// VAO e os buffers são destruídos e os objetos do modelo saem de g_VirtualScene.
+void UnloadModel(ModelHandle handle)
+{
+    ModelAsset released;
+    if ( !AssetRegistry_ReleaseModel(handle, &released) )
+        return;
 
-    // Retornamos o ID gerado acima
-    return program_id;
+    for (size_t i = 0; i < released.object_names.size(); ++i)
+    {
+        SceneObjectHandle object = FindSceneObject(released.object_names[i]);
+        if (object == INVALID_SCENE_OBJECT)
+            continue;
+
+        g_DrawRecords[object].num_lods = 0;
+        g_DrawRecords[object].vertex_array_object_id = 0;
+        g_DrawRecords[object].num_instances = 0;
+        g_LodStates[object] = LodState();
+        g_SceneObjects[object] = SceneObject();
+        g_FreeSceneObjects.push_back(object);
+        g_VirtualScene.erase(released.object_names[i]);
+    }
+    g_VirtualSceneRevision += 1;
 }
 
 // Definição da função que será chamada sempre que a janela do sistema
@@ -1102,6 +2657,7 @@ void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
     // O cast para float é necessário pois números inteiros são arredondados ao
     // serem divididos!
     g_ScreenRatio = (float)width / height;
+    g_FramebufferHeight = height;
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
@@ -1117,7 +2673,7 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
         // Se estivermos na câmera de debug, mantemos o comportamento original de rotação
         if (g_CurrentCamera == DEBUG_CAMERA) {
             if (action == GLFW_PRESS) {
-                glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+                InputRecord_GetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
                 g_LeftMouseButtonPressed = true;
             } else if (action == GLFW_RELEASE) {
                 g_LeftMouseButtonPressed = false;
@@ -1134,7 +2690,7 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
                     g_Bait.is_in_water = false;
                     g_Bait.velocity = glm::vec3(0.0f, 0.0f, 0.0f);
                     // Reposicionar isca na ponta da vara
-                    g_Bait.position = GetRodTipPosition();
+                    g_Bait.position = GetRodTipPosition(g_Boat);
                     printf("Isca recolhida!\n");
                 }
                 // Se a isca está pronta para lançar, começa a carregar via RodSystem
@@ -1176,7 +2732,7 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
         // g_LastCursorPosY.  Também, setamos a variável
         // g_RightMouseButtonPressed como true, para saber que o usuário está
         // com o botão esquerdo pressionado.
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+        InputRecord_GetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
         g_RightMouseButtonPressed = true;
     }
     if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE)
@@ -1192,7 +2748,7 @@ void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
         // g_LastCursorPosY.  Também, setamos a variável
         // g_MiddleMouseButtonPressed como true, para saber que o usuário está
         // com o botão esquerdo pressionado.
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+        InputRecord_GetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
         g_MiddleMouseButtonPressed = true;
     }
     if (button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_RELEASE)
@@ -1395,6 +2951,60 @@ void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mod)
     {
         g_ShowInfoText = !g_ShowInfoText;
     }
+
+    // Tecla L liga/desliga os níveis de detalhe (para comparação visual)
+    if (key == GLFW_KEY_L && action == GLFW_PRESS)
+    {
+        g_LodEnabled = !g_LodEnabled;
+        printf("Níveis de detalhe (LOD) %s\n", g_LodEnabled ? "ativados" : "desativados");
+    }
+
+    // Tecla F liga/desliga o culling por frustum (para comparar os contadores)
+    if (key == GLFW_KEY_F && action == GLFW_PRESS)
+    {
+        g_FrustumCullingEnabled = !g_FrustumCullingEnabled;
+        printf("Culling por frustum %s\n", g_FrustumCullingEnabled ? "ativado" : "desativado");
+    }
+
+    // Tecla O liga/desliga o culling por oclusão
+    if (key == GLFW_KEY_O && action == GLFW_PRESS)
+    {
+        g_OcclusionCullingEnabled = !g_OcclusionCullingEnabled;
+        printf("Culling por oclusão %s\n", g_OcclusionCullingEnabled ? "ativado" : "desativado");
+    }
+
+    // Tecla M alterna entre o backend indireto e o caminho OpenGL 3.3
+    if (key == GLFW_KEY_M && action == GLFW_PRESS)
+    {
+        if (MultiDrawAvailable())
+        {
+            g_MultiDrawEnabled = !g_MultiDrawEnabled;
+            printf("Desenho indireto %s\n", g_MultiDrawEnabled ? "ativado" : "desativado");
+        }
+        else if (!g_MultiDrawRequested)
+        {
+            printf("Desenho indireto desligado; execute com --multi-draw para usá-lo\n");
+        }
+        else
+        {
+            printf("Desenho indireto indisponível neste contexto OpenGL\n");
+        }
+    }
+
+    // Tecla G mostra/esconde o gráfico dos tempos dos quadros
+    if (key == GLFW_KEY_G && action == GLFW_PRESS)
+    {
+        g_ShowFrameTiming = !g_ShowFrameTiming;
+    }
+
+    // Tecla P inicia/encerra a gravação dos tempos dos quadros em CSV
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+    {
+        if (FrameTiming_IsRecordingCsv())
+            FrameTiming_StopCsv();
+        else
+            FrameTiming_StartCsv("frame_timing.csv");
+    }
 }
 
 // Definimos o callback para impressão de erros da GLFW no terminal
@@ -1439,6 +3049,83 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow* window)
     TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-lineheight, 1.0f);
 }
 
+// Escrevemos na tela os contadores do cache de estado (veja render_queue.h)
+// do último quadro: chamadas feitas ao OpenGL e, entre parênteses, evitadas.
+void TextRendering_ShowRenderStats(GLFWwindow* window)
+{
+    if ( !g_ShowInfoText )
+        return;
+
+    char buffer[80];
+    char indirect[24] = "";
+    if ( g_RenderStatsLast.indirect_draws > 0 )
+        snprintf(indirect, sizeof(indirect), " (%u indirect)", g_RenderStatsLast.indirect_draws);
+
+    int numchars = snprintf(buffer, sizeof(buffer), "%u draws%s, binds %u (-%u), uniforms %u (-%u)",
+        g_RenderStatsLast.draws, indirect,
+        g_RenderStatsLast.binds, g_RenderStatsLast.binds_skipped,
+        g_RenderStatsLast.uniforms, g_RenderStatsLast.uniforms_skipped);
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-2*lineheight, 1.0f);
+
+    numchars = snprintf(buffer, sizeof(buffer), "%u visible, %u culled (%u box tests)%s",
+        g_CullingStatsLast.visible, g_CullingStatsLast.culled, g_CullingStatsLast.tests,
+        g_FrustumCullingEnabled ? "" : " [off]");
+
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-3*lineheight, 1.0f);
+
+    numchars = snprintf(buffer, sizeof(buffer), "occlusion: %u queries, %u conditional, %u skipped%s",
+        g_OcclusionStatsLast.queries, g_OcclusionStatsLast.conditional, g_OcclusionStatsLast.skipped,
+        g_OcclusionCullingEnabled ? "" : " [off]");
+
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, 1.0f-4*lineheight, 1.0f);
+}
+
+// Mostramos no canto inferior direito o gráfico dos últimos quadros (veja
+// frame_timing.h) e, acima dele, os percentis do tempo de quadro e a média de
+// cada etapa, na CPU / na GPU.
+void TextRendering_ShowFrameTiming(GLFWwindow* window)
+{
+    if ( !g_ShowInfoText || !g_ShowFrameTiming )
+        return;
+
+    const float graph_x0 = 0.30f, graph_y0 = -0.98f;
+    const float graph_x1 = 0.98f, graph_y1 = -0.68f;
+    // O histórico é ordenado uma vez só, para o gráfico e para o texto
+    FrameTimingSummary summary;
+    FrameTiming_Summarize(&summary);
+    FrameTiming_DrawGraph(summary, graph_x0, graph_y0, graph_x1, graph_y1);
+    if ( summary.frames == 0 )
+        return;
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    char buffer[128];
+    int numchars = snprintf(buffer, sizeof(buffer), "frame ms p50 %.1f p95 %.1f p99 %.1f | gpu p50 %.1f p95 %.1f p99 %.1f",
+        summary.frame_p50, summary.frame_p95, summary.frame_p99,
+        summary.gpu_p50, summary.gpu_p95, summary.gpu_p99);
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, graph_y1 + 1.3f*lineheight, 1.0f);
+
+    numchars = 0;
+    for (int p = 0; p < NUM_TIMING_PASSES; ++p)
+    {
+        const char* separator = p == 0 ? "" : " ";
+        if ( summary.gpu_ms[p] >= 0.0 )
+            numchars += snprintf(buffer + numchars, sizeof(buffer) - numchars, "%s%s %.1f/%.1f", separator,
+                FrameTiming_PassName((TimingPass)p), summary.cpu_ms[p], summary.gpu_ms[p]);
+        else
+            numchars += snprintf(buffer + numchars, sizeof(buffer) - numchars, "%s%s %.1f", separator,
+                FrameTiming_PassName((TimingPass)p), summary.cpu_ms[p]);
+        if ( numchars >= (int)sizeof(buffer) )
+            numchars = sizeof(buffer) - 1;
+    }
+    TextRendering_PrintString(window, buffer, 1.0f-(numchars + 1)*charwidth, graph_y1 + 0.3f*lineheight, 1.0f);
+}
+
 // Função para debugging: imprime no terminal todas informações de um modelo
 // geométrico carregado de um arquivo ".obj".
 // Veja: https://github.com/syoyo/tinyobjloader/blob/22883def8db9ef1f3ffb9b404318e7dd25fdbb51/loader_example.cc#L98
@@ -1608,8 +3295,9 @@ void PrintObjModelInfo(ObjModel* model)
   }
 }
 
-// Inicializa janela GLFW e contexto OpenGL
-GLFWwindow* InitializeWindow()
+// Inicializa janela GLFW e contexto OpenGL. Uma janela invisível
+// (visible == false) só fornece o contexto para o modo headless.
+GLFWwindow* InitializeWindow(int width, int height, bool visible)
 {
     // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
     // sistema operacional, onde poderemos renderizar com OpenGL.
@@ -1623,10 +3311,6 @@ GLFWwindow* InitializeWindow()
     // Definimos o callback para impressão de erros da GLFW no terminal
     glfwSetErrorCallback(ErrorCallback);
 
-    // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-
     #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     #endif
@@ -1635,13 +3319,33 @@ GLFWwindow* InitializeWindow()
     // funções modernas de OpenGL.
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // Ativamos antialiasing (MSAA) com 4 amostras por pixel
-    glfwWindowHint(GLFW_SAMPLES, 4);
+    // Ativamos antialiasing (MSAA) com 4 amostras por pixel. A janela
+    // invisível não é desenhada: o MSAA fica no framebuffer de headless.h
+    glfwWindowHint(GLFW_SAMPLES, visible ? 4 : 0);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GL_TRUE : GL_FALSE);
+
+    // Pedimos um framebuffer sRGB: a correção gamma da cena é feita pelo
+    // OpenGL na escrita dos fragmentos (veja GL_FRAMEBUFFER_SRGB em RenderScene())
+    glfwWindowHint(GLFW_SRGB_CAPABLE, GL_TRUE);
+
+    // Criamos uma janela do sistema operacional, com width colunas e height
+    // linhas de pixels, e um contexto OpenGL 3.3, suficiente para todo o jogo.
+    // Só com o backend de desenho indireto pedido (g_MultiDrawRequested)
+    // tentamos antes um contexto OpenGL 4.5, onde ele costuma estar
+    // disponível (veja multi_draw.h).
+    static const int context_versions[][2] = { { 4, 5 }, { 3, 3 } };
+    const size_t num_context_versions = sizeof(context_versions) / sizeof(context_versions[0]);
+    GLFWwindow* window = NULL;
+    for (size_t i = g_MultiDrawRequested ? 0 : 1; i < num_context_versions && !window; ++i)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, context_versions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, context_versions[i][1]);
 
-    // Criamos uma janela do sistema operacional, com 800 colunas e 600 linhas
-    // de pixels
-    GLFWwindow* window;
-    window = glfwCreateWindow(1000, 800, "Carpa Diem - De Boa na Lagoa", NULL, NULL);
+        // Só a última tentativa reporta erros
+        glfwSetErrorCallback(i + 1 == num_context_versions ? ErrorCallback : NULL);
+        window = glfwCreateWindow(width, height, "Carpa Diem - De Boa na Lagoa", NULL, NULL);
+    }
+    glfwSetErrorCallback(ErrorCallback);
     if (!window)
     {
         glfwTerminate();
@@ -1690,53 +3394,74 @@ void InitializeOpenGL()
 }
 
 
+// Matriz "model" do mapa: terreno, árvores e água
+glm::mat4 MapModelMatrix()
+{
+    return Matrix_Translate(0.0f,-1.1f,0.0f) * Matrix_Scale(MAP_SCALE, MAP_SCALE, MAP_SCALE);
+}
+
+// Lado aproximado (no mundo) de um bloco do terreno. O número de blocos cresce
+// com o mapa; o custo dos blocos distantes é limitado pelo geomipmapping.
+static const float TERRAIN_CHUNK_SIZE = 7.5f;
+
 void LoadGameResources()
 {
-    // Carregamos os shaders de vértices e de fragmentos que serão utilizados
-    // para renderização. Veja slides 180-200 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
-    //
-    LoadShadersFromFiles();
+    // Leitura de modelos e imagens acontece em paralelo em um pool de threads.
+    // Os uploads são feitos na ordem de submissão, mantendo os nomes em
+    // g_VirtualScene e as unidades de textura iguais às do carregamento serial.
+    AssetLoader_Start();
+
+    // Funcionalidades opcionais do driver (program binaries, ...)
+    GLExtensions_Init();
+    UniformBuffers_Init();
+    TransientBuffer_Init();
+    MultiDraw_Init();
+    Occlusion_Init();
+    FrameTiming_Init();
+    g_MultiDrawEnabled = MultiDrawAvailable();
+
+    // O terreno é reamostrado em um heightfield com níveis de detalhe por
+    // bloco (veja terrain.h), em vez de ir inteiro para a cena virtual
+    int terrain_chunks = std::max(1, (int)std::ceil(MAP_SIZE / TERRAIN_CHUNK_SIZE));
+    Terrain_Load(&g_Terrain, "../../data/models/terrain.obj", terrain_chunks, MapModelMatrix());
+
+    // A água não tem malha: uma grade gerada na GPU (veja water.h), sobre a
+    // mesma área do mapa
+    Water_Init(glm::vec2(-MAP_SCALE, -MAP_SCALE), glm::vec2(MAP_SCALE, MAP_SCALE));
+
+    // Construímos a representação de objetos geométricos através de malhas de
+    // triângulos. Modelos já cozidos são mapeados direto do disco. As árvores
+    // são estáticas e espalhadas pelo mapa: viram um lote por região, desenhado
+    // com uma só chamada, para que o culling descarte os que estão fora da tela.
+    LoadModelToVirtualScene("../../data/models/trees.obj", MESH_BUILD_INSTANCING | MESH_BUILD_STATIC_BATCH | MESH_BUILD_CLUSTERS);
+    LoadModelToVirtualScene("../../data/models/boat.obj");
+    LoadModelToVirtualScene("../../data/models/fish.obj");
+    LoadModelToVirtualScene("../../data/models/bait.obj");
+    LoadModelToVirtualScene("../../data/models/cube.obj");
 
     // Carregamos as imagens para serem utilizadas como textura
     LoadTextureImage("../../data/textures/boat.tga");
     LoadTextureImage("../../data/textures/fish.png");
     LoadTextureImage("../../data/textures/cube.png");
 
-    // Inicializar skybox (gera textura procedural de céu)
+    // Inicializar skybox (as faces do cubemap também vão para o pool)
     InitializeSkybox(g_Skybox);
 
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
-    ObjModel terrainmodel("../../data/models/terrain.obj");
-    ComputeNormals(&terrainmodel);
-    BuildTrianglesAndAddToVirtualScene(&terrainmodel);
-
-    ObjModel treesmodel("../../data/models/trees.obj");
-    ComputeNormals(&treesmodel);
-    BuildTrianglesAndAddToVirtualScene(&treesmodel);
-
-    ObjModel watermodel("../../data/models/water.obj");
-    ComputeNormals(&watermodel);
-    BuildTrianglesAndAddToVirtualScene(&watermodel);
-
-    ObjModel boatmodel("../../data/models/boat.obj");
-    ComputeNormals(&boatmodel);
-    BuildTrianglesAndAddToVirtualScene(&boatmodel);
-
-    ObjModel fishmodel("../../data/models/fish.obj");
-    ComputeNormals(&fishmodel);
-    BuildTrianglesAndAddToVirtualScene(&fishmodel);
-
-    ObjModel baitmodel("../../data/models/bait.obj");
-    ComputeNormals(&baitmodel);
-    BuildTrianglesAndAddToVirtualScene(&baitmodel);
+    // Enquanto as threads trabalham, compilamos os shaders de vértices e de
+    // fragmentos que serão utilizados para renderização. Veja slides 180-200
+    // do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
+    //
+    LoadShadersFromFiles();
 
-    ObjModel cubemodel("../../data/models/cube.obj");
-    ComputeNormals(&cubemodel);
-    BuildTrianglesAndAddToVirtualScene(&cubemodel);
+    // Enviamos para a GPU tudo que as threads prepararam
+    AssetLoader_Finish();
+    AssetRegistry_PrintStats();
 }
 
 void UpdateCameras(glm::mat4& view, glm::vec4& camera_position, glm::mat4& projection)
 {
+    InterpolateRenderState();
+
     if (g_CurrentCamera == DEBUG_CAMERA) {
         SetupDebugCamera(view, camera_position);
     } else if (g_CurrentGameState == NAVIGATION_PHASE) {
@@ -1754,163 +3479,294 @@ void UpdateCameras(glm::mat4& view, glm::vec4& camera_position, glm::mat4& proje
 
 }
 
+// Handles dos objetos desenhados por RenderScene(). Os nomes são resolvidos
+// só quando a cena muda (g_VirtualSceneRevision), não a cada quadro.
+struct RenderObjects
+{
+    unsigned int      revision;
+    SceneObjectHandle cube;
+    SceneObjectHandle fish;
+    SceneObjectHandle lure;
+    SceneObjectHandle hook;
+    SceneObjectHandle boat;
+    SceneObjectHandle rod;
+    std::vector<SceneObjectHandle> trees; // "Tree", "Tree.1", ..., "Tree.399" existentes (com o lote estático, um por região)
+};
+
+RenderObjects g_RenderObjects = { ~0u };
+
+// Objetos estáticos: desenhados todo quadro com a mesma matriz "model"
+// (árvores e cubos; o terreno e a água tem seu próprio culling, veja terrain.h). Ficam em uma BVH, reconstruída quando a
+// cena muda, e vão para a fila por SubmitStaticScene().
+struct StaticDraw
+{
+    SceneObjectHandle object;
+    glm::mat4         model;
+    int               object_id;
+    int               pass;
+    bool              occludee;  // Participa do culling por oclusão
+};
+
+struct StaticScene
+{
+    std::vector<StaticDraw> draws;
+    std::vector<glm::vec3>  box_min; // Caixas de draws[] no espaço do mundo
+    std::vector<glm::vec3>  box_max;
+    CullingBvh              bvh;
+    std::vector<int>        visible; // Índices em draws[] visíveis no quadro atual
+};
+
+StaticScene g_StaticScene;
+
+static void AddStaticDraw(SceneObjectHandle object, const glm::mat4& model, int object_id, bool occludee, int pass = RENDER_PASS_OPAQUE)
+{
+    if (object < 0 || object >= (SceneObjectHandle)g_DrawRecords.size() || g_DrawRecords[object].num_lods == 0)
+        return;
+
+    StaticDraw draw = { object, model, object_id, pass, occludee };
+    g_StaticScene.draws.push_back(draw);
+}
+
+void BuildStaticScene()
+{
+    g_StaticScene.draws.clear();
+
+    glm::mat4 map_model = MapModelMatrix();
+    for (size_t i = 0; i < g_RenderObjects.trees.size(); i++)
+        AddStaticDraw(g_RenderObjects.trees[i], map_model, TREE, true);
+    for (int i = 0; i < NUM_CUBES; i++)
+    {
+        glm::mat4 model = Matrix_Translate(g_Cubes[i].position.x, g_Cubes[i].position.y, g_Cubes[i].position.z)
+                        * Matrix_Scale(g_Cubes[i].size.x, g_Cubes[i].size.y, g_Cubes[i].size.z);
+        AddStaticDraw(g_RenderObjects.cube, model, CUBE, true);
+    }
+
+    size_t num_draws = g_StaticScene.draws.size();
+    g_StaticScene.box_min.resize(num_draws);
+    g_StaticScene.box_max.resize(num_draws);
+    for (size_t i = 0; i < num_draws; ++i)
+    {
+        const StaticDraw& draw = g_StaticScene.draws[i];
+        const DrawRecord& object = g_DrawRecords[draw.object];
+        Culling_TransformBox(draw.model, object.bounds_min, object.bounds_max, &g_StaticScene.box_min[i], &g_StaticScene.box_max[i]);
+    }
+    CullingBvh_Build(&g_StaticScene.bvh, g_StaticScene.box_min, g_StaticScene.box_max);
+
+    // Uma consulta de oclusão por objeto estático (os índices de draws[])
+    Occlusion_Resize(num_draws);
+
+    printf("Cena estática: %d objetos, %d nós na BVH\n", (int)num_draws, (int)g_StaticScene.bvh.nodes.size());
+}
+
+// Enfileira os objetos estáticos que tocam o frustum da câmera. Na FASE DE
+// PESCA, árvores e cubos também passam pelo culling por oclusão.
+void SubmitStaticScene()
+{
+    bool occlusion = g_OcclusionCullingEnabled && g_CurrentGameState == FISHING_PHASE;
+
+    std::vector<int>& visible = g_StaticScene.visible;
+    visible.clear();
+    if (g_FrustumCullingEnabled)
+    {
+        CullingBvh_Query(g_StaticScene.bvh, g_CameraFrustum, &visible);
+    }
+    else
+    {
+        for (size_t i = 0; i < g_StaticScene.draws.size(); ++i)
+            visible.push_back((int)i);
+        g_CullingStats.visible += visible.size();
+    }
+
+    // A BVH devolve os objetos agrupados por região; voltamos à ordem de
+    // submissão, que desempata chaves iguais na fila
+    std::sort(visible.begin(), visible.end());
+    for (size_t i = 0; i < visible.size(); ++i)
+    {
+        int index = visible[i];
+        const StaticDraw& draw = g_StaticScene.draws[index];
+
+        GLuint occlusion_query = 0;
+        if (occlusion && draw.occludee)
+            occlusion_query = Occlusion_Test(index, g_StaticScene.box_min[index], g_StaticScene.box_max[index]);
+        EnqueueVirtualObject(draw.object, draw.model, draw.object_id, draw.pass, occlusion_query);
+    }
+}
+
+void ResolveRenderObjects()
+{
+    if (g_RenderObjects.revision == g_VirtualSceneRevision)
+        return;
+
+    g_RenderObjects.revision = g_VirtualSceneRevision;
+    g_RenderObjects.cube     = FindSceneObject("cube");
+    g_RenderObjects.fish     = FindSceneObject("fish_Cube");
+    g_RenderObjects.lure     = FindSceneObject("FishingLure");
+    g_RenderObjects.hook     = FindSceneObject("hook");
+    g_RenderObjects.boat     = FindSceneObject("boat01");
+    g_RenderObjects.rod      = FindSceneObject("fishing_pole_01");
+
+    g_RenderObjects.trees.clear();
+    g_RenderObjects.trees.push_back(FindSceneObject("Tree"));
+    for (int i = 1; i <= 399; i++) {
+        SceneObjectHandle tree = FindSceneObject("Tree." + std::to_string(i));
+        if (tree != INVALID_SCENE_OBJECT)
+            g_RenderObjects.trees.push_back(tree);
+    }
+
+    BuildStaticScene();
+}
+
 void RenderScene(GLFWwindow* window, const glm::mat4& view, const glm::mat4& projection)
 {
-    // =====================================================================
-    // Renderizar Skybox primeiro (fundo do céu)
-    // =====================================================================
-    RenderSkybox(g_Skybox, view, projection);
+    // Câmera usada na seleção de níveis de detalhe (veja SelectLod())
+    g_CameraView = view;
+    g_CameraProjection = projection;
+    g_CameraFrustum = Culling_ExtractFrustum(projection * view);
+
+    // Posição da câmera no mundo, usada pelos shaders e pelas consultas de oclusão
+    glm::vec4 camera_position = glm::inverse(view)[3];
+    Occlusion_BeginFrame(glm::vec3(camera_position));
+    g_FrameNumber += 1;
 
-    // Voltar a usar o programa de shader principal
-    glUseProgram(g_GpuProgramID);
+    // Trecho do buffer transitório usado pela linha de pesca e pelo texto
+    TransientBuffer_BeginFrame();
+
+    ResolveRenderObjects();
 
     // Enviamos as matrizes "view" e "projection" para a placa de vídeo
-    // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
-    // efetivamente aplicadas em todos os pontos.
-    glUniformMatrix4fv(g_view_uniform       , 1 , GL_FALSE , glm::value_ptr(view));
-    glUniformMatrix4fv(g_projection_uniform , 1 , GL_FALSE , glm::value_ptr(projection));
+    // (GPU), uma vez por quadro para todos os programas. Veja o bloco
+    // "FrameUniforms" em "shader_vertex.glsl", onde estas são efetivamente
+    // aplicadas em todos os pontos.
+    FrameUniforms frame;
+    frame.view       = view;
+    frame.projection = projection;
+    frame.camera_position = camera_position;
+    UniformBuffers_SetFrame(frame);
+
+    // =====================================================================
+    // Renderizar Skybox primeiro (fundo do céu)
+    // =====================================================================
+    FrameTiming_BeginPass(TIMING_SKYBOX);
+    RenderSkybox(g_Skybox);
+    FrameTiming_EndPass(TIMING_SKYBOX);
 
     // =====================================================================
     // Renderizar objetos do jogo
     // =====================================================================
     
-    #define MAP             0
-    #define BOAT            1
-    #define FISH            2
-    #define BAIT            3
-    #define HOOK            4
-    #define ROD             5
-    #define FISHING_LINE    6
-    #define TREE            7
-    #define WATER           8
-    #define CUBE            9
-
-    // Desenhamos o terreno
-    glm::mat4 model = Matrix_Translate(0.0f,-1.1f,0.0f) * Matrix_Scale(MAP_SCALE, MAP_SCALE, MAP_SCALE);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, MAP);
-    DrawVirtualObject("terrain");
-
-    // Desenhamos as árvores
-    model = Matrix_Translate(0.0f,-1.1f,0.0f) * Matrix_Scale(MAP_SCALE, MAP_SCALE, MAP_SCALE);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, TREE);
-    DrawVirtualObject("Tree");
-    for (int i = 1; i <= 399; i++) {
-        std::string tree_name = "Tree." + std::to_string(i);
-        if (g_VirtualScene.find(tree_name) != g_VirtualScene.end()) {
-            model = Matrix_Translate(0.0f,-1.1f,0.0f) * Matrix_Scale(MAP_SCALE, MAP_SCALE, MAP_SCALE);
-            glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, TREE);
-            DrawVirtualObject(tree_name.c_str());
-        }
-    }
-
-    // Desenhamos os cubos
-    for (int i = 0; i < NUM_CUBES; i++) {
-        model = Matrix_Translate(g_Cubes[i].position.x, g_Cubes[i].position.y, g_Cubes[i].position.z)
-                * Matrix_Scale(g_Cubes[i].size.x, g_Cubes[i].size.y, g_Cubes[i].size.z);
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, CUBE);
-        DrawVirtualObject("cube");
-    }
+    // Desenhamos as árvores e os cubos (objetos estáticos,
+    // descartados pela BVH quando fora da tela)
+    SubmitStaticScene();
 
     // Desenhamos objetos subaquáticos
+    glm::mat4 model;
     if (g_CurrentGameState == FISHING_PHASE) {
         // Desenhamos o peixe
-        model = Matrix_Translate(g_Fish.position.x, g_Fish.position.y, g_Fish.position.z) 
-                * Matrix_Rotate_Y(g_Fish.rotation_y)
+        model = Matrix_Translate(g_RenderFish.position.x, g_RenderFish.position.y, g_RenderFish.position.z) 
+                * Matrix_Rotate_Y(g_RenderFish.rotation_y)
                 * Matrix_Scale(0.1f, 0.1f, 0.1f);
-        glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(g_object_id_uniform, FISH);
-        DrawVirtualObject("fish_Cube");
+        SubmitVirtualObject(g_RenderObjects.fish, model, FISH);
 
-        if (g_Bait.is_launched && g_Bait.is_in_water) {
+        if (g_RenderBait.is_launched && g_RenderBait.is_in_water) {
             // Desenhamos a isca subaquática
-            model = Matrix_Translate(g_Bait.position.x, g_Bait.position.y, g_Bait.position.z)
+            model = Matrix_Translate(g_RenderBait.position.x, g_RenderBait.position.y, g_RenderBait.position.z)
                     * Matrix_Rotate_X(-M_PI_2)
                     * Matrix_Scale(0.05f, 0.05f, 0.05f);
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BAIT);
-            DrawVirtualObject("FishingLure");
+            SubmitVirtualObject(g_RenderObjects.lure, model, BAIT);
             
             // Desenhamos o anzol subaquático
-            model = Matrix_Translate(g_Bait.position.x, g_Bait.position.y - 0.1f, g_Bait.position.z) 
+            model = Matrix_Translate(g_RenderBait.position.x, g_RenderBait.position.y - 0.1f, g_RenderBait.position.z) 
                     * Matrix_Rotate_X(-M_PI_2)
                     * Matrix_Scale(0.1f, 0.1f, 0.1f);
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, HOOK);
-            DrawVirtualObject("hook");
+            SubmitVirtualObject(g_RenderObjects.hook, model, HOOK);
         }
     }
 
-    // Desenhamos a água (com blending para transparência)
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    model = Matrix_Translate(0.0f,-1.1f,0.0f) * Matrix_Scale(MAP_SCALE, MAP_SCALE, MAP_SCALE);
-    glUniformMatrix4fv(g_model_uniform, 1 , GL_FALSE , glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, WATER);
-    DrawVirtualObject("water");
-
     // Desenhamos o barco
-    model = Matrix_Translate(g_Boat.position.x, g_Boat.position.y - 1.7f, g_Boat.position.z) 
-            * Matrix_Rotate_Y(g_Boat.rotation_y + M_PI_2) // Ajuste de orientação do modelo
+    model = Matrix_Translate(g_RenderBoat.position.x, g_RenderBoat.position.y - 1.7f, g_RenderBoat.position.z) 
+            * Matrix_Rotate_Y(g_RenderBoat.rotation_y)
+            * Matrix_Rotate_X(g_RenderBoat.pitch)  // Inclinação das ondas (veja UpdateBoatFloating())
+            * Matrix_Rotate_Z(g_RenderBoat.roll)
+            * Matrix_Rotate_Y(M_PI_2) // Ajuste de orientação do modelo
             * Matrix_Scale(0.01f, 0.01f, 0.01f);
-    glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    glUniform1i(g_object_id_uniform, BOAT);
-    DrawVirtualObject("boat01");
+    SubmitVirtualObject(g_RenderObjects.boat, model, BOAT);
 
+    bool draw_fishing_line = false;
     if (g_CurrentGameState == FISHING_PHASE) {
         // Renderizar vara de pesca (presa à câmera como em FPS)
         if (g_CurrentCamera == GAME_CAMERA) {
             // Rotação da câmera
-            float corrected_rotation = g_Boat.rotation_y + g_CameraTheta;
+            float corrected_rotation = g_RenderBoat.rotation_y + g_CameraTheta;
             
             // Transformação da vara: posicionar relativo à câmera
-            model = Matrix_Translate(g_Boat.position.x, g_Boat.position.y + WATER_SURFACE_Y + 0.8f, g_Boat.position.z)
+            model = Matrix_Translate(g_RenderBoat.position.x, g_RenderBoat.position.y + WATER_SURFACE_Y + 0.8f, g_RenderBoat.position.z)
                   * Matrix_Rotate_Y(corrected_rotation)
                   * Matrix_Translate(g_RodOffset.x, g_RodOffset.y, g_RodOffset.z)
                   * Matrix_Rotate_Y(-M_PI_2)  // Ajustar orientação da vara
                   * Matrix_Rotate_Z(-M_PI / 6.0f)  // Inclinar vara
                   * Matrix_Scale(0.08f, 0.08f, 0.08f);
             
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, ROD);
-            DrawVirtualObject("fishing_pole_01");
-            
-            // Desenhar linha de pesca
-            FishingLineRenderInfo line_render_info;
-            line_render_info.program_id = g_GpuProgramID;
-            line_render_info.model_uniform = g_model_uniform;
-            line_render_info.object_id_uniform = g_object_id_uniform;
-            line_render_info.bbox_min_uniform = g_bbox_min_uniform;
-            line_render_info.bbox_max_uniform = g_bbox_max_uniform;
-            
-            glm::vec3 rod_tip = GetRodTipPosition();
-            
-            // Se a isca não está lançada, a linha fica recolhida na ponta da vara
-            glm::vec3 line_end = g_Bait.is_launched ? g_Bait.position : rod_tip;
-            DrawFishingLine(rod_tip, line_end, line_render_info);
+            SubmitVirtualObject(g_RenderObjects.rod, model, ROD);
+            draw_fishing_line = true;
         }
         
         // Desenhar isca quando está no ar
-        if (g_Bait.is_launched && !g_Bait.is_in_water) {
-            model = Matrix_Translate(g_Bait.position.x, g_Bait.position.y, g_Bait.position.z)
+        if (g_RenderBait.is_launched && !g_RenderBait.is_in_water) {
+            model = Matrix_Translate(g_RenderBait.position.x, g_RenderBait.position.y, g_RenderBait.position.z)
                     * Matrix_Rotate_X(-M_PI_2)
                     * Matrix_Scale(0.05f, 0.05f, 0.05f);
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, BAIT);
-            DrawVirtualObject("FishingLure");
+            SubmitVirtualObject(g_RenderObjects.lure, model, BAIT);
             
-            model = Matrix_Translate(g_Bait.position.x, g_Bait.position.y - 0.1f, g_Bait.position.z) 
+            model = Matrix_Translate(g_RenderBait.position.x, g_RenderBait.position.y - 0.1f, g_RenderBait.position.z) 
                     * Matrix_Rotate_X(-M_PI_2)
                     * Matrix_Scale(0.1f, 0.1f, 0.1f);
-            glUniformMatrix4fv(g_model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-            glUniform1i(g_object_id_uniform, HOOK);
-            DrawVirtualObject("hook");
+            SubmitVirtualObject(g_RenderObjects.hook, model, HOOK);
         }
     }
+
+    // Os shaders da cena escrevem cores lineares; com um framebuffer sRGB a
+    // conversão (e o blending da água) fica com o OpenGL. Skybox e texto já
+    // estão em sRGB e são desenhados sem conversão.
+    if (g_GLExtensions.srgb_framebuffer)
+        glEnable(GL_FRAMEBUFFER_SRGB);
+
+    // O terreno vem primeiro: é o principal oclusor dos demais objetos
+    FrameTiming_BeginPass(TIMING_OPAQUE);
+    Terrain_Render(&g_Terrain, GpuProgramForObject(MAP), glm::vec3(camera_position),
+        g_FrustumCullingEnabled ? &g_CameraFrustum : NULL, g_LodEnabled);
+
+    // Todos os objetos da cena, ordenados para minimizar trocas de estado
+    FlushRenderQueue();
+    FrameTiming_EndPass(TIMING_OPAQUE);
+
+    // A água, transparente, depois de todos os opacos
+    FrameTiming_BeginPass(TIMING_WATER);
+    Water_Render(GpuProgramForObject(WATER), glm::vec3(camera_position), g_RenderTime);
+    FrameTiming_EndPass(TIMING_WATER);
+
+    // Caixas das consultas de oclusão, testadas contra a profundidade da cena
+    // (os resultados condicionam os desenhos do próximo quadro)
+    Occlusion_IssueQueries();
+
+    if (draw_fishing_line) {
+        // Desenhar linha de pesca
+        FishingLineRenderInfo line_render_info;
+        line_render_info.program_id = GpuProgramForObject(FISHING_LINE);
+
+        glm::vec3 rod_tip = GetRodTipPosition(g_RenderBoat);
+
+        // Se a isca não está lançada, a linha fica recolhida na ponta da vara
+        glm::vec3 line_end = g_RenderBait.is_launched ? g_RenderBait.position : rod_tip;
+        DrawFishingLine(rod_tip, line_end, line_render_info);
+    }
+    glDisable(GL_FRAMEBUFFER_SRGB);
+
+    RenderStats_EndFrame();
+    CullingStats_EndFrame();
+    OcclusionStats_EndFrame();
     
+    FrameTiming_BeginPass(TIMING_HUD);
+
     // Mostrar estado atual do jogo
     if (g_ShowInfoText) {
         std::string game_state = (g_CurrentGameState == NAVIGATION_PHASE) ? "FASE DE NAVEGAÇÃO" : "FASE DE PESCA";
@@ -1948,4 +3804,12 @@ void RenderScene(GLFWwindow* window, const glm::mat4& view, const glm::mat4& pro
     }
 
     TextRendering_ShowFramesPerSecond(window);
+    TextRendering_ShowRenderStats(window);
+    TextRendering_ShowFrameTiming(window);
+
+    // Todo o texto do quadro, em um único desenho
+    TextRendering_Flush();
+    FrameTiming_EndPass(TIMING_HUD);
+
+    TransientBuffer_EndFrame();
 }
\ No newline at end of file
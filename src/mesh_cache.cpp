@@ -0,0 +1,580 @@
+// mesh_cache.cpp - Formato binário "cozido" de malhas
+//
+// Ler um OBJ texto com a tinyobjloader, computar normais e montar os streams
+// de vértices custa caro a cada inicialização (bait.obj tem quase 3 MB). Após
+// o primeiro carregamento gravamos os streams finais em um arquivo ".mesh" ao
+// lado do OBJ. Nas execuções seguintes este arquivo é mapeado em memória e os
+// ponteiros são entregues diretamente para glBufferData(), sem cópias. Os
+// vértices já são gravados no formato compacto de vertex_format.h.
+//
+// Layout do arquivo (tudo em ordem de bytes nativa, seções alinhadas em 16 bytes):
+//
+//   CookedHeader
+//   CookedDependency[num_dependencies]   OBJ e MTLs usados para gerar a malha
+//   CookedShape[num_shapes]
+//   strings                              caminhos e nomes dos objetos
+//   vertices                             PackedVertex[num_vertices] (stride conforme vertex_flags)
+//   indices                              GLuint[num_indices]
+//   instances                            float[MESH_INSTANCE_FLOATS * num_instances]
+//
+// O arquivo é considerado desatualizado se a versão do formato mudou ou se o
+// tamanho/data de modificação de alguma dependência não confere. Nesse caso o
+// chamador volta para o caminho do OBJ e regrava o arquivo cozido.
+
+#include "mesh_cache.h"
+#include "vertex_format.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fstream>
+#include <algorithm>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// Incrementar sempre que o layout do arquivo ou o conteúdo dos streams mudar.
+static const uint32_t COOKED_MESH_VERSION = 7;
+static const char     COOKED_MESH_MAGIC[4] = { 'C', 'M', 'S', 'H' };
+
+struct CookedHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t num_dependencies;
+    uint32_t num_shapes;
+    uint32_t vertex_flags;
+    uint32_t build_flags; // MESH_BUILD_*
+    uint64_t num_vertices;
+    uint64_t num_indices;
+    uint64_t dependencies_offset;
+    uint64_t shapes_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t vertices_offset;
+    uint64_t indices_offset;
+    uint64_t num_instances;
+    uint64_t instances_offset;
+    uint64_t file_size;
+};
+
+struct CookedDependency
+{
+    uint32_t path_offset; // Dentro da seção de strings
+    uint32_t path_length;
+    uint64_t size;
+    int64_t  mtime;
+};
+
+struct CookedShape
+{
+    uint32_t name_offset; // Dentro da seção de strings
+    uint32_t name_length;
+    uint64_t first_index;
+    uint64_t num_indices;
+    uint64_t first_vertex;
+    uint64_t num_vertices;
+    float    bbox_min[3];
+    float    bbox_max[3];
+    float    material_kd[3];
+    uint32_t num_lods;
+    uint64_t lod_first_index[MESH_MAX_LODS];
+    uint64_t lod_num_indices[MESH_MAX_LODS];
+    float    lod_error[MESH_MAX_LODS];
+    uint64_t first_instance;
+    uint64_t num_instances;
+};
+
+static uint64_t AlignUp(uint64_t value)
+{
+    return (value + 15) & ~(uint64_t)15;
+}
+
+static bool StatFile(const std::string& path, uint64_t* size, int64_t* mtime)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+    *size  = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+// Lista os arquivos dos quais a malha depende: o próprio OBJ e os MTLs
+// referenciados por "mtllib". As declarações "mtllib" ficam no cabeçalho do
+// OBJ, então paramos de ler na primeira linha de geometria.
+static std::vector<std::string> ListDependencies(const char* obj_filename)
+{
+    std::vector<std::string> dependencies;
+    dependencies.push_back(obj_filename);
+
+    std::string fullpath(obj_filename);
+    std::string dirname;
+    size_t slash = fullpath.find_last_of("/");
+    if (slash != std::string::npos)
+        dirname = fullpath.substr(0, slash + 1);
+
+    std::ifstream file(obj_filename);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.compare(0, 2, "v ") == 0 || line.compare(0, 2, "f ") == 0)
+            break;
+        if (line.compare(0, 7, "mtllib ") == 0)
+        {
+            std::string mtl = line.substr(7);
+            while (!mtl.empty() && (mtl[mtl.size()-1] == '\r' || mtl[mtl.size()-1] == ' '))
+                mtl.erase(mtl.size()-1);
+            if (!mtl.empty())
+                dependencies.push_back(dirname + mtl);
+        }
+    }
+
+    return dependencies;
+}
+
+void MeshData_PackVertices(MeshData* mesh)
+{
+    size_t num_vertices = mesh->model_coefficients.size() / 4;
+
+    mesh->vertex_flags = 0;
+    if (mesh->normal_coefficients.size() == 4*num_vertices && num_vertices > 0)
+        mesh->vertex_flags |= VERTEX_FORMAT_NORMALS;
+    if (mesh->texture_coefficients.size() == 2*num_vertices && num_vertices > 0)
+        mesh->vertex_flags |= VERTEX_FORMAT_TEXCOORDS;
+    if (mesh->color_coefficients.size() == 3*num_vertices && num_vertices > 0)
+        mesh->vertex_flags |= VERTEX_FORMAT_COLORS;
+
+    size_t stride = VertexFormat_Stride(mesh->vertex_flags);
+    size_t color_offset = VertexFormat_ColorOffset(mesh->vertex_flags);
+    mesh->vertices.assign(num_vertices * stride, 0);
+
+    for (size_t s = 0; s < mesh->shapes.size(); ++s)
+    {
+        const MeshShape& shape = mesh->shapes[s];
+
+        for (size_t v = shape.first_vertex; v < shape.first_vertex + shape.num_vertices; ++v)
+        {
+            PackedVertex packed;
+            memset(&packed, 0, sizeof(packed));
+
+            const float* p = &mesh->model_coefficients[4*v];
+            VertexFormat_EncodePosition(glm::vec3(p[0], p[1], p[2]), shape.bbox_min, shape.bbox_max, packed.position);
+
+            if (mesh->vertex_flags & VERTEX_FORMAT_NORMALS)
+            {
+                const float* n = &mesh->normal_coefficients[4*v];
+                VertexFormat_EncodeNormal(glm::vec3(n[0], n[1], n[2]), packed.normal);
+            }
+
+            if (mesh->vertex_flags & VERTEX_FORMAT_TEXCOORDS)
+            {
+                packed.texcoord[0] = VertexFormat_EncodeHalf(mesh->texture_coefficients[2*v + 0]);
+                packed.texcoord[1] = VertexFormat_EncodeHalf(mesh->texture_coefficients[2*v + 1]);
+            }
+
+            memcpy(&mesh->vertices[v * stride], &packed, color_offset);
+
+            if (mesh->vertex_flags & VERTEX_FORMAT_COLORS)
+            {
+                const float* c = &mesh->color_coefficients[3*v];
+                GLushort color[4];
+                VertexFormat_EncodeColor(glm::vec3(c[0], c[1], c[2]), color);
+                memcpy(&mesh->vertices[v * stride + color_offset], color, sizeof(color));
+            }
+        }
+    }
+}
+
+// Copia os elementos [first, first + count) de "stream", com "width" floats por
+// vértice, para o final de "out". Streams vazios (atributo ausente) são ignorados.
+static void AppendVertexRange(std::vector<float>* out, const std::vector<float>& stream, size_t width, size_t first, size_t count)
+{
+    if (stream.empty())
+        return;
+    out->insert(out->end(), stream.begin() + first*width, stream.begin() + (first + count)*width);
+}
+
+void MeshData_ReorderShapes(MeshData* mesh, const std::vector<size_t>& order)
+{
+    MeshData result;
+    result.instance_transforms = mesh->instance_transforms;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        MeshShape shape = mesh->shapes[order[i]];
+        assert(shape.num_lods == 1);
+
+        size_t first_vertex = result.model_coefficients.size() / 4;
+        size_t first_index  = result.indices.size();
+        AppendVertexRange(&result.model_coefficients,   mesh->model_coefficients,   4, shape.first_vertex, shape.num_vertices);
+        AppendVertexRange(&result.normal_coefficients,  mesh->normal_coefficients,  4, shape.first_vertex, shape.num_vertices);
+        AppendVertexRange(&result.texture_coefficients, mesh->texture_coefficients, 2, shape.first_vertex, shape.num_vertices);
+        AppendVertexRange(&result.color_coefficients,   mesh->color_coefficients,   3, shape.first_vertex, shape.num_vertices);
+
+        for (size_t k = 0; k < shape.num_indices; ++k)
+            result.indices.push_back((GLuint)(mesh->indices[shape.first_index + k] - shape.first_vertex + first_vertex));
+
+        shape.first_vertex        = first_vertex;
+        shape.first_index         = first_index;
+        shape.lods[0].first_index = first_index;
+        result.shapes.push_back(shape);
+    }
+
+    *mesh = result;
+}
+
+MeshView MeshData_View(const MeshData& mesh)
+{
+    MeshView view;
+    view.vertices     = mesh.vertices.data();
+    view.num_vertices = mesh.vertices.size() / VertexFormat_Stride(mesh.vertex_flags);
+    view.vertex_flags = mesh.vertex_flags;
+    view.indices      = mesh.indices.data();
+    view.num_indices  = mesh.indices.size();
+    view.instance_transforms = mesh.instance_transforms.data();
+    view.num_instances       = mesh.instance_transforms.size() / MESH_INSTANCE_FLOATS;
+    view.shapes       = &mesh.shapes;
+    return view;
+}
+
+std::string MeshCache_PathFor(const char* obj_filename)
+{
+    std::string path(obj_filename);
+    size_t dot = path.find_last_of(".");
+    size_t slash = path.find_last_of("/");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        path.erase(dot);
+    return path + ".mesh";
+}
+
+static void* MapFile(const std::string& path, size_t* size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return NULL;
+
+    // A view mantém o mapeamento vivo mesmo após fecharmos os handles
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    *size = (size_t)file_size.QuadPart;
+    return data;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *size = (size_t)st.st_size;
+    return data;
+#endif
+}
+
+static void UnmapFile(void* data, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+static bool SectionFits(uint64_t offset, uint64_t count, uint64_t element_size, uint64_t file_size)
+{
+    if (offset > file_size)
+        return false;
+    return count <= (file_size - offset) / element_size;
+}
+
+bool MeshCache_Open(const char* obj_filename, unsigned int build_flags, CookedMesh* cooked)
+{
+    std::string path = MeshCache_PathFor(obj_filename);
+
+    size_t size = 0;
+    void* data = MapFile(path, &size);
+    if (data == NULL)
+        return false;
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    const CookedHeader* header = (const CookedHeader*)bytes;
+
+    bool ok = size >= sizeof(CookedHeader)
+           && memcmp(header->magic, COOKED_MESH_MAGIC, 4) == 0
+           && header->version == COOKED_MESH_VERSION
+           && header->file_size == size
+           && header->build_flags == build_flags
+           && SectionFits(header->dependencies_offset, header->num_dependencies, sizeof(CookedDependency), size)
+           && SectionFits(header->shapes_offset, header->num_shapes, sizeof(CookedShape), size)
+           && SectionFits(header->strings_offset, header->strings_size, 1, size)
+           && (header->vertex_flags & ~(uint32_t)(VERTEX_FORMAT_NORMALS | VERTEX_FORMAT_TEXCOORDS | VERTEX_FORMAT_COLORS)) == 0
+           && SectionFits(header->vertices_offset, header->num_vertices, VertexFormat_Stride(header->vertex_flags), size)
+           && SectionFits(header->indices_offset, header->num_indices, sizeof(GLuint), size)
+           && SectionFits(header->instances_offset, header->num_instances, MESH_INSTANCE_FLOATS * sizeof(float), size);
+
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Arquivo cozido \"%s\" inválido ou de versão antiga.\n", path.c_str());
+        UnmapFile(data, size);
+        return false;
+    }
+
+    const char* strings = (const char*)(bytes + header->strings_offset);
+
+    // Verificamos se o OBJ/MTL de origem mudaram desde que a malha foi cozida
+    const CookedDependency* dependencies = (const CookedDependency*)(bytes + header->dependencies_offset);
+    for (uint32_t i = 0; i < header->num_dependencies && ok; ++i)
+    {
+        const CookedDependency& dep = dependencies[i];
+        if ((uint64_t)dep.path_offset + dep.path_length > header->strings_size)
+        {
+            ok = false;
+            break;
+        }
+
+        std::string dep_path(strings + dep.path_offset, dep.path_length);
+        uint64_t dep_size;
+        int64_t  dep_mtime;
+        if (!StatFile(dep_path, &dep_size, &dep_mtime) || dep_size != dep.size || dep_mtime != dep.mtime)
+        {
+            printf("Arquivo cozido \"%s\" desatualizado (\"%s\" mudou).\n", path.c_str(), dep_path.c_str());
+            ok = false;
+        }
+    }
+
+    const CookedShape* shapes = (const CookedShape*)(bytes + header->shapes_offset);
+    cooked->shapes.clear();
+    cooked->shapes.reserve(header->num_shapes);
+    for (uint32_t i = 0; i < header->num_shapes && ok; ++i)
+    {
+        const CookedShape& record = shapes[i];
+        if ((uint64_t)record.name_offset + record.name_length > header->strings_size
+            || record.first_index + record.num_indices > header->num_indices
+            || record.first_vertex + record.num_vertices > header->num_vertices
+            || record.first_instance + record.num_instances > header->num_instances
+            || record.num_lods < 1 || record.num_lods > MESH_MAX_LODS)
+        {
+            ok = false;
+            break;
+        }
+
+        MeshShape shape;
+        shape.name        = std::string(strings + record.name_offset, record.name_length);
+        shape.first_index = (size_t)record.first_index;
+        shape.num_indices = (size_t)record.num_indices;
+        shape.first_vertex = (size_t)record.first_vertex;
+        shape.num_vertices = (size_t)record.num_vertices;
+        shape.bbox_min    = glm::vec3(record.bbox_min[0], record.bbox_min[1], record.bbox_min[2]);
+        shape.bbox_max    = glm::vec3(record.bbox_max[0], record.bbox_max[1], record.bbox_max[2]);
+        shape.material_kd = glm::vec3(record.material_kd[0], record.material_kd[1], record.material_kd[2]);
+        shape.first_instance = (size_t)record.first_instance;
+        shape.num_instances  = (size_t)record.num_instances;
+        shape.num_lods    = (int)record.num_lods;
+        for (int lod = 0; lod < shape.num_lods; ++lod)
+        {
+            shape.lods[lod].first_index = (size_t)record.lod_first_index[lod];
+            shape.lods[lod].num_indices = (size_t)record.lod_num_indices[lod];
+            shape.lods[lod].error       = record.lod_error[lod];
+            if (record.lod_first_index[lod] + record.lod_num_indices[lod] > header->num_indices)
+                ok = false;
+        }
+        cooked->shapes.push_back(shape);
+    }
+
+    if (!ok)
+    {
+        cooked->shapes.clear();
+        UnmapFile(data, size);
+        return false;
+    }
+
+    cooked->mapping      = data;
+    cooked->mapping_size = size;
+
+    MeshView& view = cooked->view;
+    view.vertices     = bytes + header->vertices_offset;
+    view.num_vertices = (size_t)header->num_vertices;
+    view.vertex_flags = header->vertex_flags;
+    view.indices      = (const GLuint*)(bytes + header->indices_offset);
+    view.num_indices  = (size_t)header->num_indices;
+    view.instance_transforms = (const float*)(bytes + header->instances_offset);
+    view.num_instances       = (size_t)header->num_instances;
+    view.shapes       = &cooked->shapes;
+
+    return true;
+}
+
+void MeshCache_Close(CookedMesh* cooked)
+{
+    if (cooked->mapping != NULL)
+        UnmapFile(cooked->mapping, cooked->mapping_size);
+
+    cooked->mapping = NULL;
+    cooked->mapping_size = 0;
+    cooked->shapes.clear();
+}
+
+bool MeshCache_Write(const char* obj_filename, unsigned int build_flags, const MeshData& mesh)
+{
+    std::string path = MeshCache_PathFor(obj_filename);
+
+    // Montamos a seção de strings e as tabelas de dependências e objetos
+    std::string strings;
+
+    std::vector<std::string> dep_paths = ListDependencies(obj_filename);
+    std::vector<CookedDependency> dependencies;
+    for (size_t i = 0; i < dep_paths.size(); ++i)
+    {
+        CookedDependency dep;
+        int64_t mtime;
+        if (!StatFile(dep_paths[i], &dep.size, &mtime))
+            continue; // MTL inexistente: a tinyobjloader também o ignora
+        dep.mtime       = mtime;
+        dep.path_offset = (uint32_t)strings.size();
+        dep.path_length = (uint32_t)dep_paths[i].size();
+        strings += dep_paths[i];
+        dependencies.push_back(dep);
+    }
+
+    std::vector<CookedShape> shapes(mesh.shapes.size());
+    for (size_t i = 0; i < mesh.shapes.size(); ++i)
+    {
+        const MeshShape& shape = mesh.shapes[i];
+        CookedShape& record = shapes[i];
+        memset(&record, 0, sizeof(record));
+        record.name_offset = (uint32_t)strings.size();
+        record.name_length = (uint32_t)shape.name.size();
+        record.first_index = shape.first_index;
+        record.num_indices = shape.num_indices;
+        record.first_vertex = shape.first_vertex;
+        record.num_vertices = shape.num_vertices;
+        for (int c = 0; c < 3; ++c)
+        {
+            record.bbox_min[c]    = shape.bbox_min[c];
+            record.bbox_max[c]    = shape.bbox_max[c];
+            record.material_kd[c] = shape.material_kd[c];
+        }
+        record.num_lods = (uint32_t)shape.num_lods;
+        for (int lod = 0; lod < shape.num_lods; ++lod)
+        {
+            record.lod_first_index[lod] = shape.lods[lod].first_index;
+            record.lod_num_indices[lod] = shape.lods[lod].num_indices;
+            record.lod_error[lod]       = shape.lods[lod].error;
+        }
+        record.first_instance = shape.first_instance;
+        record.num_instances  = shape.num_instances;
+        strings += shape.name;
+    }
+
+    CookedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COOKED_MESH_MAGIC, 4);
+    header.version                  = COOKED_MESH_VERSION;
+    header.num_dependencies         = (uint32_t)dependencies.size();
+    header.num_shapes               = (uint32_t)shapes.size();
+    header.vertex_flags             = mesh.vertex_flags;
+    header.build_flags              = build_flags;
+    header.num_vertices             = mesh.vertices.size() / VertexFormat_Stride(mesh.vertex_flags);
+    header.num_indices              = mesh.indices.size();
+    header.num_instances            = mesh.instance_transforms.size() / MESH_INSTANCE_FLOATS;
+
+    uint64_t offset = AlignUp(sizeof(CookedHeader));
+    header.dependencies_offset = offset; offset = AlignUp(offset + dependencies.size() * sizeof(CookedDependency));
+    header.shapes_offset       = offset; offset = AlignUp(offset + shapes.size() * sizeof(CookedShape));
+    header.strings_offset      = offset; offset = AlignUp(offset + strings.size());
+    header.strings_size        = strings.size();
+    header.vertices_offset     = offset; offset = AlignUp(offset + mesh.vertices.size());
+    header.indices_offset      = offset; offset = AlignUp(offset + mesh.indices.size() * sizeof(GLuint));
+    header.instances_offset    = offset; offset = offset + mesh.instance_transforms.size() * sizeof(float);
+    header.file_size           = offset;
+
+    // Escrevemos em um arquivo temporário e renomeamos no final, para que uma
+    // execução interrompida nunca deixe um arquivo cozido pela metade.
+    std::string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "WARNING: Não foi possível gravar \"%s\".\n", tmp_path.c_str());
+        return false;
+    }
+
+    struct Section { uint64_t offset; const void* data; size_t size; };
+    Section sections[] = {
+        { 0,                          &header,                          sizeof(header) },
+        { header.dependencies_offset, dependencies.data(),              dependencies.size() * sizeof(CookedDependency) },
+        { header.shapes_offset,       shapes.data(),                    shapes.size() * sizeof(CookedShape) },
+        { header.strings_offset,      strings.data(),                   strings.size() },
+        { header.vertices_offset,     mesh.vertices.data(),             mesh.vertices.size() },
+        { header.indices_offset,      mesh.indices.data(),              mesh.indices.size() * sizeof(GLuint) },
+        { header.instances_offset,    mesh.instance_transforms.data(),  mesh.instance_transforms.size() * sizeof(float) },
+    };
+
+    bool ok = true;
+    uint64_t written = 0;
+    static const char zeros[16] = { 0 };
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]) && ok; ++i)
+    {
+        // Preenchimento até o alinhamento da próxima seção
+        while (written < sections[i].offset && ok)
+        {
+            size_t pad = (size_t)std::min<uint64_t>(sections[i].offset - written, sizeof(zeros));
+            ok = fwrite(zeros, 1, pad, file) == pad;
+            written += pad;
+        }
+        if (sections[i].size > 0)
+            ok = ok && fwrite(sections[i].data, 1, sections[i].size, file) == sections[i].size;
+        written += sections[i].size;
+    }
+
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok)
+    {
+        remove(path.c_str());
+        ok = rename(tmp_path.c_str(), path.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Falha ao gravar arquivo cozido \"%s\".\n", path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+
+    printf("Malha cozida gravada em \"%s\" (%.1f KB).\n", path.c_str(), header.file_size / 1024.0);
+    return true;
+}
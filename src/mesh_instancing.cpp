@@ -0,0 +1,215 @@
+// mesh_instancing.cpp - Detecção de objetos repetidos em uma malha
+//
+// Veja mesh_instancing.h. Para cada par (protótipo, candidato) com a mesma
+// topologia ajustamos por mínimos quadrados a transformação afim q = A p + t
+// entre as posições dos vértices correspondentes e verificamos o erro máximo.
+// As contas são feitas em double: as coordenadas dos OBJs costumam ter só seis
+// casas decimais e objetos pequenos deixariam a matriz mal condicionada em float.
+
+#include "mesh_instancing.h"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+#include <glm/mat3x3.hpp>
+#include <glm/matrix.hpp>
+#include <glm/geometric.hpp>
+
+// Erro máximo de posição, relativo à diagonal da bounding box da cópia
+static const double INSTANCE_POSITION_TOLERANCE = 1e-3;
+
+// Cosseno mínimo entre a normal transformada do protótipo e a da cópia
+static const double INSTANCE_NORMAL_MIN_DOT = 0.998;
+
+// Diferença máxima em coordenadas de textura e cores
+static const float INSTANCE_ATTRIBUTE_TOLERANCE = 1e-5f;
+
+static glm::dvec3 Position(const MeshData& mesh, size_t vertex)
+{
+    const float* p = &mesh.model_coefficients[4*vertex];
+    return glm::dvec3(p[0], p[1], p[2]);
+}
+
+static glm::dvec3 Normal(const MeshData& mesh, size_t vertex)
+{
+    const float* n = &mesh.normal_coefficients[4*vertex];
+    return glm::dvec3(n[0], n[1], n[2]);
+}
+
+static bool SameTopology(const MeshData& mesh, const MeshShape& a, const MeshShape& b)
+{
+    if (a.num_vertices != b.num_vertices || a.num_indices != b.num_indices)
+        return false;
+
+    for (size_t k = 0; k < a.num_indices; ++k)
+        if (mesh.indices[a.first_index + k] - a.first_vertex != mesh.indices[b.first_index + k] - b.first_vertex)
+            return false;
+    return true;
+}
+
+static bool SameAttributes(const std::vector<float>& stream, size_t width, const MeshShape& a, const MeshShape& b)
+{
+    if (stream.empty())
+        return true;
+
+    for (size_t i = 0; i < a.num_vertices * width; ++i)
+        if (std::fabs(stream[a.first_vertex*width + i] - stream[b.first_vertex*width + i]) > INSTANCE_ATTRIBUTE_TOLERANCE)
+            return false;
+    return true;
+}
+
+// Ajusta q = A p + t, com p nos vértices de "prototype" e q nos de "copy".
+// Retorna false se as posições não determinarem A (objeto plano ou
+// degenerado), se A espelhar o objeto ou se o erro passar da tolerância.
+static bool FitAffine(const MeshData& mesh, const MeshShape& prototype, const MeshShape& copy, glm::dmat3* A, glm::dvec3* t)
+{
+    size_t n = prototype.num_vertices;
+    if (n < 4)
+        return false;
+
+    glm::dvec3 p_center(0.0), q_center(0.0);
+    for (size_t v = 0; v < n; ++v)
+    {
+        p_center += Position(mesh, prototype.first_vertex + v);
+        q_center += Position(mesh, copy.first_vertex + v);
+    }
+    p_center /= (double)n;
+    q_center /= (double)n;
+
+    // A = (sum q~ p~^T) (sum p~ p~^T)^-1, com p~ e q~ relativos aos centróides
+    glm::dmat3 PP(0.0), QP(0.0);
+    for (size_t v = 0; v < n; ++v)
+    {
+        glm::dvec3 p = Position(mesh, prototype.first_vertex + v) - p_center;
+        glm::dvec3 q = Position(mesh, copy.first_vertex + v) - q_center;
+        PP += glm::outerProduct(p, p);
+        QP += glm::outerProduct(q, p);
+    }
+
+    double scale = (PP[0][0] + PP[1][1] + PP[2][2]) / 3.0;
+    if (scale <= 0.0 || glm::determinant(PP) <= 1e-9 * scale*scale*scale)
+        return false;
+
+    *A = QP * glm::inverse(PP);
+    *t = q_center - (*A) * p_center;
+    if (glm::determinant(*A) <= 0.0)
+        return false;
+
+    glm::dvec3 diagonal = glm::dvec3(copy.bbox_max) - glm::dvec3(copy.bbox_min);
+    double tolerance = INSTANCE_POSITION_TOLERANCE * glm::length(diagonal);
+    for (size_t v = 0; v < n; ++v)
+    {
+        glm::dvec3 q = (*A) * Position(mesh, prototype.first_vertex + v) + (*t);
+        if (glm::length(q - Position(mesh, copy.first_vertex + v)) > tolerance)
+            return false;
+    }
+
+    if (!mesh.normal_coefficients.empty())
+    {
+        glm::dmat3 normal_matrix = glm::inverse(glm::transpose(*A));
+        for (size_t v = 0; v < n; ++v)
+        {
+            glm::dvec3 expected = normal_matrix * Normal(mesh, prototype.first_vertex + v);
+            glm::dvec3 actual   = Normal(mesh, copy.first_vertex + v);
+            double lengths = glm::length(expected) * glm::length(actual);
+            if (lengths > 0.0 && glm::dot(expected, actual) < INSTANCE_NORMAL_MIN_DOT * lengths)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Acrescenta a matriz afim 3x4 [A | t], linha a linha (veja MESH_INSTANCE_FLOATS)
+static void AppendTransform(std::vector<float>* transforms, const glm::dmat3& A, const glm::dvec3& t)
+{
+    for (int row = 0; row < 3; ++row)
+    {
+        transforms->push_back((float)A[0][row]);
+        transforms->push_back((float)A[1][row]);
+        transforms->push_back((float)A[2][row]);
+        transforms->push_back((float)t[row]);
+    }
+}
+
+size_t MeshInstancing_Detect(MeshData* mesh, const std::vector<int>* groups)
+{
+    size_t num_shapes = mesh->shapes.size();
+
+    // copies[s]: cópias encontradas para o protótipo s, com as transformações
+    std::vector< std::vector<size_t> >     copies(num_shapes);
+    std::vector< std::vector<glm::dmat3> > linear(num_shapes);
+    std::vector< std::vector<glm::dvec3> > translation(num_shapes);
+    std::vector<bool> is_copy(num_shapes, false);
+    std::vector<size_t> prototypes;
+
+    for (size_t s = 0; s < num_shapes; ++s)
+    {
+        const MeshShape& candidate = mesh->shapes[s];
+        bool found = false;
+        for (size_t i = 0; i < prototypes.size() && !found; ++i)
+        {
+            size_t p = prototypes[i];
+            const MeshShape& prototype = mesh->shapes[p];
+            if (groups && (*groups)[p] != (*groups)[s])
+                continue;
+            if (!SameTopology(*mesh, prototype, candidate)
+                || !SameAttributes(mesh->texture_coefficients, 2, prototype, candidate)
+                || !SameAttributes(mesh->color_coefficients, 3, prototype, candidate))
+                continue;
+
+            glm::dmat3 A;
+            glm::dvec3 t;
+            if (!FitAffine(*mesh, prototype, candidate, &A, &t))
+                continue;
+
+            copies[p].push_back(s);
+            linear[p].push_back(A);
+            translation[p].push_back(t);
+            is_copy[s] = true;
+            found = true;
+        }
+        if (!found)
+            prototypes.push_back(s);
+    }
+
+    size_t num_copies = 0;
+    size_t vertices_before = mesh->model_coefficients.size() / 4;
+    std::vector<size_t> order;
+    for (size_t s = 0; s < num_shapes; ++s)
+    {
+        if (is_copy[s])
+            continue;
+        order.push_back(s);
+
+        MeshShape& prototype = mesh->shapes[s];
+        if (copies[s].empty())
+        {
+            prototype.first_instance = 0;
+            prototype.num_instances  = 0;
+            continue;
+        }
+
+        prototype.first_instance = mesh->instance_transforms.size() / MESH_INSTANCE_FLOATS;
+        prototype.num_instances  = copies[s].size() + 1;
+        AppendTransform(&mesh->instance_transforms, glm::dmat3(1.0), glm::dvec3(0.0));
+        for (size_t c = 0; c < copies[s].size(); ++c)
+            AppendTransform(&mesh->instance_transforms, linear[s][c], translation[s][c]);
+        num_copies += copies[s].size();
+
+        printf("  Instâncias \"%s\": %d cópias\n", prototype.name.c_str(), (int)copies[s].size());
+    }
+
+    if (num_copies == 0)
+        return 0;
+
+    MeshData_ReorderShapes(mesh, order);
+
+    size_t vertices_after = mesh->model_coefficients.size() / 4;
+    printf("  Instanciamento: %d objetos -> %d (%d cópias), %d -> %d vertices (-%.0f%%)\n",
+        (int)num_shapes, (int)order.size(), (int)num_copies,
+        (int)vertices_before, (int)vertices_after,
+        100.0f*(1.0f - (float)vertices_after/(float)vertices_before));
+    return num_copies;
+}
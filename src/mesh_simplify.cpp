@@ -0,0 +1,353 @@
+// mesh_simplify.cpp - Geração de LODs por colapso de arestas
+//
+// Veja mesh_simplify.h. A simplificação é feita em passadas: em cada passada
+// listamos os colapsos possíveis (vértice -> vizinho) com o custo dado pela
+// quádrica acumulada do vértice de origem, ordenamos pelo custo e aplicamos
+// os mais baratos. Os vértices ao redor de cada colapso aplicado ficam
+// travados até o fim da passada, para que os testes de dobra de triângulos
+// (normal invertida) feitos com as posições atuais continuem válidos.
+
+#include "mesh_simplify.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <glm/vec3.hpp>
+#include <glm/geometric.hpp>
+
+// Quádrica simétrica: erro(p) = p^T A p + 2 b.p + c, acumulada com peso (área)
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+};
+
+static void Quadric_AddPlane(Quadric* q, const glm::dvec3& n, double d, double weight)
+{
+    q->a00 += weight * n.x * n.x;
+    q->a01 += weight * n.x * n.y;
+    q->a02 += weight * n.x * n.z;
+    q->a11 += weight * n.y * n.y;
+    q->a12 += weight * n.y * n.z;
+    q->a22 += weight * n.z * n.z;
+    q->b0  += weight * n.x * d;
+    q->b1  += weight * n.y * d;
+    q->b2  += weight * n.z * d;
+    q->c   += weight * d * d;
+    q->weight += weight;
+}
+
+static void Quadric_Add(Quadric* q, const Quadric& other)
+{
+    q->a00 += other.a00; q->a01 += other.a01; q->a02 += other.a02;
+    q->a11 += other.a11; q->a12 += other.a12; q->a22 += other.a22;
+    q->b0  += other.b0;  q->b1  += other.b1;  q->b2  += other.b2;
+    q->c   += other.c;
+    q->weight += other.weight;
+}
+
+// Distância quadrática média até os planos acumulados em "q"
+static double Quadric_Error(const Quadric& q, const glm::vec3& p)
+{
+    if (q.weight <= 0.0)
+        return 0.0;
+
+    double x = p.x, y = p.y, z = p.z;
+    double e = q.a00*x*x + q.a11*y*y + q.a22*z*z
+             + 2.0*(q.a01*x*y + q.a02*x*z + q.a12*y*z)
+             + 2.0*(q.b0*x + q.b1*y + q.b2*z)
+             + q.c;
+    return std::max(e, 0.0) / q.weight;
+}
+
+struct Collapse
+{
+    double   cost;
+    unsigned source;
+    unsigned target;
+
+    bool operator<(const Collapse& other) const { return cost < other.cost; }
+};
+
+std::vector<SimplifiedLod> MeshSimplify_BuildLods(
+    const float* positions, const float* normals, size_t first_vertex, size_t num_vertices,
+    const GLuint* indices, size_t num_indices,
+    const std::vector<size_t>& target_index_counts)
+{
+    std::vector<SimplifiedLod> lods;
+    if (num_vertices == 0 || num_indices < 3 || target_index_counts.empty())
+        return lods;
+
+    const size_t n = num_vertices;
+    std::vector<glm::vec3> position(n);
+    std::vector<glm::vec3> normal(n, glm::vec3(0.0f));
+    for (size_t v = 0; v < n; ++v)
+    {
+        const float* p = positions + 4*(first_vertex + v);
+        position[v] = glm::vec3(p[0], p[1], p[2]);
+        if (normals != NULL)
+        {
+            const float* q = normals + 4*(first_vertex + v);
+            normal[v] = glm::vec3(q[0], q[1], q[2]);
+        }
+    }
+
+    // Custo de levar "source" até "target": erro quádrico (distância aos
+    // planos) mais o desvio de normal ponderado pelo comprimento da aresta.
+    auto collapse_cost = [&](unsigned source, unsigned target, const Quadric& q) -> double
+    {
+        double cost = Quadric_Error(q, position[target]);
+        if (normals != NULL)
+        {
+            glm::vec3 edge = position[target] - position[source];
+            double deviation = 1.0 - (double)glm::dot(normal[source], normal[target]);
+            cost += std::max(deviation, 0.0) * (double)glm::dot(edge, edge);
+        }
+        return cost;
+    };
+
+    // Triângulos com índices locais (0..n-1)
+    std::vector<unsigned> triangles(num_indices - num_indices % 3);
+    for (size_t i = 0; i < triangles.size(); ++i)
+        triangles[i] = (unsigned)(indices[i] - first_vertex);
+
+    // Vértices com a mesma posição (costuras de normais/UVs) são agrupados;
+    // "canonical" aponta para o primeiro vértice de cada grupo.
+    std::vector<unsigned> order(n);
+    for (size_t v = 0; v < n; ++v)
+        order[v] = (unsigned)v;
+    std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        const glm::vec3& pa = position[a];
+        const glm::vec3& pb = position[b];
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        if (pa.z != pb.z) return pa.z < pb.z;
+        return a < b;
+    });
+
+    std::vector<unsigned> canonical(n);
+    std::vector<unsigned> num_wedges(n, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned v = order[i];
+        bool same = i > 0 && position[order[i-1]] == position[v];
+        canonical[v] = same ? canonical[order[i-1]] : v;
+        num_wedges[canonical[v]] += 1;
+    }
+
+    // Arestas que não têm exatamente dois triângulos vizinhos são bordas (ou
+    // geometria não-manifold): seus vértices não podem ser movidos.
+    std::vector<unsigned long long> edges;
+    edges.reserve(triangles.size());
+    for (size_t t = 0; t < triangles.size(); t += 3)
+    {
+        for (int e = 0; e < 3; ++e)
+        {
+            unsigned a = canonical[triangles[t + e]];
+            unsigned b = canonical[triangles[t + (e+1)%3]];
+            if (a == b)
+                continue;
+            edges.push_back(((unsigned long long)std::min(a,b) << 32) | std::max(a,b));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<char> on_border(n, 0);
+    for (size_t i = 0; i < edges.size(); )
+    {
+        size_t j = i;
+        while (j < edges.size() && edges[j] == edges[i])
+            ++j;
+        if (j - i != 2)
+        {
+            on_border[(unsigned)(edges[i] >> 32)] = 1;
+            on_border[(unsigned)(edges[i] & 0xFFFFFFFFu)] = 1;
+        }
+        i = j;
+    }
+
+    // Um vértice pode ser destino de um colapso se não tiver costura; pode
+    // ser origem se, além disso, não estiver em uma borda.
+    std::vector<char> can_target(n, 0);
+    std::vector<char> can_source(n, 0);
+    for (size_t v = 0; v < n; ++v)
+    {
+        if (canonical[v] != v || num_wedges[v] != 1)
+            continue;
+        can_target[v] = 1;
+        can_source[v] = !on_border[v];
+    }
+
+    // Quádricas iniciais: planos dos triângulos, ponderados pela área
+    Quadric zero = Quadric();
+    std::vector<Quadric> quadrics(n, zero);
+    for (size_t t = 0; t < triangles.size(); t += 3)
+    {
+        glm::dvec3 p0 = glm::dvec3(position[triangles[t+0]]);
+        glm::dvec3 p1 = glm::dvec3(position[triangles[t+1]]);
+        glm::dvec3 p2 = glm::dvec3(position[triangles[t+2]]);
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length <= 0.0)
+            continue;
+        normal /= length;
+        double d = -glm::dot(normal, p0);
+        for (int c = 0; c < 3; ++c)
+            Quadric_AddPlane(&quadrics[canonical[triangles[t + c]]], normal, d, 0.5 * length);
+    }
+
+    double max_error = 0.0;
+    size_t previous_count = triangles.size();
+    std::vector<unsigned> remap(n);
+    std::vector<char> pass_locked(n);
+    std::vector<unsigned> adjacency_offsets(n + 1);
+    std::vector<unsigned> adjacency;
+    std::vector<Collapse> collapses;
+
+    for (size_t lod = 0; lod < target_index_counts.size(); ++lod)
+    {
+        size_t target = target_index_counts[lod] - target_index_counts[lod] % 3;
+
+        while (triangles.size() > target)
+        {
+            // Colapsos candidatos, nos dois sentidos de cada aresta
+            collapses.clear();
+            for (size_t t = 0; t < triangles.size(); t += 3)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    unsigned a = triangles[t + e];
+                    unsigned b = triangles[t + (e+1)%3];
+                    if (can_source[a] && can_target[b])
+                    {
+                        Collapse collapse = { collapse_cost(a, b, quadrics[a]), a, b };
+                        collapses.push_back(collapse);
+                    }
+                    if (can_source[b] && can_target[a])
+                    {
+                        Collapse collapse = { collapse_cost(b, a, quadrics[b]), b, a };
+                        collapses.push_back(collapse);
+                    }
+                }
+            }
+            if (collapses.empty())
+                break;
+            std::sort(collapses.begin(), collapses.end());
+
+            // Limite de custo da passada: mais ou menos o custo do colapso que,
+            // sozinho, bastaria para atingir o alvo. Evita que uma passada
+            // aplique colapsos caros só porque os baratos estavam travados.
+            size_t needed = (triangles.size() - target) / 3;
+            double cost_limit = collapses[std::min(needed, collapses.size() - 1)].cost * 1.5;
+
+            // Triângulos vizinhos de cada vértice (por posição)
+            std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+            for (size_t i = 0; i < triangles.size(); ++i)
+                adjacency_offsets[canonical[triangles[i]] + 1] += 1;
+            for (size_t v = 0; v < n; ++v)
+                adjacency_offsets[v + 1] += adjacency_offsets[v];
+            adjacency.resize(triangles.size());
+            {
+                std::vector<unsigned> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+                for (size_t i = 0; i < triangles.size(); ++i)
+                    adjacency[cursor[canonical[triangles[i]]]++] = (unsigned)(i / 3);
+            }
+
+            for (size_t v = 0; v < n; ++v)
+                remap[v] = (unsigned)v;
+            std::fill(pass_locked.begin(), pass_locked.end(), 0);
+
+            size_t remaining = triangles.size();
+            size_t applied = 0;
+
+            for (size_t i = 0; i < collapses.size() && remaining > target; ++i)
+            {
+                const Collapse& collapse = collapses[i];
+                if (collapse.cost > cost_limit && applied > 0)
+                    break;
+                if (pass_locked[collapse.source] || pass_locked[collapse.target] || !can_source[collapse.source])
+                    continue;
+
+                // Rejeitamos colapsos que dobram (invertem) algum triângulo
+                bool flips = false;
+                size_t removed = 0;
+                for (unsigned a = adjacency_offsets[collapse.source]; a < adjacency_offsets[collapse.source + 1] && !flips; ++a)
+                {
+                    const unsigned* tri = &triangles[3*adjacency[a]];
+                    unsigned c0 = canonical[tri[0]], c1 = canonical[tri[1]], c2 = canonical[tri[2]];
+                    if (c0 == collapse.target || c1 == collapse.target || c2 == collapse.target)
+                    {
+                        removed += 3;
+                        continue;
+                    }
+
+                    glm::vec3 p0 = position[c0], p1 = position[c1], p2 = position[c2];
+                    glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+                    if (c0 == collapse.source) p0 = position[collapse.target];
+                    if (c1 == collapse.source) p1 = position[collapse.target];
+                    if (c2 == collapse.source) p2 = position[collapse.target];
+                    glm::vec3 after = glm::cross(p1 - p0, p2 - p0);
+
+                    float length = glm::length(before) * glm::length(after);
+                    flips = length <= 0.0f || glm::dot(before, after) < 0.25f * length;
+                }
+                if (flips)
+                    continue;
+
+                remap[collapse.source] = collapse.target;
+                Quadric_Add(&quadrics[collapse.target], quadrics[collapse.source]);
+                can_source[collapse.source] = 0;
+                can_target[collapse.source] = 0;
+                max_error = std::max(max_error, collapse.cost);
+
+                for (unsigned a = adjacency_offsets[collapse.source]; a < adjacency_offsets[collapse.source + 1]; ++a)
+                {
+                    const unsigned* tri = &triangles[3*adjacency[a]];
+                    pass_locked[canonical[tri[0]]] = 1;
+                    pass_locked[canonical[tri[1]]] = 1;
+                    pass_locked[canonical[tri[2]]] = 1;
+                }
+
+                remaining -= std::min(removed, remaining);
+                applied += 1;
+            }
+
+            if (applied == 0)
+                break;
+
+            // Reescrevemos os triângulos, descartando os degenerados
+            size_t write = 0;
+            for (size_t t = 0; t < triangles.size(); t += 3)
+            {
+                unsigned a = remap[triangles[t+0]];
+                unsigned b = remap[triangles[t+1]];
+                unsigned c = remap[triangles[t+2]];
+                if (canonical[a] == canonical[b] || canonical[b] == canonical[c] || canonical[a] == canonical[c])
+                    continue;
+                triangles[write++] = a;
+                triangles[write++] = b;
+                triangles[write++] = c;
+            }
+            triangles.resize(write);
+        }
+
+        // Não vale a pena um LOD que reduz menos de 20% em relação ao anterior
+        if (triangles.size() > previous_count * 4 / 5)
+            break;
+
+        SimplifiedLod result;
+        result.indices.resize(triangles.size());
+        for (size_t i = 0; i < triangles.size(); ++i)
+            result.indices[i] = (GLuint)(triangles[i] + first_vertex);
+        result.error = (float)std::sqrt(max_error);
+        lods.push_back(result);
+
+        previous_count = triangles.size();
+        if (triangles.size() > target)
+            break; // Não foi possível atingir o alvo; os próximos também não serão
+    }
+
+    return lods;
+}
@@ -0,0 +1,96 @@
+// multi_draw.cpp - Backend de desenho indireto
+//
+// Veja multi_draw.h. Os comandos e os dados por desenho de cada lote são
+// copiados para o trecho do quadro do buffer transitório: nenhum buffer é
+// criado nem ligado por desenho, e o anel com cercas garante que a GPU já
+// terminou de ler os lotes de TRANSIENT_RING_FRAMES quadros atrás.
+
+#include "multi_draw.h"
+
+#include <vector>
+
+#include "gl_extensions.h"
+#include "render_queue.h"
+#include "transient_buffer.h"
+
+// Layout de DrawElementsIndirectCommand definido pelo OpenGL
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint  base_vertex;
+    GLuint base_instance;
+};
+
+struct MultiDrawState
+{
+    size_t storage_alignment;   // GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+
+    // Lote atual
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<ObjectUniforms>              objects;
+};
+
+static MultiDrawState g_MultiDraw;
+
+void MultiDraw_Init()
+{
+    if (!g_GLExtensions.multi_draw_indirect)
+        return;
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    g_MultiDraw.storage_alignment = alignment > 0 ? (size_t)alignment : 256;
+}
+
+void MultiDraw_BindBlocks(GLuint program_id)
+{
+    GLuint index = glext_GetProgramResourceIndex(program_id, GL_SHADER_STORAGE_BLOCK, "ObjectBuffer");
+    if (index != GL_INVALID_INDEX)
+        glext_ShaderStorageBlockBinding(program_id, index, MULTI_DRAW_BINDING_OBJECTS);
+}
+
+void MultiDraw_Add(const ObjectUniforms& object, GLuint num_indices, GLuint first_index, GLsizei num_instances)
+{
+    DrawElementsIndirectCommand command;
+    command.count          = num_indices;
+    command.instance_count = num_instances > 0 ? (GLuint)num_instances : 1;
+    command.first_index    = first_index;
+    command.base_vertex    = 0;
+    command.base_instance  = 0;
+
+    g_MultiDraw.commands.push_back(command);
+    g_MultiDraw.objects.push_back(object);
+}
+
+size_t MultiDraw_Flush(GLenum mode)
+{
+    size_t count = g_MultiDraw.commands.size();
+    if (count == 0)
+        return 0;
+
+    // Os dados são enviados com "stride" igual ao alinhamento exigido para
+    // glBindBufferRange(); os comandos, com o tamanho de um comando
+    GLint first_object, first_command;
+    bool uploaded = TransientBuffer_Upload(g_MultiDraw.objects.data(), count * sizeof(ObjectUniforms),
+                                           g_MultiDraw.storage_alignment, &first_object)
+                 && TransientBuffer_Upload(g_MultiDraw.commands.data(), count * sizeof(DrawElementsIndirectCommand),
+                                           sizeof(DrawElementsIndirectCommand), &first_command);
+    g_MultiDraw.commands.clear();
+    g_MultiDraw.objects.clear();
+    if (!uploaded)
+        return 0;
+
+    GLuint buffer = TransientBuffer_Buffer();
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MULTI_DRAW_BINDING_OBJECTS, buffer,
+        (GLintptr)(first_object * g_MultiDraw.storage_alignment), (GLsizeiptr)(count * sizeof(ObjectUniforms)));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+
+    glext_MultiDrawElementsIndirect(mode, GL_UNSIGNED_INT,
+        (const void*)(first_command * sizeof(DrawElementsIndirectCommand)), (GLsizei)count, 0);
+    RenderState_CountMultiDraw((unsigned int)count);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return count;
+}
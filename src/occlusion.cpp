@@ -0,0 +1,192 @@
+// occlusion.cpp - Culling por oclusão com consultas de hardware
+//
+// Veja occlusion.h. Cada slot guarda uma consulta GL_ANY_SAMPLES_PASSED e o
+// número do lote de consultas em que ela foi emitida pela última vez; só a
+// consulta emitida no lote mais recente (quadro anterior) condiciona desenhos.
+
+#include "occlusion.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <glm/vector_relational.hpp>
+
+#include "shader_program.h"
+#include "uniform_buffers.h"
+
+OcclusionStats g_OcclusionStats;
+OcclusionStats g_OcclusionStatsLast;
+
+// Folga em volta da caixa para considerar a câmera "dentro": o plano near
+// cortaria as faces próximas e a caixa pareceria oculta
+static const float CAMERA_MARGIN = 0.2f;
+
+// Cubo unitário [0,1]^3, 12 triângulos
+static const float boxVertices[] = {
+    0,0,0, 1,1,0, 1,0,0,   0,0,0, 0,1,0, 1,1,0,   // -Z
+    0,0,1, 1,0,1, 1,1,1,   0,0,1, 1,1,1, 0,1,1,   // +Z
+    0,0,0, 0,0,1, 0,1,1,   0,0,0, 0,1,1, 0,1,0,   // -X
+    1,0,0, 1,1,1, 1,0,1,   1,0,0, 1,1,0, 1,1,1,   // +X
+    0,0,0, 1,0,0, 1,0,1,   0,0,0, 1,0,1, 0,0,1,   // -Y
+    0,1,0, 1,1,1, 1,1,0,   0,1,0, 0,1,1, 1,1,1    // +Y
+};
+
+struct OcclusionSlot
+{
+    GLuint       query;
+    unsigned int issued;   // Lote em que a consulta foi emitida (0: nunca)
+};
+
+struct PendingBox
+{
+    size_t    slot;
+    glm::vec3 box_min;
+    glm::vec3 box_max;
+};
+
+struct OcclusionState
+{
+    GLuint program;
+    GLint  box_min_uniform;
+    GLint  box_max_uniform;
+    GLuint vertex_array;
+    GLuint vertex_buffer;
+
+    std::vector<OcclusionSlot> slots;
+    std::vector<PendingBox>    pending;   // Caixas do quadro atual
+    unsigned int               batch;     // Lotes emitidos por Occlusion_IssueQueries()
+    glm::vec3                  camera_position;
+};
+
+static OcclusionState g_Occlusion;
+
+void Occlusion_Init()
+{
+    const char* vsFilename = "../../src/shader_occlusion_vertex.glsl";
+    const char* fsFilename = "../../src/shader_occlusion_fragment.glsl";
+    std::string vsCode = ShaderProgram_ReadFile(vsFilename);
+    std::string fsCode = ShaderProgram_ReadFile(fsFilename);
+    GLuint program = ShaderProgram_Create("shader_occlusion", vsFilename, vsCode.c_str(), fsFilename, fsCode.c_str());
+
+    UniformBuffers_BindBlocks(program);
+    g_Occlusion.program         = program;
+    g_Occlusion.box_min_uniform = glGetUniformLocation(program, "box_min");
+    g_Occlusion.box_max_uniform = glGetUniformLocation(program, "box_max");
+
+    glGenVertexArrays(1, &g_Occlusion.vertex_array);
+    glGenBuffers(1, &g_Occlusion.vertex_buffer);
+    glBindVertexArray(g_Occlusion.vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, g_Occlusion.vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(boxVertices), boxVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    g_Occlusion.batch = 0;
+}
+
+void Occlusion_Destroy()
+{
+    Occlusion_Resize(0);
+    glDeleteVertexArrays(1, &g_Occlusion.vertex_array);
+    glDeleteBuffers(1, &g_Occlusion.vertex_buffer);
+    glDeleteProgram(g_Occlusion.program);
+    g_Occlusion = OcclusionState();
+}
+
+void Occlusion_Resize(size_t count)
+{
+    for (size_t i = 0; i < g_Occlusion.slots.size(); ++i)
+        glDeleteQueries(1, &g_Occlusion.slots[i].query);
+
+    g_Occlusion.slots.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        glGenQueries(1, &g_Occlusion.slots[i].query);
+        g_Occlusion.slots[i].issued = 0;
+    }
+    g_Occlusion.pending.clear();
+}
+
+void Occlusion_BeginFrame(const glm::vec3& camera_position)
+{
+    g_Occlusion.camera_position = camera_position;
+    g_Occlusion.pending.clear();
+}
+
+GLuint Occlusion_Test(size_t slot, const glm::vec3& world_min, const glm::vec3& world_max)
+{
+    if (slot >= g_Occlusion.slots.size())
+        return 0;
+
+    // Câmera dentro da caixa: o objeto é considerado visível e não há consulta
+    const glm::vec3& camera = g_Occlusion.camera_position;
+    if (glm::all(glm::greaterThanEqual(camera, world_min - CAMERA_MARGIN))
+        && glm::all(glm::lessThanEqual(camera, world_max + CAMERA_MARGIN)))
+        return 0;
+
+    PendingBox box = { slot, world_min, world_max };
+    g_Occlusion.pending.push_back(box);
+
+    const OcclusionSlot& state = g_Occlusion.slots[slot];
+    if (state.issued == 0 || state.issued != g_Occlusion.batch)
+        return 0;
+
+    // Só para os contadores: o resultado é lido apenas se já estiver pronto
+    g_OcclusionStats.conditional += 1;
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+        GLuint any_samples = GL_TRUE;
+        glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &any_samples);
+        if (!any_samples)
+            g_OcclusionStats.skipped += 1;
+    }
+    return state.query;
+}
+
+void Occlusion_IssueQueries()
+{
+    g_Occlusion.batch += 1;
+    if (g_Occlusion.pending.empty())
+        return;
+
+    // Só o teste de profundidade importa; as duas faces são desenhadas para
+    // que caixas atravessadas pelo plano far ainda gerem fragmentos
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    glUseProgram(g_Occlusion.program);
+    glBindVertexArray(g_Occlusion.vertex_array);
+    for (size_t i = 0; i < g_Occlusion.pending.size(); ++i)
+    {
+        const PendingBox& box = g_Occlusion.pending[i];
+        OcclusionSlot& slot = g_Occlusion.slots[box.slot];
+
+        glUniform3f(g_Occlusion.box_min_uniform, box.box_min.x, box.box_min.y, box.box_min.z);
+        glUniform3f(g_Occlusion.box_max_uniform, box.box_max.x, box.box_max.y, box.box_max.z);
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, slot.query);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+        slot.issued = g_Occlusion.batch;
+        g_OcclusionStats.queries += 1;
+    }
+    glBindVertexArray(0);
+
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    g_Occlusion.pending.clear();
+}
+
+void OcclusionStats_EndFrame()
+{
+    g_OcclusionStatsLast = g_OcclusionStats;
+    memset(&g_OcclusionStats, 0, sizeof(g_OcclusionStats));
+}
@@ -0,0 +1,167 @@
+// program_cache.cpp - Cache em disco de programas de GPU
+//
+// Veja program_cache.h. Formato do arquivo: ProgramCacheHeader seguido do
+// binário devolvido por glGetProgramBinary().
+
+#include "program_cache.h"
+#include "gl_extensions.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+static const char     PROGRAM_CACHE_MAGIC[4] = { 'C', 'G', 'P', 'B' };
+static const uint32_t PROGRAM_CACHE_VERSION  = 1;
+
+struct ProgramCacheHeader
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint32_t binary_format;
+    uint32_t binary_length;
+};
+
+// FNV-1a de 64 bits
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Inclui o terminador, para que "ab" + "c" e "a" + "bc" tenham hashes diferentes
+static uint64_t HashString(uint64_t hash, const char* string)
+{
+    if (string == NULL)
+        string = "";
+    return HashBytes(hash, string, strlen(string) + 1);
+}
+
+ProgramCacheKey ProgramCache_Key(const char* name, const char* vertex_source, const char* fragment_source)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashBytes(hash, &PROGRAM_CACHE_VERSION, sizeof(PROGRAM_CACHE_VERSION));
+    hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+    hash = HashString(hash, vertex_source);
+    hash = HashString(hash, fragment_source);
+
+    ProgramCacheKey key;
+    key.name = name;
+    key.path = std::string("../../data/") + name + ".glprogram";
+    key.hash = hash;
+    return key;
+}
+
+GLuint ProgramCache_Load(const ProgramCacheKey& key)
+{
+    if (!g_GLExtensions.program_binary)
+        return 0;
+
+    FILE* file = fopen(key.path.c_str(), "rb");
+    if (file == NULL)
+        return 0;
+
+    ProgramCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+           && memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) == 0
+           && header.version == PROGRAM_CACHE_VERSION
+           && header.hash == key.hash
+           && header.binary_length > 0;
+
+    std::vector<unsigned char> binary;
+    if (ok)
+    {
+        binary.resize(header.binary_length);
+        ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    // Fontes ou driver mudaram: o arquivo será regravado após a compilação
+    if (!ok)
+        return 0;
+
+    GLuint program_id = glCreateProgram();
+    glext_ProgramBinary(program_id, header.binary_format, binary.data(), (GLsizei)binary.size());
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    if (linked_ok == GL_FALSE)
+    {
+        // O driver pode recusar binários antigos mesmo com as mesmas strings
+        // de versão. glProgramBinary() gera GL_INVALID_ENUM se o formato não
+        // for mais suportado; descartamos esse erro esperado.
+        glGetError();
+        glDeleteProgram(program_id);
+        fprintf(stderr, "WARNING: Binário de \"%s\" recusado pelo driver; compilando.\n", key.path.c_str());
+        return 0;
+    }
+
+    printf("Programa de GPU \"%s\" carregado do cache.\n", key.name.c_str());
+    return program_id;
+}
+
+void ProgramCache_PrepareLink(GLuint program_id)
+{
+    if (g_GLExtensions.program_binary)
+        glext_ProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache_Store(const ProgramCacheKey& key, GLuint program_id)
+{
+    if (!g_GLExtensions.program_binary)
+        return;
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    GLint length = 0;
+    glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (linked_ok == GL_FALSE || length <= 0)
+        return;
+
+    std::vector<unsigned char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glext_GetProgramBinary(program_id, length, &written, &format, binary.data());
+    if (written <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+    header.version       = PROGRAM_CACHE_VERSION;
+    header.hash          = key.hash;
+    header.binary_format = format;
+    header.binary_length = (uint32_t)written;
+
+    // Arquivo temporário + rename, como em MeshCache_Write()
+    std::string tmp_path = key.path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "WARNING: Não foi possível gravar \"%s\".\n", tmp_path.c_str());
+        return;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+           && fwrite(binary.data(), 1, written, file) == (size_t)written;
+    ok = (fclose(file) == 0) && ok;
+
+    if (ok)
+    {
+        remove(key.path.c_str());
+        ok = rename(tmp_path.c_str(), key.path.c_str()) == 0;
+    }
+    if (!ok)
+    {
+        remove(tmp_path.c_str());
+        fprintf(stderr, "WARNING: Não foi possível gravar \"%s\".\n", key.path.c_str());
+    }
+}
@@ -0,0 +1,205 @@
+// render_queue.cpp - Fila de desenho ordenada e cache de estado do OpenGL
+//
+// Veja render_queue.h. Os trechos de uniform buffers ligados são estado do
+// contexto, não do programa: sobrevivem à troca de programa.
+
+#include "render_queue.h"
+
+#include <cstring>
+#include <algorithm>
+
+RenderStats g_RenderStats;
+RenderStats g_RenderStatsLast;
+
+// UNKNOWN_STATE: valor desconhecido (nenhum nome válido do OpenGL)
+static const GLuint UNKNOWN_STATE = ~0u;
+
+// Trecho de buffer ligado a um binding de GL_UNIFORM_BUFFER
+struct BufferRange
+{
+    GLuint     buffer;
+    GLintptr   offset;
+    GLsizeiptr size;
+
+    BufferRange() : buffer(UNKNOWN_STATE), offset(0), size(0) {}
+};
+
+struct RenderStateCache
+{
+    GLuint program_id;
+    GLuint vertex_array_object_id;
+    GLuint blend;            // GL_TRUE, GL_FALSE ou UNKNOWN_STATE
+    std::vector<BufferRange> ranges;     // Por binding
+
+    RenderStateCache() : program_id(UNKNOWN_STATE), vertex_array_object_id(UNKNOWN_STATE), blend(UNKNOWN_STATE) {}
+};
+
+static RenderStateCache g_StateCache;
+
+static const int KEY_SEQUENCE_BITS = 14;
+static const int KEY_VAO_BITS      = 16;
+static const int KEY_PROGRAM_BITS  = 8;
+static const int KEY_DEPTH_BITS    = 24;
+static const int KEY_PASS_SHIFT    = 62;
+
+static uint64_t Field(uint64_t value, int bits)
+{
+    return value & ((1ull << bits) - 1);
+}
+
+// Para floats não negativos, a ordem dos bits é a ordem numérica; usamos os
+// 24 bits mais significativos (expoente e parte da mantissa).
+static uint64_t QuantizeDepth(float view_depth)
+{
+    if (!(view_depth > 0.0f))
+        return 0;
+
+    uint32_t bits;
+    memcpy(&bits, &view_depth, sizeof(bits));
+    return bits >> (31 - KEY_DEPTH_BITS);
+}
+
+uint64_t RenderQueue_MakeKey(int pass, GLuint program_id, GLuint vertex_array_object_id, float view_depth, uint32_t sequence)
+{
+    uint64_t depth    = QuantizeDepth(view_depth);
+    uint64_t program  = Field(program_id, KEY_PROGRAM_BITS);
+    uint64_t vao      = Field(vertex_array_object_id, KEY_VAO_BITS);
+    uint64_t order    = Field(sequence, KEY_SEQUENCE_BITS);
+    uint64_t key      = (uint64_t)pass << KEY_PASS_SHIFT;
+
+    if (pass == RENDER_PASS_TRANSPARENT)
+    {
+        uint64_t far_first = Field(~depth, KEY_DEPTH_BITS);
+        key |= far_first << (KEY_PROGRAM_BITS + KEY_VAO_BITS + KEY_SEQUENCE_BITS);
+        key |= program   << (KEY_VAO_BITS + KEY_SEQUENCE_BITS);
+        key |= vao       << KEY_SEQUENCE_BITS;
+    }
+    else
+    {
+        key |= program << (KEY_VAO_BITS + KEY_DEPTH_BITS + KEY_SEQUENCE_BITS);
+        key |= vao     << (KEY_DEPTH_BITS + KEY_SEQUENCE_BITS);
+        key |= depth   << KEY_SEQUENCE_BITS;
+    }
+    return key | order;
+}
+
+int RenderQueue_Pass(const RenderPacket& packet)
+{
+    return (int)(packet.sort_key >> KEY_PASS_SHIFT);
+}
+
+void RenderQueue_Clear(RenderQueue* queue)
+{
+    queue->packets.clear();
+    queue->order.clear();
+}
+
+void RenderQueue_Submit(RenderQueue* queue, const RenderPacket& packet)
+{
+    queue->packets.push_back(packet);
+}
+
+struct CompareKeys
+{
+    const std::vector<RenderPacket>* packets;
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        return (*packets)[a].sort_key < (*packets)[b].sort_key;
+    }
+};
+
+void RenderQueue_Sort(RenderQueue* queue)
+{
+    // Ordenamos índices, não os pacotes (cada um tem uma mat4)
+    queue->order.resize(queue->packets.size());
+    for (size_t i = 0; i < queue->order.size(); ++i)
+        queue->order[i] = (uint32_t)i;
+
+    CompareKeys compare;
+    compare.packets = &queue->packets;
+    std::stable_sort(queue->order.begin(), queue->order.end(), compare);
+}
+
+void RenderStats_EndFrame()
+{
+    g_RenderStatsLast = g_RenderStats;
+    memset(&g_RenderStats, 0, sizeof(g_RenderStats));
+}
+
+void RenderState_Invalidate()
+{
+    g_StateCache = RenderStateCache();
+}
+
+void RenderState_UseProgram(GLuint program_id)
+{
+    if (g_StateCache.program_id == program_id)
+    {
+        g_RenderStats.binds_skipped += 1;
+        return;
+    }
+
+    glUseProgram(program_id);
+    g_StateCache.program_id = program_id;
+    g_RenderStats.binds += 1;
+}
+
+void RenderState_BindVertexArray(GLuint vertex_array_object_id)
+{
+    if (g_StateCache.vertex_array_object_id == vertex_array_object_id)
+    {
+        g_RenderStats.binds_skipped += 1;
+        return;
+    }
+
+    glBindVertexArray(vertex_array_object_id);
+    g_StateCache.vertex_array_object_id = vertex_array_object_id;
+    g_RenderStats.binds += 1;
+}
+
+void RenderState_SetBlend(bool enabled)
+{
+    GLuint blend = enabled ? GL_TRUE : GL_FALSE;
+    if (g_StateCache.blend == blend)
+    {
+        g_RenderStats.binds_skipped += 1;
+        return;
+    }
+
+    if (enabled)
+        glEnable(GL_BLEND);
+    else
+        glDisable(GL_BLEND);
+    g_StateCache.blend = blend;
+    g_RenderStats.binds += 1;
+}
+
+void RenderState_BindBufferRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (binding >= g_StateCache.ranges.size())
+        g_StateCache.ranges.resize(binding + 1, BufferRange());
+
+    BufferRange& bound = g_StateCache.ranges[binding];
+    if (bound.buffer == buffer && bound.offset == offset && bound.size == size)
+    {
+        g_RenderStats.uniforms_skipped += 1;
+        return;
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    bound.buffer = buffer;
+    bound.offset = offset;
+    bound.size   = size;
+    g_RenderStats.uniforms += 1;
+}
+
+void RenderState_CountDraw()
+{
+    g_RenderStats.draws += 1;
+}
+
+void RenderState_CountMultiDraw(unsigned int commands)
+{
+    g_RenderStats.draws += 1;
+    g_RenderStats.indirect_draws += commands;
+}
@@ -1,92 +1,39 @@
 #include "rod_system.h"
 #include "game_types.h" // Para M_PI e M_PI_2
+#include "game_state.h"
+#include "vertex_format.h"
+#include "asset_registry.h"
+#include "uniform_buffers.h"
+#include "transient_buffer.h"
 #include <cstdio>
-#include <GLFW/glfw3.h> // Necessário para glfwGetTime()
-#include <glm/gtc/type_ptr.hpp>
+#include <cstring>
 #include <glm/mat4x4.hpp>
+#include <glm/common.hpp>
 
-// Incluir a estrutura ObjModel e funções de carregamento
-#include <tiny_obj_loader.h>
-#include <string>
-#include <vector>
 #include <stdexcept>
 
 // Variáveis de estado do sistema de varas
 static bool g_IsCharging = false;
-static float g_ChargeStartTime = 0.0f;
+static double g_ChargeStartTime = 0.0;
 
 // Constantes de força (Internas ao módulo)
 static const float MIN_THROW_POWER = 5.0f;
 static const float MAX_THROW_POWER = 30.0f;
 static const float MAX_CHARGE_TIME = 2.0f; // Segundos para carga máxima
 
-// Variáveis para a linha de pesca (internas ao módulo)
+// Variáveis para a linha de pesca (internas ao módulo). Os vértices vão para o
+// buffer transitório (transient_buffer.h); o VAO é configurado uma única vez.
 static GLuint g_LineVAO = 0;
-static GLuint g_LineVBO = 0;
-
-// ID do objeto para linha de pesca no shader
-static const int FISHING_LINE_OBJECT_ID = 6;
+static const unsigned int LINE_VERTEX_FLAGS = VERTEX_FORMAT_NORMALS | VERTEX_FORMAT_TEXCOORDS;
 
 // Função auxiliar para criar matriz identidade (evita dependência de matrices.h)
 static glm::mat4 IdentityMatrix() {
     return glm::mat4(1.0f);
 }
 
-// Estrutura para carregar modelos .obj (copiada da main.cpp)
-struct ObjModel
-{
-    tinyobj::attrib_t                 attrib;
-    std::vector<tinyobj::shape_t>     shapes;
-    std::vector<tinyobj::material_t>  materials;
-
-    ObjModel(const char* filename, const char* basepath = NULL, bool triangulate = true)
-    {
-        printf("Carregando objetos do arquivo \"%s\"...\n", filename);
-
-        std::string fullpath(filename);
-        std::string dirname;
-        if (basepath == NULL)
-        {
-            auto i = fullpath.find_last_of("/");
-            if (i != std::string::npos)
-            {
-                dirname = fullpath.substr(0, i+1);
-                basepath = dirname.c_str();
-            }
-        }
-
-        std::string warn;
-        std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filename, basepath, triangulate);
-
-        if (!err.empty())
-            fprintf(stderr, "\n%s\n", err.c_str());
-
-        if (!ret)
-            throw std::runtime_error("Erro ao carregar modelo.");
-
-        for (size_t shape = 0; shape < shapes.size(); ++shape)
-        {
-            if (shapes[shape].name.empty())
-            {
-                fprintf(stderr,
-                        "*********************************************\n"
-                        "Erro: Objeto sem nome dentro do arquivo '%s'.\n"
-                        "Veja https://www.inf.ufrgs.br/~eslgastal/fcg-faq-etc.html#Modelos-3D-no-formato-OBJ .\n"
-                        "*********************************************\n",
-                    filename);
-                throw std::runtime_error("Objeto sem nome.");
-            }
-            printf("- Objeto '%s'\n", shapes[shape].name.c_str());
-        }
-
-        printf("OK.\n");
-    }
-};
-
-// Declarações das funções que já existem na main.cpp
-extern void ComputeNormals(ObjModel* model);
-extern void BuildTrianglesAndAddToVirtualScene(ObjModel* model);
+// Declaração da função que já existe na main.cpp. Ela usa a versão cozida do
+// modelo (veja mesh_cache.cpp) quando disponível.
+extern ModelHandle LoadModelToVirtualScene(const char* filename, unsigned int build_flags = 0);
 
 void InitializeRodSystem() {
     printf("=================================================\n");
@@ -95,9 +42,7 @@ void InitializeRodSystem() {
     
     // Carregar modelo 3D da vara básica
     try {
-        ObjModel fishing_pole("../../data/models/fishing_pole_01.obj");
-        ComputeNormals(&fishing_pole);
-        BuildTrianglesAndAddToVirtualScene(&fishing_pole);
+        LoadModelToVirtualScene("../../data/models/fishing_pole_01.obj");
         printf("Vara básica (fishing_pole_01) carregada com sucesso!\n");
     } catch (const std::exception& e) {
         fprintf(stderr, "ERRO ao carregar fishing_pole_01: %s\n", e.what());
@@ -111,7 +56,7 @@ void InitializeRodSystem() {
 void StartChargingThrow() {
     if (!g_IsCharging) {
         g_IsCharging = true;
-        g_ChargeStartTime = (float)glfwGetTime();
+        g_ChargeStartTime = g_SimulationTime;
         printf("Carregando lancamento... (Segure para aumentar a forca)\n");
     }
 }
@@ -121,8 +66,7 @@ float ReleaseThrow() {
 
     g_IsCharging = false;
     
-    float current_time = (float)glfwGetTime();
-    float charge_duration = current_time - g_ChargeStartTime;
+    float charge_duration = (float)(g_SimulationTime - g_ChargeStartTime);
     
     // Limitar o tempo ao máximo definido
     if (charge_duration > MAX_CHARGE_TIME) charge_duration = MAX_CHARGE_TIME;
@@ -145,8 +89,7 @@ bool IsCharging() {
 float GetCurrentChargePercentage() {
     if (!g_IsCharging) return 0.0f;
     
-    float current_time = (float)glfwGetTime();
-    float charge_duration = current_time - g_ChargeStartTime;
+    float charge_duration = (float)(g_SimulationTime - g_ChargeStartTime);
     
     if (charge_duration > MAX_CHARGE_TIME) charge_duration = MAX_CHARGE_TIME;
     
@@ -160,16 +103,16 @@ float GetCurrentChargePercentage() {
 void InitializeFishingLine() {
     if (g_LineVAO == 0) {
         glGenVertexArrays(1, &g_LineVAO);
-        glGenBuffers(1, &g_LineVBO);
-        printf("Linha de pesca inicializada (VAO: %u, VBO: %u)\n", g_LineVAO, g_LineVBO);
+        glBindVertexArray(g_LineVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, TransientBuffer_Buffer());
+        VertexFormat_SetupAttributes(LINE_VERTEX_FLAGS);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        printf("Linha de pesca inicializada (VAO: %u)\n", g_LineVAO);
     }
 }
 
 void CleanupFishingLine() {
-    if (g_LineVBO != 0) {
-        glDeleteBuffers(1, &g_LineVBO);
-        g_LineVBO = 0;
-    }
     if (g_LineVAO != 0) {
         glDeleteVertexArrays(1, &g_LineVAO);
         g_LineVAO = 0;
@@ -182,60 +125,51 @@ void DrawFishingLine(const glm::vec3& rod_tip, const glm::vec3& bait_position, c
         InitializeFishingLine();
     }
     
-    // Criar vértices da linha com posição, normal e texcoord
-    // Shader espera: vec4 position, vec4 normal, vec2 texcoord
-    // Cada vértice tem: posição (4) + normal (4) + texcoord (2) = 10 floats
-    float line_vertices[] = {
-        // Vértice 1: ponta da vara
-        rod_tip.x, rod_tip.y, rod_tip.z, 1.0f,      // posição (vec4)
-        0.0f, 1.0f, 0.0f, 0.0f,                      // normal (vec4, w=0 para vetor)
-        0.0f, 0.0f,                                  // texcoord
-        // Vértice 2: posição da isca
-        bait_position.x, bait_position.y, bait_position.z, 1.0f,  // posição (vec4)
-        0.0f, 1.0f, 0.0f, 0.0f,                      // normal (vec4)
-        1.0f, 0.0f                                   // texcoord
-    };
-    
-    // Atualizar buffer com as novas posições
+    // Criar vértices da linha no mesmo formato compacto das malhas da cena
+    // (vertex_format.h). As posições são quantizadas contra a bounding box da
+    // própria linha, que é enviada ao shader em bbox_min/bbox_max.
+    glm::vec3 bbox_min = glm::min(rod_tip, bait_position);
+    glm::vec3 bbox_max = glm::max(rod_tip, bait_position);
+
+    PackedVertex line_vertices[2];
+    memset(line_vertices, 0, sizeof(line_vertices));
+
+    // Vértice 1: ponta da vara
+    VertexFormat_EncodePosition(rod_tip, bbox_min, bbox_max, line_vertices[0].position);
+    VertexFormat_EncodeNormal(glm::vec3(0.0f, 1.0f, 0.0f), line_vertices[0].normal);
+    line_vertices[0].texcoord[0] = VertexFormat_EncodeHalf(0.0f);
+    line_vertices[0].texcoord[1] = VertexFormat_EncodeHalf(0.0f);
+
+    // Vértice 2: posição da isca
+    VertexFormat_EncodePosition(bait_position, bbox_min, bbox_max, line_vertices[1].position);
+    VertexFormat_EncodeNormal(glm::vec3(0.0f, 1.0f, 0.0f), line_vertices[1].normal);
+    line_vertices[1].texcoord[0] = VertexFormat_EncodeHalf(1.0f);
+    line_vertices[1].texcoord[1] = VertexFormat_EncodeHalf(0.0f);
+
+    // Enviar as novas posições para o trecho do quadro no buffer transitório
+    GLint first;
+    if (!TransientBuffer_Upload(line_vertices, sizeof(line_vertices), VertexFormat_Stride(LINE_VERTEX_FLAGS), &first))
+        return;
+
     glBindVertexArray(g_LineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, g_LineVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(line_vertices), line_vertices, GL_DYNAMIC_DRAW);
-    
-    // Stride = 10 floats por vértice
-    GLsizei stride = 10 * sizeof(float);
-    
-    // Atributo 0: posição (location = 0) - vec4
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    // Atributo 1: normal (location = 1) - vec4
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    // Atributo 2: texcoord (location = 2) - vec2
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    // Salvar programa atual e usar o programa fornecido
-    GLint current_program;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
     glUseProgram(render_info.program_id);
     
-    // Matriz model identidade (a linha já está em coordenadas do mundo)
-    glm::mat4 model = IdentityMatrix();
-    glUniformMatrix4fv(render_info.model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-    
-    // Usar ID definido no shader para linha branca
-    glUniform1i(render_info.object_id_uniform, FISHING_LINE_OBJECT_ID);
+    ObjectUniforms object;
+    memset(&object, 0, sizeof(object));
+
+    // Matriz model identidade (a linha já está em coordenadas do mundo). A cor
+    // branca vem da variante do programa escolhida por quem chama.
+    object.model = IdentityMatrix();
+    object.normal_matrix = IdentityMatrix();
     
-    // Bounding box vazia (não é usada para linhas)
-    glUniform4f(render_info.bbox_min_uniform, 0.0f, 0.0f, 0.0f, 1.0f);
-    glUniform4f(render_info.bbox_max_uniform, 1.0f, 1.0f, 1.0f, 1.0f);
+    // Bounding box da linha, usada pelo shader para decodificar as posições
+    object.bbox_min = glm::vec4(bbox_min, 1.0f);
+    object.bbox_max = glm::vec4(bbox_max, 1.0f);
+    UniformBuffers_SetImmediateObject(object);
     
     // Desenhar a linha
-    glDrawArrays(GL_LINES, 0, 2);
+    glDrawArrays(GL_LINES, first, 2);
     
-    // Restaurar estado
+    // O programa fica ligado (quem chama não depende do anterior)
     glBindVertexArray(0);
-    glUseProgram(current_program);
 }
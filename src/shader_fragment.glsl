@@ -13,48 +13,118 @@ in vec4 position_model;
 // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
 in vec2 texcoords;
 
-// Matrizes computadas no código C++ e enviadas para a GPU
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-// Identificador que define qual objeto está sendo desenhado no momento
-#define MAP             0 
-#define BOAT            1
-#define FISH            2
-#define BAIT            3
-#define HOOK            4
-#define ROD             5
-#define FISHING_LINE    6
-#define TREE            7
-#define WATER           8
-#define CUBE            9
-
-uniform int object_id;
-
-// Parâmetros da axis-aligned bounding box (AABB) do modelo
-uniform vec4 bbox_min;
-uniform vec4 bbox_max;
-
-// Cor difusa do material (do arquivo .mtl)
-uniform vec3 material_kd;
+// Dados do quadro e do objeto, em uniform buffers compartilhados com o código
+// C++ e com os demais shaders (veja "uniform_buffers.h"). As declarações dos
+// blocos devem ser idênticas em todos os shaders que os usam.
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 camera_position;     // Origem da câmera no mundo, inverse(view) * (0,0,0,1)
+};
+
+layout (std140) uniform ObjectUniforms
+{
+    mat4 model;
+    mat4 normal_matrix;       // inverse(transpose(model)), calculada na CPU
+    vec4 bbox_min;            // Bounding box do objeto, usada para decodificar
+    vec4 bbox_max;            // a posição quantizada
+    vec4 object_material_kd;  // w = 1: usar a cor por vértice (atributo 3)
+};
+
+// Este arquivo é compilado uma vez por caminho de material (veja
+// LoadShadersFromFiles() em "main.cpp"): a variante define exatamente um dos
+// MATERIAL_* abaixo, e nenhum fragmento precisa escolher o material em tempo
+// de execução. Outras opções da variante:
+//   GOURAUD_SHADING:      iluminação calculada em "shader_vertex.glsl" (peixe);
+//   SMOOTH_MATERIAL_COLOR: cor do material interpolada entre os vértices (terreno);
+//   GAMMA_CORRECT_OUTPUT: o framebuffer não é sRGB e a correção gamma é feita
+//                         aqui, em vez de pelo OpenGL (GL_FRAMEBUFFER_SRGB).
+//
+//   MATERIAL_MTL           terreno e árvores (cor do arquivo .mtl)
+//   MATERIAL_BOAT          barco
+//   MATERIAL_FISH          peixe
+//   MATERIAL_BAIT          isca
+//   MATERIAL_HOOK          anzol
+//   MATERIAL_ROD           vara
+//   MATERIAL_FISHING_LINE  linha de pesca
+//   MATERIAL_WATER         água (transparente)
+//   MATERIAL_CUBE          cubos
+//   (nenhum)               fallback: verde fluorescente
+
+// Materiais com termo especular de Blinn-Phong
+#if defined(MATERIAL_BOAT) || defined(MATERIAL_HOOK) || defined(MATERIAL_WATER) || defined(MATERIAL_CUBE)
+#define SPECULAR
+#endif
+
+// Cor difusa do material (do arquivo .mtl), atributo de vértice repassado
+// por "shader_vertex.glsl"
+#ifdef SMOOTH_MATERIAL_COLOR
+in vec3 material_kd;
+#else
+flat in vec3 material_kd;
+#endif
 
 // Variáveis para acesso das imagens de textura
+#if defined(MATERIAL_BOAT)
 uniform sampler2D BoatTexture;
+#elif defined(MATERIAL_FISH)
 uniform sampler2D FishTexture;
+#elif defined(MATERIAL_CUBE)
 uniform sampler2D CubeTexture;
+#endif
 
 // O valor de saída ("out") de um Fragment Shader é a cor final do fragmento.
 out vec4 color;
+#ifdef GOURAUD_SHADING
 in vec3 gouraud_illumination;
+#endif
 
 void main()
 {
-    // Obtemos a posição da câmera utilizando a inversa da matriz que define o
-    // sistema de coordenadas da câmera.
-    vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-    vec4 camera_position = inverse(view) * origin;
+    // Obtemos a refletância difusa a partir da leitura da imagem de textura apropriada
+    vec3 Kd0 = vec3(0.0,0.0,0.0);
+    vec3 Ks0 = vec3(0.0, 0.0, 0.0); // Coeficiente de reflexão especular
+    float q = 1.0; // Expoente especular
+    vec3 I = vec3(1.0, 1.0, 1.0); // Intensidade da luz branca
+
+#if defined(MATERIAL_MTL)
+    // Use material color from MTL file
+    Kd0 = material_kd;
+#elif defined(MATERIAL_BOAT)
+    Kd0 = texture(BoatTexture, texcoords).rgb;
+    Ks0 = Kd0 * 0.5;
+    q = 15.0;
+#elif defined(MATERIAL_FISH)
+    Kd0 = texture(FishTexture, texcoords).rgb;
+#elif defined(MATERIAL_BAIT)
+    Kd0 = vec3(0.89, 0.53, 0.57);   // Rosa claro
+#elif defined(MATERIAL_HOOK)
+    Kd0 = vec3(0.2, 0.2, 0.2);      // Cinza escuro
+    Ks0 = Kd0 * 0.8;
+    q = 1.0;
+#elif defined(MATERIAL_WATER)
+    // Cor enviada por Water_Render() (veja "water.h")
+    Kd0 = material_kd;
+    Ks0 = vec3(0.8, 0.8, 0.8);
+    q = 15.0;
+#elif defined(MATERIAL_ROD)
+    Kd0 = vec3(0.6, 0.4, 0.2);      // Marrom claro
+#elif defined(MATERIAL_FISHING_LINE)
+    Kd0 = vec3(1.0, 1.0, 1.0);      // Branco
+#elif defined(MATERIAL_CUBE)
+    Kd0 = texture(CubeTexture, texcoords).rgb;
+    Ks0 = vec3(0.1, 0.1, 0.1);
+    q = 50.0;
+#else
+    // Fallback: verde fluorescente
+    Kd0 = vec3(0.0, 1.0, 0.0);
+#endif
 
+    // Equação de Iluminação
+#ifdef GOURAUD_SHADING
+    color.rgb = Kd0 * gouraud_illumination;
+#else
     // O fragmento atual é coberto por um ponto que percente à superfície de um
     // dos objetos virtuais da cena. Este ponto, p, possui uma posição no
     // sistema de coordenadas global (World coordinates). Esta posição é obtida
@@ -69,78 +139,20 @@ void main()
     // Vetor que define o sentido da fonte de luz em relação ao ponto atual.
     vec4 l = normalize(vec4(1.0,1.0,0.0,0.0));
 
-    // Vetor que define o sentido da câmera em relação ao ponto atual.
+    float lambert = max(0,dot(n,l));
+    color.rgb = Kd0 * (lambert + 0.01);
+
+#ifdef SPECULAR
+    // Vetor que define o sentido da câmera em relação ao ponto atual. A
+    // posição da câmera vem pronta do bloco FrameUniforms.
     vec4 v = normalize(camera_position - p);
 
     vec4 h = normalize(l + v);
 
-    // Obtemos a refletância difusa a partir da leitura da imagem de textura apropriada
-    vec3 Kd0 = vec3(0.0,0.0,0.0);
-    vec3 Ks0 = vec3(0.0, 0.0, 0.0); // Coeficiente de reflexão especular
-    float q = 1000.0; // Expoente especular (alto = sem brilho)
-    vec3 I = vec3(1.0, 1.0, 1.0); // Intensidade da luz branca
-
-
-    if (object_id == MAP) {
-        // Use material color from MTL file
-        Kd0 = material_kd;
-    }
-    else if (object_id == BOAT) {
-        Kd0 = texture(BoatTexture, texcoords).rgb;
-        Ks0 = Kd0 * 0.5;
-        q = 15.0;
-    }
-    else if (object_id == FISH) {
-        Kd0 = texture(FishTexture, texcoords).rgb;
-        Ks0 = Kd0 * 0.5;
-        q = 20.0;
-    }
-    else if (object_id == BAIT) {
-        Kd0 = vec3(0.89, 0.53, 0.57);   // Rosa claro
-    }
-    else if (object_id == HOOK) {
-        Kd0 = vec3(0.2, 0.2, 0.2);      // Cinza escuro
-        Ks0 = Kd0 * 0.8;
-        q = 1.0;
-    }
-    else if (object_id == TREE) {
-        Kd0 = material_kd;
-    }
-    else if (object_id == WATER) {
-        // Use material color from MTL file
-        Kd0 = material_kd;   
-        color.a = 0.5; 
-        Ks0 = vec3(0.8, 0.8, 0.8);
-        q = 15.0;
-    }
-    else if (object_id == ROD) {
-        Kd0 = vec3(0.6, 0.4, 0.2);      // Marrom claro
-    }
-    else if (object_id == FISHING_LINE) {
-        Kd0 = vec3(1.0, 1.0, 1.0);      // Branco
-    }
-    else if (object_id == CUBE) {
-        Kd0 = texture(CubeTexture, texcoords).rgb;
-        Ks0 = vec3(0.1, 0.1, 0.1);
-        q = 50.0;
-    }
-    else {
-        // Fallback: verde fluorescente
-        Kd0 = vec3(0.0, 1.0, 0.0);
-    }
-    
-    // Equação de Iluminação
-    if (object_id == FISH) {
-        color.rgb = Kd0 * gouraud_illumination;
-    }
-    else {
-        float lambert = max(0,dot(n,l));
-
-        vec3 phong_specular_term = Ks0 * I * pow(max(dot(n, h), 0.0), q);
-
-        color.rgb = Kd0 * (lambert + 0.01) + phong_specular_term;
-    }
-
+    vec3 phong_specular_term = Ks0 * I * pow(max(dot(n, h), 0.0), q);
+    color.rgb += phong_specular_term;
+#endif
+#endif
 
     // NOTE: Se você quiser fazer o rendering de objetos transparentes, é
     // necessário:
@@ -154,11 +166,18 @@ void main()
     //    suas distâncias para a câmera (desenhando primeiro objetos
     //    transparentes que estão mais longe da câmera).
     // Alpha default = 1 = 100% opaco = 0% transparente
-    if (object_id != WATER)
-        color.a = 1;
-
-    // Cor final com correção gamma, considerando monitor sRGB.
+#ifdef MATERIAL_WATER
+    color.a = 0.5;
+#else
+    color.a = 1;
+#endif
+
+    // Cor final com correção gamma, considerando monitor sRGB. Normalmente o
+    // framebuffer é sRGB e a conversão é feita pelo OpenGL na escrita (e no
+    // blending), sem custo no shader.
     // Veja https://en.wikipedia.org/w/index.php?title=Gamma_correction&oldid=751281772#Windows.2C_Mac.2C_sRGB_and_TV.2Fvideo_standard_gammas
+#ifdef GAMMA_CORRECT_OUTPUT
     color.rgb = pow(color.rgb, vec3(1.0,1.0,1.0)/2.2);
+#endif
 }
 
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Shader de fragmento das caixas de consulta de oclusão. A escrita de cor
+// fica desligada (glColorMask): só importa se o fragmento passa no teste de
+// profundidade.
+
+out vec4 color;
+
+void main()
+{
+    color = vec4(1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+
+// Shader de vértice das caixas de consulta de oclusão (veja "occlusion.h").
+// O cubo unitário [0,1]^3 é esticado até a bounding box do objeto.
+
+layout (location = 0) in vec3 position;
+
+// Câmera do quadro, no mesmo uniform buffer dos shaders principais
+// (veja "uniform_buffers.h")
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 camera_position;     // Origem da câmera no mundo, inverse(view) * (0,0,0,1)
+};
+
+uniform vec3 box_min;
+uniform vec3 box_max;
+
+void main()
+{
+    vec3 p = mix(box_min, box_max, position);
+    gl_Position = projection * view * vec4(p, 1.0);
+}
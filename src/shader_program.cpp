@@ -0,0 +1,84 @@
+// shader_program.cpp - Programas de GPU dos módulos
+//
+// Veja shader_program.h.
+
+#include "shader_program.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "program_cache.h"
+
+std::string ShaderProgram_ReadFile(const char* filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        fprintf(stderr, "ERROR: Cannot open shader file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+GLuint ShaderProgram_Compile(const char* name, const char* source, GLenum type)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    // Erros e também "warnings" da compilação, com o log inteiro
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    GLint log_length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+    if (log_length > 1) {
+        std::vector<GLchar> log(log_length);
+        glGetShaderInfoLog(shader, log_length, NULL, log.data());
+        fprintf(stderr, "%s: Shader compilation %s (%s):\n%s\n",
+            success ? "WARNING" : "ERROR", success ? "produced warnings" : "failed", name, log.data());
+    } else if (!success) {
+        fprintf(stderr, "ERROR: Shader compilation failed (%s).\n", name);
+    }
+
+    return shader;
+}
+
+GLuint ShaderProgram_Create(const char* cache_name,
+                            const char* vertex_name, const char* vertex_source,
+                            const char* fragment_name, const char* fragment_source)
+{
+    ProgramCacheKey key = ProgramCache_Key(cache_name, vertex_source, fragment_source);
+    GLuint program = ProgramCache_Load(key);
+    if (program != 0)
+        return program;
+
+    GLuint vs = ShaderProgram_Compile(vertex_name, vertex_source, GL_VERTEX_SHADER);
+    GLuint fs = ShaderProgram_Compile(fragment_name, fragment_source, GL_FRAGMENT_SHADER);
+
+    program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    ProgramCache_PrepareLink(program);
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        GLint log_length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+        std::vector<GLchar> log(log_length > 1 ? log_length : 1, '\0');
+        glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, log.data());
+        fprintf(stderr, "ERROR: Shader linking failed (%s):\n%s\n", cache_name, log.data());
+    } else {
+        ProgramCache_Store(key, program);
+    }
+
+    return program;
+}
@@ -7,8 +7,14 @@ layout (location = 0) in vec3 position;
 
 out vec3 texCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+// Câmera do quadro, no mesmo uniform buffer dos shaders principais
+// (veja "uniform_buffers.h")
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 camera_position;     // Origem da câmera no mundo, inverse(view) * (0,0,0,1)
+};
 
 void main()
 {
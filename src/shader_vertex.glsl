@@ -1,15 +1,77 @@
 #version 330 core
 
-// Atributos de vértice recebidos como entrada ("in") pelo Vertex Shader.
-// Veja a função BuildTrianglesAndAddToVirtualScene() em "main.cpp".
-layout (location = 0) in vec4 model_coefficients;
-layout (location = 1) in vec4 normal_coefficients;
+// Atributos de vértice recebidos como entrada ("in") pelo Vertex Shader, no
+// formato compacto descrito em "vertex_format.h":
+//   - posição quantizada em [0,1] relativa à bounding box do objeto;
+//   - normal com codificação octaédrica, inteiros em [-127,127];
+//   - coordenadas de textura em meio-float (convertidas pelo OpenGL);
+//   - cor difusa do material (Kd do .mtl), por vértice ou constante por objeto.
+// Veja a função AddMeshToVirtualScene() em "main.cpp".
+layout (location = 0) in vec3 position_quantized;
+layout (location = 1) in vec2 normal_octahedral;
 layout (location = 2) in vec2 texture_coefficients;
-
-// Matrizes computadas no código C++ e enviadas para a GPU
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (location = 3) in vec3 vertex_material_kd;
+
+// Linhas da matriz afim 3x4 da instância (divisor 1). Fora de desenhos
+// instanciados valem a identidade; veja VertexFormat_SetupInstanceAttributes().
+layout (location = 4) in vec4 instance_row0;
+layout (location = 5) in vec4 instance_row1;
+layout (location = 6) in vec4 instance_row2;
+
+// Dados do quadro e do objeto, em uniform buffers compartilhados com o código
+// C++ e com os demais shaders (veja "uniform_buffers.h"). As declarações dos
+// blocos devem ser idênticas em todos os shaders que os usam.
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+    vec4 camera_position;     // Origem da câmera no mundo, inverse(view) * (0,0,0,1)
+};
+
+#ifdef MULTI_DRAW_INDIRECT
+// Desenho indireto (veja "multi_draw.h"): os dados de todos os desenhos de um
+// glMultiDrawElementsIndirect() ficam em um shader storage buffer, com o
+// layout de ObjectUniforms, e cada vértice lê os do seu desenho (gl_DrawIDARB)
+// nas variáveis globais abaixo, no início de main().
+struct ObjectData
+{
+    mat4 model;
+    mat4 normal_matrix;
+    vec4 bbox_min;
+    vec4 bbox_max;
+    vec4 object_material_kd;
+};
+
+layout (std430) readonly buffer ObjectBuffer
+{
+    ObjectData objects[];
+};
+
+mat4 model;
+mat4 normal_matrix;
+vec4 bbox_min;
+vec4 bbox_max;
+vec4 object_material_kd;
+#else
+layout (std140) uniform ObjectUniforms
+{
+    mat4 model;
+    mat4 normal_matrix;       // inverse(transpose(model)), calculada na CPU
+    vec4 bbox_min;            // Bounding box do objeto, usada para decodificar
+    vec4 bbox_max;            // a posição quantizada
+    vec4 object_material_kd;  // w = 1: usar a cor por vértice (atributo 3)
+};
+#endif
+
+// Este arquivo é compilado uma vez por material (veja LoadShadersFromFiles()
+// em "main.cpp"), com os #define da variante inseridos logo após "#version".
+// GOURAUD_SHADING: iluminação calculada por vértice (peixe).
+// SMOOTH_MATERIAL_COLOR: cor do material interpolada entre os vértices, em vez
+// de constante em cada triângulo (terreno, veja "terrain.h").
+// PROCEDURAL_WATER_GRID: sem atributos de vértice; a posição vem da grade da
+// água e de gl_VertexID (veja "water.h").
+// MULTI_DRAW_INDIRECT: dados do objeto por desenho, em vez do bloco
+// ObjectUniforms (veja "multi_draw.h").
 
 // Atributos de vértice que serão gerados como saída ("out") pelo Vertex Shader.
 // ** Estes serão interpolados pelo rasterizador! ** gerando, assim, valores
@@ -19,16 +81,94 @@ out vec4 position_world;
 out vec4 position_model;
 out vec4 normal;
 out vec2 texcoords;
+#ifdef SMOOTH_MATERIAL_COLOR
+out vec3 material_kd;
+#else
+flat out vec3 material_kd;
+#endif
+#ifdef GOURAUD_SHADING
 out vec3 gouraud_illumination;
+#endif
 
-uniform int object_id;
-
-uniform sampler2D FishTexture;
+// Decodifica uma normal em codificação octaédrica (veja VertexFormat_DecodeNormal())
+vec3 DecodeNormal(vec2 encoded)
+{
+    vec2 e = encoded / 127.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        vec2 sign_not_zero = vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(e.yx)) * sign_not_zero;
+    }
+    return normalize(n);
+}
 
-#define FISH 2
+#ifdef PROCEDURAL_WATER_GRID
+// Parâmetros da grade e das ondas, enviados por Water_Render(). Cada onda
+// ocupa uma componente dos vec4, como no laço SIMD de Water_Heights().
+uniform vec4  water_grid;        // xy: centro (XZ), z: meio lado, w: fração do espaçamento no centro
+uniform int   water_grid_cells;  // Quadriláteros por lado
+uniform vec4  water_bounds;      // Área do lago em XZ: xy mínimo, zw máximo
+uniform float water_level;       // Altura de repouso
+uniform vec4  wave_amplitude;
+uniform vec4  wave_kx;           // Vetor de onda (kx, kz)
+uniform vec4  wave_kz;
+uniform vec4  wave_phase;        // omega * tempo, em [0, 2pi)
+
+// Vértice gl_VertexID da grade: 6 vértices (2 triângulos) por quadrilátero,
+// com a altura e a normal analítica da soma das ondas
+void WaterGridVertex(out vec4 position, out vec4 normal_vector)
+{
+    const ivec2 corners[6] = ivec2[6](ivec2(0,0), ivec2(0,1), ivec2(1,1), ivec2(0,0), ivec2(1,1), ivec2(1,0));
+    int quad = gl_VertexID / 6;
+    ivec2 cell = ivec2(quad % water_grid_cells, quad / water_grid_cells) + corners[gl_VertexID - quad * 6];
+
+    // u em [-1,1]; o espaçamento cresce com |u|, do centro para a borda
+    vec2 u = vec2(cell) / float(water_grid_cells) * 2.0 - 1.0;
+    vec2 xz = water_grid.xy + water_grid.z * u * (water_grid.w + (1.0 - water_grid.w) * abs(u));
+    xz = clamp(xz, water_bounds.xy, water_bounds.zw);
+
+    vec4 phase = wave_kx * xz.x + wave_kz * xz.y + wave_phase;
+    vec4 c = cos(phase);
+    float height = water_level + dot(wave_amplitude, sin(phase));
+    float dh_dx = dot(wave_amplitude * wave_kx, c);
+    float dh_dz = dot(wave_amplitude * wave_kz, c);
+
+    position = vec4(xz.x, height, xz.y, 1.0);
+    normal_vector = vec4(normalize(vec3(-dh_dx, 1.0, -dh_dz)), 0.0);
+}
+#endif
 
 void main()
 {
+#ifdef MULTI_DRAW_INDIRECT
+    model              = objects[gl_DrawIDARB].model;
+    normal_matrix      = objects[gl_DrawIDARB].normal_matrix;
+    bbox_min           = objects[gl_DrawIDARB].bbox_min;
+    bbox_max           = objects[gl_DrawIDARB].bbox_max;
+    object_material_kd = objects[gl_DrawIDARB].object_material_kd;
+#endif
+
+#ifdef PROCEDURAL_WATER_GRID
+    // Já no espaço do mundo (model é a identidade)
+    vec4 model_coefficients;
+    vec4 normal_coefficients;
+    WaterGridVertex(model_coefficients, normal_coefficients);
+#else
+    // Reconstruímos os atributos em ponto flutuante a partir do formato
+    // compacto e os levamos do protótipo para a instância desenhada
+    mat4 instance = transpose(mat4(instance_row0, instance_row1, instance_row2, vec4(0.0, 0.0, 0.0, 1.0)));
+    vec4 model_coefficients  = instance * vec4(mix(bbox_min.xyz, bbox_max.xyz, position_quantized), 1.0);
+
+    // Normais da instância: a matriz de cofatores de mat3(instance) é a
+    // inversa transposta multiplicada pelo determinante. Como a normal é
+    // normalizada, basta o sinal do determinante (instâncias espelhadas).
+    mat3 m = mat3(instance);
+    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+    float det_sign = dot(m[0], cofactor[0]) < 0.0 ? -1.0 : 1.0;
+    vec4 normal_coefficients = vec4(normalize(det_sign * (cofactor * DecodeNormal(normal_octahedral))), 0.0);
+#endif
+
     // A variável gl_Position define a posição final de cada vértice
     // OBRIGATORIAMENTE em "normalized device coordinates" (NDC), onde cada
     // coeficiente estará entre -1 e 1 após divisão por w.
@@ -65,19 +205,20 @@ void main()
 
     // Normal do vértice atual no sistema de coordenadas global (World).
     // Veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf.
-    normal = inverse(transpose(model)) * normal_coefficients;
+    // A matriz inverse(transpose(model)) vem pronta do bloco ObjectUniforms.
+    normal = normal_matrix * normal_coefficients;
     normal.w = 0.0;
 
     // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
     texcoords = texture_coefficients;
 
-     // ***** Gouraud Shading *******
-    if(object_id == FISH){
-        // Obtemos a posição da câmera utilizando a inversa da matriz que define o
-        // sistema de coordenadas da câmera.
-        vec4 origin = vec4(0.0, 0.0, 0.0, 1.0);
-        vec4 camera_position = inverse(view) * origin;
+    // Cor do material: constante em cada triângulo (vértices soldados por
+    // material) quando vem do VBO, ou a mesma para todo o objeto
+    material_kd = object_material_kd.w > 0.5 ? vertex_material_kd : object_material_kd.rgb;
 
+     // ***** Gouraud Shading *******
+#ifdef GOURAUD_SHADING
+    {
         // Posição do vértice no mundo
         vec4 p = position_world;
 
@@ -104,5 +245,6 @@ void main()
 
         gouraud_illumination = I * (lambert + 0.01) + (phong_specular_term);
     }
+#endif
 }
 
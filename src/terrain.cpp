@@ -0,0 +1,469 @@
+// terrain.cpp - Heightfield em blocos com geomipmapping
+//
+// Veja terrain.h. Cada bloco tem os seus (TERRAIN_CHUNK_QUADS + 1)^2 vértices
+// no VBO (as bordas são repetidas entre vizinhos), então os padrões de índices
+// são os mesmos para todos os blocos e cada desenho só muda o vértice base.
+
+#include "terrain.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <tiny_obj_loader.h>
+
+#include "asset_loader.h"
+#include "render_queue.h"
+#include "uniform_buffers.h"
+#include "vertex_format.h"
+
+static const unsigned int TERRAIN_VERTEX_FLAGS = VERTEX_FORMAT_NORMALS | VERTEX_FORMAT_COLORS;
+static const int CHUNK_SAMPLES = TERRAIN_CHUNK_QUADS + 1;
+static const int VERTICES_PER_CHUNK = CHUNK_SAMPLES * CHUNK_SAMPLES;
+
+// Bordas do bloco cujo vizinho está em um nível mais grosseiro
+#define STITCH_NEG_X 1
+#define STITCH_POS_X 2
+#define STITCH_NEG_Z 4
+#define STITCH_POS_Z 8
+
+// Resultado da etapa de CPU, copiado para o Terrain no upload
+struct TerrainBuild
+{
+    std::string                filename;
+    int                        chunks_per_side;
+    glm::mat4                  model;
+    glm::vec3                  bbox_min;
+    glm::vec3                  bbox_max;
+    std::vector<unsigned char> vertices;
+    std::vector<GLushort>      indices;
+    std::vector<TerrainChunk>  chunks;
+    TerrainPattern             patterns[TERRAIN_LOD_LEVELS][16];
+};
+
+// Grade de alturas reamostrada, samples x samples pontos
+struct Heightfield
+{
+    int                    samples;
+    glm::vec3              bbox_min;
+    glm::vec3              bbox_max;
+    std::vector<float>     heights;
+    std::vector<glm::vec3> colors;
+
+    float Height(int x, int z) const { return heights[z * samples + x]; }
+    glm::vec3 Position(int x, int z) const
+    {
+        float step_x = (bbox_max.x - bbox_min.x) / (samples - 1);
+        float step_z = (bbox_max.z - bbox_min.z) / (samples - 1);
+        return glm::vec3(bbox_min.x + x * step_x, Height(x, z), bbox_min.z + z * step_z);
+    }
+};
+
+// Rasteriza os triângulos da malha em XZ sobre a grade: cada ponto recebe a
+// altura (interpolada) e a cor do material do triângulo mais alto que o cobre
+static void ResampleMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+                         const std::vector<tinyobj::material_t>& materials, Heightfield* field)
+{
+    const std::vector<float>& v = attrib.vertices;
+    if (v.empty())
+        throw std::runtime_error("Terreno sem vértices.");
+
+    glm::vec3 bbox_min(v[0], v[1], v[2]);
+    glm::vec3 bbox_max = bbox_min;
+    for (size_t i = 0; i + 2 < v.size(); i += 3)
+    {
+        bbox_min = glm::min(bbox_min, glm::vec3(v[i], v[i+1], v[i+2]));
+        bbox_max = glm::max(bbox_max, glm::vec3(v[i], v[i+1], v[i+2]));
+    }
+
+    int samples = field->samples;
+    float step_x = (bbox_max.x - bbox_min.x) / (samples - 1);
+    float step_z = (bbox_max.z - bbox_min.z) / (samples - 1);
+    if (!(step_x > 0.0f) || !(step_z > 0.0f))
+        throw std::runtime_error("Terreno sem área em XZ.");
+
+    const float UNSET = std::numeric_limits<float>::lowest();
+    field->bbox_min = bbox_min;
+    field->bbox_max = bbox_max;
+    field->heights.assign(samples * samples, UNSET);
+    field->colors.assign(samples * samples, glm::vec3(0.8f));
+
+    const float EPSILON = 1e-4f;
+    for (size_t shape = 0; shape < shapes.size(); ++shape)
+    {
+        const tinyobj::mesh_t& mesh = shapes[shape].mesh;
+        for (size_t face = 0; face * 3 + 2 < mesh.indices.size(); ++face)
+        {
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                int index = mesh.indices[face * 3 + k].vertex_index;
+                p[k] = glm::vec3(v[3*index + 0], v[3*index + 1], v[3*index + 2]);
+            }
+
+            glm::vec3 color(0.8f);
+            int material = face < mesh.material_ids.size() ? mesh.material_ids[face] : -1;
+            if (material >= 0 && material < (int)materials.size())
+                color = glm::vec3(materials[material].diffuse[0], materials[material].diffuse[1], materials[material].diffuse[2]);
+
+            float det = (p[1].z - p[2].z) * (p[0].x - p[2].x) + (p[2].x - p[1].x) * (p[0].z - p[2].z);
+            if (std::fabs(det) < 1e-12f)
+                continue;   // Triângulo vertical: não cobre nenhuma área em XZ
+
+            glm::vec3 tri_min = glm::min(p[0], glm::min(p[1], p[2]));
+            glm::vec3 tri_max = glm::max(p[0], glm::max(p[1], p[2]));
+            int x0 = std::max(0,           (int)std::ceil ((tri_min.x - bbox_min.x) / step_x - EPSILON));
+            int x1 = std::min(samples - 1, (int)std::floor((tri_max.x - bbox_min.x) / step_x + EPSILON));
+            int z0 = std::max(0,           (int)std::ceil ((tri_min.z - bbox_min.z) / step_z - EPSILON));
+            int z1 = std::min(samples - 1, (int)std::floor((tri_max.z - bbox_min.z) / step_z + EPSILON));
+
+            for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x)
+            {
+                float px = bbox_min.x + x * step_x;
+                float pz = bbox_min.z + z * step_z;
+                float w0 = ((p[1].z - p[2].z) * (px - p[2].x) + (p[2].x - p[1].x) * (pz - p[2].z)) / det;
+                float w1 = ((p[2].z - p[0].z) * (px - p[2].x) + (p[0].x - p[2].x) * (pz - p[2].z)) / det;
+                float w2 = 1.0f - w0 - w1;
+                if (w0 < -EPSILON || w1 < -EPSILON || w2 < -EPSILON)
+                    continue;
+
+                float height = w0 * p[0].y + w1 * p[1].y + w2 * p[2].y;
+                float& sample = field->heights[z * samples + x];
+                if (height > sample)
+                {
+                    sample = height;
+                    field->colors[z * samples + x] = color;
+                }
+            }
+        }
+    }
+
+    // Pontos não cobertos (buracos ou bordas irregulares) copiam os vizinhos
+    bool missing = true;
+    for (int pass = 0; missing && pass < samples; ++pass)
+    {
+        missing = false;
+        std::vector<float> heights = field->heights;
+        for (int z = 0; z < samples; ++z)
+        for (int x = 0; x < samples; ++x)
+        {
+            if (heights[z * samples + x] != UNSET)
+                continue;
+
+            static const int offsets[4][2] = { {-1,0}, {1,0}, {0,-1}, {0,1} };
+            for (int k = 0; k < 4; ++k)
+            {
+                int nx = x + offsets[k][0], nz = z + offsets[k][1];
+                if (nx < 0 || nz < 0 || nx >= samples || nz >= samples || heights[nz * samples + nx] == UNSET)
+                    continue;
+                field->heights[z * samples + x] = heights[nz * samples + nx];
+                field->colors[z * samples + x]  = field->colors[nz * samples + nx];
+                break;
+            }
+            missing = missing || field->heights[z * samples + x] == UNSET;
+        }
+    }
+    if (missing)
+        throw std::runtime_error("Terreno sem triângulos.");
+
+    // Caixa vertical da grade (pode ser menor que a da malha original)
+    field->bbox_min.y = field->bbox_max.y = field->heights[0];
+    for (size_t i = 1; i < field->heights.size(); ++i)
+    {
+        field->bbox_min.y = std::min(field->bbox_min.y, field->heights[i]);
+        field->bbox_max.y = std::max(field->bbox_max.y, field->heights[i]);
+    }
+}
+
+// Normal por diferenças centrais (unilaterais nas bordas da grade)
+static glm::vec3 ComputeNormal(const Heightfield& field, int x, int z)
+{
+    int xa = std::max(x - 1, 0), xb = std::min(x + 1, field.samples - 1);
+    int za = std::max(z - 1, 0), zb = std::min(z + 1, field.samples - 1);
+    glm::vec3 dx = field.Position(xb, z) - field.Position(xa, z);
+    glm::vec3 dz = field.Position(x, zb) - field.Position(x, za);
+    return glm::normalize(glm::cross(dz, dx));
+}
+
+// Vértice (x, z), em unidades do nível, de um padrão: nas bordas com vizinho
+// mais grosseiro os vértices ímpares vão para o par anterior
+static GLushort PatternVertex(int x, int z, int step, int n, int stitch)
+{
+    if (z == 0 && (stitch & STITCH_NEG_Z) && x < n && (x & 1)) x -= 1;
+    if (z == n && (stitch & STITCH_POS_Z) && x < n && (x & 1)) x -= 1;
+    if (x == 0 && (stitch & STITCH_NEG_X) && z < n && (z & 1)) z -= 1;
+    if (x == n && (stitch & STITCH_POS_X) && z < n && (z & 1)) z -= 1;
+    return (GLushort)(z * step * CHUNK_SAMPLES + x * step);
+}
+
+static void BuildPatterns(TerrainBuild* build)
+{
+    for (int level = 0; level < TERRAIN_LOD_LEVELS; ++level)
+    for (int stitch = 0; stitch < 16; ++stitch)
+    {
+        int step = 1 << level;
+        int n = TERRAIN_CHUNK_QUADS / step;
+
+        TerrainPattern& pattern = build->patterns[level][stitch];
+        pattern.first_index = (GLsizei)build->indices.size();
+        for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+        {
+            GLushort a = PatternVertex(x,     z,     step, n, stitch);
+            GLushort b = PatternVertex(x + 1, z,     step, n, stitch);
+            GLushort c = PatternVertex(x,     z + 1, step, n, stitch);
+            GLushort d = PatternVertex(x + 1, z + 1, step, n, stitch);
+
+            // Dois triângulos (sentido anti-horário visto de cima); os que
+            // ficaram degenerados pela costura não são emitidos
+            GLushort triangles[6] = { a, c, b,  b, c, d };
+            for (int t = 0; t < 6; t += 3)
+            {
+                GLushort i0 = triangles[t], i1 = triangles[t+1], i2 = triangles[t+2];
+                if (i0 == i1 || i1 == i2 || i0 == i2)
+                    continue;
+                build->indices.push_back(i0);
+                build->indices.push_back(i1);
+                build->indices.push_back(i2);
+            }
+        }
+        pattern.num_indices = (GLsizei)build->indices.size() - pattern.first_index;
+    }
+}
+
+// Etapa de CPU (thread do pool): leitura, reamostragem e vértices dos blocos
+static void PrepareTerrain(TerrainBuild* build)
+{
+    std::string dirname;
+    size_t slash = build->filename.find_last_of("/");
+    if (slash != std::string::npos)
+        dirname = build->filename.substr(0, slash + 1);
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, build->filename.c_str(), dirname.c_str(), true))
+    {
+        fprintf(stderr, "\n%s\n", err.c_str());
+        throw std::runtime_error("Erro ao carregar terreno.");
+    }
+
+    Heightfield field;
+    field.samples = build->chunks_per_side * TERRAIN_CHUNK_QUADS + 1;
+    ResampleMesh(attrib, shapes, materials, &field);
+    build->bbox_min = field.bbox_min;
+    build->bbox_max = field.bbox_max;
+
+    size_t stride = VertexFormat_Stride(TERRAIN_VERTEX_FLAGS);
+    size_t color_offset = VertexFormat_ColorOffset(TERRAIN_VERTEX_FLAGS);
+    int num_chunks = build->chunks_per_side * build->chunks_per_side;
+    build->vertices.assign(num_chunks * VERTICES_PER_CHUNK * stride, 0);
+    build->chunks.resize(num_chunks);
+
+    for (int cz = 0; cz < build->chunks_per_side; ++cz)
+    for (int cx = 0; cx < build->chunks_per_side; ++cx)
+    {
+        int chunk = cz * build->chunks_per_side + cx;
+        glm::vec3 chunk_min(std::numeric_limits<float>::max());
+        glm::vec3 chunk_max(std::numeric_limits<float>::lowest());
+        for (int z = 0; z < CHUNK_SAMPLES; ++z)
+        for (int x = 0; x < CHUNK_SAMPLES; ++x)
+        {
+            int sx = cx * TERRAIN_CHUNK_QUADS + x;
+            int sz = cz * TERRAIN_CHUNK_QUADS + z;
+            glm::vec3 position = field.Position(sx, sz);
+            chunk_min = glm::min(chunk_min, position);
+            chunk_max = glm::max(chunk_max, position);
+
+            unsigned char* vertex = &build->vertices[(chunk * VERTICES_PER_CHUNK + z * CHUNK_SAMPLES + x) * stride];
+            PackedVertex packed;
+            memset(&packed, 0, sizeof(packed));
+            VertexFormat_EncodePosition(position, field.bbox_min, field.bbox_max, packed.position);
+            VertexFormat_EncodeNormal(ComputeNormal(field, sx, sz), packed.normal);
+            memcpy(vertex, &packed, color_offset);
+
+            GLushort color[4];
+            VertexFormat_EncodeColor(field.colors[sz * field.samples + sx], color);
+            memcpy(vertex + color_offset, color, sizeof(color));
+        }
+
+        Culling_TransformBox(build->model, chunk_min, chunk_max, &build->chunks[chunk].world_min, &build->chunks[chunk].world_max);
+        build->chunks[chunk].lod = 0;
+    }
+
+    BuildPatterns(build);
+}
+
+// Etapa de OpenGL (thread do contexto)
+static void UploadTerrain(Terrain* terrain, TerrainBuild* build)
+{
+    terrain->chunks_per_side  = build->chunks_per_side;
+    terrain->samples_per_side = build->chunks_per_side * TERRAIN_CHUNK_QUADS + 1;
+    terrain->model    = build->model;
+    terrain->bbox_min = build->bbox_min;
+    terrain->bbox_max = build->bbox_max;
+    terrain->chunks.swap(build->chunks);
+    memcpy(terrain->patterns, build->patterns, sizeof(terrain->patterns));
+
+    glGenVertexArrays(1, &terrain->vertex_array);
+    glBindVertexArray(terrain->vertex_array);
+
+    glGenBuffers(1, &terrain->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, terrain->vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, build->vertices.size(), build->vertices.data(), GL_STATIC_DRAW);
+    VertexFormat_SetupAttributes(TERRAIN_VERTEX_FLAGS);
+
+    glGenBuffers(1, &terrain->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrain->index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, build->indices.size() * sizeof(GLushort), build->indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    printf("Terreno: %dx%d blocos, grade de %dx%d alturas, %d níveis\n",
+        terrain->chunks_per_side, terrain->chunks_per_side,
+        terrain->samples_per_side, terrain->samples_per_side, TERRAIN_LOD_LEVELS);
+}
+
+void Terrain_Load(Terrain* terrain, const char* filename, int chunks_per_side, const glm::mat4& model)
+{
+    // Os índices de um bloco são GLushort
+    static_assert(VERTICES_PER_CHUNK <= 65536, "TERRAIN_CHUNK_QUADS grande demais para índices de 16 bits");
+
+    std::shared_ptr<TerrainBuild> build = std::make_shared<TerrainBuild>();
+    build->filename = filename;
+    build->chunks_per_side = chunks_per_side;
+    build->model = model;
+
+    AssetLoader_Submit(filename,
+        [build]() { PrepareTerrain(build.get()); },
+        [terrain, build]() { UploadTerrain(terrain, build.get()); });
+}
+
+void Terrain_Destroy(Terrain* terrain)
+{
+    glDeleteVertexArrays(1, &terrain->vertex_array);
+    glDeleteBuffers(1, &terrain->vertex_buffer);
+    glDeleteBuffers(1, &terrain->index_buffer);
+    *terrain = Terrain();
+}
+
+// Nível de cada bloco pela distância da câmera à sua caixa. Depois, blocos
+// com um vizinho dois ou mais níveis mais fino são refinados até que a
+// diferença seja no máximo 1 (a costura só liga níveis vizinhos).
+static void SelectLevels(Terrain* terrain, const glm::vec3& camera_position, bool use_lod)
+{
+    int n = terrain->chunks_per_side;
+    for (size_t i = 0; i < terrain->chunks.size(); ++i)
+    {
+        TerrainChunk& chunk = terrain->chunks[i];
+        chunk.lod = 0;
+        if (!use_lod)
+            continue;
+
+        glm::vec3 closest = glm::clamp(camera_position, chunk.world_min, chunk.world_max);
+        float distance = glm::length(camera_position - closest);
+        float limit = TERRAIN_LOD_DISTANCE;
+        while (chunk.lod < TERRAIN_LOD_LEVELS - 1 && distance > limit)
+        {
+            chunk.lod += 1;
+            limit *= 2.0f;
+        }
+    }
+    if (!use_lod)
+        return;
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int z = 0; z < n; ++z)
+        for (int x = 0; x < n; ++x)
+        {
+            int& lod = terrain->chunks[z * n + x].lod;
+            int finest = lod;
+            if (x > 0)     finest = std::min(finest, terrain->chunks[z * n + x - 1].lod);
+            if (x < n - 1) finest = std::min(finest, terrain->chunks[z * n + x + 1].lod);
+            if (z > 0)     finest = std::min(finest, terrain->chunks[(z - 1) * n + x].lod);
+            if (z < n - 1) finest = std::min(finest, terrain->chunks[(z + 1) * n + x].lod);
+            if (lod > finest + 1)
+            {
+                lod = finest + 1;
+                changed = true;
+            }
+        }
+    }
+}
+
+void Terrain_Render(Terrain* terrain, GLuint program_id, const glm::vec3& camera_position, const Frustum* frustum, bool use_lod)
+{
+    if (terrain->chunks.empty())
+        return;
+
+    SelectLevels(terrain, camera_position, use_lod);
+
+    int n = terrain->chunks_per_side;
+    terrain->draw_counts.clear();
+    terrain->draw_offsets.clear();
+    terrain->draw_base_vertices.clear();
+    for (int z = 0; z < n; ++z)
+    for (int x = 0; x < n; ++x)
+    {
+        int index = z * n + x;
+        const TerrainChunk& chunk = terrain->chunks[index];
+        if (frustum != NULL)
+        {
+            unsigned int plane_mask = CULL_ALL_PLANES;
+            if (Culling_TestBox(*frustum, chunk.world_min, chunk.world_max, &plane_mask) == CULL_OUTSIDE)
+            {
+                g_CullingStats.culled += 1;
+                continue;
+            }
+        }
+        g_CullingStats.visible += 1;
+
+        int stitch = 0;
+        if (x > 0     && terrain->chunks[index - 1].lod > chunk.lod) stitch |= STITCH_NEG_X;
+        if (x < n - 1 && terrain->chunks[index + 1].lod > chunk.lod) stitch |= STITCH_POS_X;
+        if (z > 0     && terrain->chunks[index - n].lod > chunk.lod) stitch |= STITCH_NEG_Z;
+        if (z < n - 1 && terrain->chunks[index + n].lod > chunk.lod) stitch |= STITCH_POS_Z;
+
+        const TerrainPattern& pattern = terrain->patterns[chunk.lod][stitch];
+        terrain->draw_counts.push_back(pattern.num_indices);
+        terrain->draw_offsets.push_back((const void*)(pattern.first_index * sizeof(GLushort)));
+        terrain->draw_base_vertices.push_back(index * VERTICES_PER_CHUNK);
+    }
+
+    if (terrain->draw_counts.empty())
+        return;
+
+    // Cor por vértice (w = 1), como nos lotes estáticos com vários materiais
+    ObjectUniforms object;
+    memset(&object, 0, sizeof(object));
+    object.model         = terrain->model;
+    object.normal_matrix = glm::inverseTranspose(terrain->model);
+    object.bbox_min      = glm::vec4(terrain->bbox_min, 1.0f);
+    object.bbox_max      = glm::vec4(terrain->bbox_max, 1.0f);
+    object.material_kd   = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    UniformBuffers_SetImmediateObject(object);
+
+    // O terreno é opaco; o estado alterado aqui é esquecido pelo cache de
+    // render_queue.h no início de FlushRenderQueue()
+    glDisable(GL_BLEND);
+    glUseProgram(program_id);
+    glBindVertexArray(terrain->vertex_array);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, terrain->draw_counts.data(), GL_UNSIGNED_SHORT,
+        terrain->draw_offsets.data(), (GLsizei)terrain->draw_counts.size(), terrain->draw_base_vertices.data());
+    glBindVertexArray(0);
+    RenderState_CountDraw();
+}
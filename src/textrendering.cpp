@@ -1,6 +1,7 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -10,8 +11,8 @@
 
 #include "utils.h"
 #include "dejavufont.h"
-
-GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+#include "shader_program.h"
+#include "transient_buffer.h"
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -35,63 +36,23 @@ const GLchar* const textfragmentshader_source = ""
 "}\n"
 "\0";
 
-void TextRendering_LoadShader(const GLchar* const shader_string, GLuint shader_id)
-{
-    // Define o código do shader, contido na string "shader_string"
-    glShaderSource(shader_id, 1, &shader_string, NULL);
-
-    // Compila o código do shader (em tempo de execução)
-    glCompileShader(shader_id);
-
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
-    GLint compiled_ok;
-    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
-
-    GLint log_length = 0;
-    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &log_length);
-
-    // Alocamos memória para guardar o log de compilação.
-    // A chamada "new" em C++ é equivalente ao "malloc()" do C.
-    GLchar* log = new GLchar[log_length];
-    glGetShaderInfoLog(shader_id, log_length, &log_length, log);
-
-    // Imprime no terminal qualquer erro ou "warning" de compilação
-    if ( log_length != 0 )
-    {
-        std::string  output;
-
-        if ( !compiled_ok )
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-        else
-        {
-            output += "ERROR: OpenGL compilation failed.\n";
-            output += "== Start of compilation log\n";
-            output += log;
-            output += "== End of compilation log\n";
-        }
-
-        fprintf(stderr, "%s", output.c_str());
-    }
-
-    // A chamada "delete" em C++ é equivalente ao "free()" do C
-    delete [] log;
-}
-
 GLuint textVAO;
-GLuint textVBO;
 GLuint textprogram_id;
 GLuint texttexture_id;
 
+// Glifo de cada codepoint ASCII (NULL se a fonte não tiver), montada em
+// TextRendering_Init() para não percorrer dejavufont.glyphs a cada caractere
+const texture_glyph_t* textglyphs[128];
+
+// Vértices (x, y, s, t) dos glifos impressos no quadro atual. Todo o texto é
+// enviado para o buffer transitório (transient_buffer.h) e desenhado de uma
+// vez por TextRendering_Flush().
+std::vector<float> textvertices;
+
 void TextRendering_Init()
 {
     GLuint sampler;
 
-    glGenBuffers(1, &textVBO);
     glGenVertexArrays(1, &textVAO);
     glGenTextures(1, &texttexture_id);
     glGenSamplers(1, &sampler);
@@ -101,16 +62,9 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
-
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
-
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
+    // Programa já linkado em disco (veja shader_program.h); só compilamos se não houver
+    textprogram_id = ShaderProgram_Create("shader_text",
+        "text (vertex)", textvertexshader_source, "text (fragment)", textfragmentshader_source);
     glCheckError();
 
     GLuint texttex_uniform;
@@ -126,8 +80,8 @@ void TextRendering_Init()
 
     glBindVertexArray(textVAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    // O VAO aponta para o buffer transitório, que nunca é realocado
+    glBindBuffer(GL_ARRAY_BUFFER, TransientBuffer_Buffer());
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
@@ -140,6 +94,15 @@ void TextRendering_Init()
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
     glCheckError();
+
+    for (size_t i = 0; i < 128; ++i)
+        textglyphs[i] = NULL;
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+    {
+        uint32_t codepoint = dejavufont.glyphs[j].codepoint;
+        if (codepoint < 128 && textglyphs[codepoint] == NULL)
+            textglyphs[codepoint] = &dejavufont.glyphs[j];
+    }
 }
 
 float textscale = 1.5f;
@@ -155,15 +118,8 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
     for (size_t i = 0; i < str.size(); i++)
     {
         // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-        {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
-        }
+        uint32_t codepoint = (uint32_t)str[i];
+        const texture_glyph_t *glyph = codepoint < 128 ? textglyphs[codepoint] : NULL;
         if (!glyph) {
             continue;
         }
@@ -178,37 +134,50 @@ void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float
         float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
         float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
 
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
+        const float data[24] = {
+            x0, y0, s0, t0,
+            x0, y1, s0, t1,
+            x1, y1, s1, t1,
+            x0, y0, s0, t0,
+            x1, y1, s1, t1,
+            x1, y0, s1, t0
         };
+        textvertices.insert(textvertices.end(), data, data + 24);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+        x += (glyph->advance_x * sx);
+    }
+}
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+// Desenha todo o texto impresso desde a última chamada, com um único envio
+// para o buffer transitório e um único glDrawArrays(). Deve ser chamada no
+// final do quadro.
+void TextRendering_Flush()
+{
+    if (textvertices.empty())
+        return;
+
+    const size_t stride = 4 * sizeof(float);
+    GLint first;
+    bool uploaded = TransientBuffer_Upload(textvertices.data(), textvertices.size() * sizeof(float), stride, &first);
+    GLsizei count = (GLsizei)(textvertices.size() / 4);
+    textvertices.clear();
+    if (!uploaded)
+        return;
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+    glUseProgram(textprogram_id);
+    glBindVertexArray(textVAO);
 
-        glDisable(GL_BLEND);
+    glDrawArrays(GL_TRIANGLES, first, count);
 
-        x += (glyph->advance_x * sx);
-    }
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_BLEND);
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
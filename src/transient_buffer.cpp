@@ -0,0 +1,134 @@
+// transient_buffer.cpp - Anel de geometria transitória
+//
+// Veja transient_buffer.h. As cópias usam o alvo GL_COPY_WRITE_BUFFER para não
+// alterar o GL_ARRAY_BUFFER ligado por quem chama.
+
+#include "transient_buffer.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "gl_extensions.h"
+
+struct TransientBufferState
+{
+    GLuint         buffer;
+    unsigned char* mapped;       // Mapeamento persistente (NULL no OpenGL 3.3)
+    GLsync         fences[TRANSIENT_RING_FRAMES];
+    size_t         frame;        // Trecho do quadro atual
+    size_t         used;         // Bytes usados no trecho atual
+    bool           overflow_reported;
+};
+
+static TransientBufferState g_Transient;
+
+void TransientBuffer_Init()
+{
+    memset(&g_Transient, 0, sizeof(g_Transient));
+
+    GLsizeiptr total = (GLsizeiptr)TRANSIENT_RING_FRAMES * TRANSIENT_FRAME_BYTES;
+    glGenBuffers(1, &g_Transient.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_Transient.buffer);
+
+    if (g_GLExtensions.buffer_storage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glext_BufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+        g_Transient.mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+        if (g_Transient.mapped == NULL)
+            fprintf(stderr, "WARNING: Mapeamento persistente do buffer transitório falhou.\n");
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    printf("Buffer transitório: %d x %d KiB, %s.\n", TRANSIENT_RING_FRAMES, TRANSIENT_FRAME_BYTES / 1024,
+        g_Transient.mapped ? "mapeado persistentemente" : "mapeamentos não sincronizados");
+}
+
+void TransientBuffer_Destroy()
+{
+    for (int i = 0; i < TRANSIENT_RING_FRAMES; ++i)
+        if (g_Transient.fences[i])
+            glDeleteSync(g_Transient.fences[i]);
+
+    if (g_Transient.mapped)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, g_Transient.buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &g_Transient.buffer);
+    memset(&g_Transient, 0, sizeof(g_Transient));
+}
+
+GLuint TransientBuffer_Buffer()
+{
+    return g_Transient.buffer;
+}
+
+void TransientBuffer_BeginFrame()
+{
+    g_Transient.frame = (g_Transient.frame + 1) % TRANSIENT_RING_FRAMES;
+    g_Transient.used  = 0;
+
+    GLsync& fence = g_Transient.fences[g_Transient.frame];
+    if (fence == 0)
+        return;
+
+    // Com três trechos a cerca quase sempre já foi sinalizada; se não, a GPU
+    // está dois quadros atrás e esperamos (sem limite: escrever seria pior)
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    if (status == GL_WAIT_FAILED)
+        fprintf(stderr, "WARNING: glClientWaitSync() falhou no buffer transitório.\n");
+
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+void TransientBuffer_EndFrame()
+{
+    GLsync& fence = g_Transient.fences[g_Transient.frame];
+    if (fence)
+        glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool TransientBuffer_Upload(const void* data, size_t size, size_t stride, GLint* first)
+{
+    // Alinhamos o endereço no buffer (não no trecho) para que o deslocamento
+    // seja um índice de vértice inteiro
+    size_t frame_start = g_Transient.frame * TRANSIENT_FRAME_BYTES;
+    size_t offset = (frame_start + g_Transient.used + stride - 1) / stride * stride;
+    if (offset + size > frame_start + TRANSIENT_FRAME_BYTES)
+    {
+        if (!g_Transient.overflow_reported)
+            fprintf(stderr, "WARNING: Buffer transitório cheio (%d KiB por quadro); geometria descartada.\n",
+                TRANSIENT_FRAME_BYTES / 1024);
+        g_Transient.overflow_reported = true;
+        return false;
+    }
+    g_Transient.used = offset + size - frame_start;
+    *first = (GLint)(offset / stride);
+
+    if (g_Transient.mapped)
+    {
+        memcpy(g_Transient.mapped + offset, data, size);
+        return true;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, g_Transient.buffer);
+    void* destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (destination)
+    {
+        memcpy(destination, data, size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return destination != NULL;
+}
@@ -0,0 +1,139 @@
+// uniform_buffers.cpp - UBOs de quadro e de objeto
+//
+// Veja uniform_buffers.h. As entradas de ObjectUniforms ficam no buffer com um
+// espaçamento múltiplo de GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (em geral 256
+// bytes), exigido para os deslocamentos de glBindBufferRange().
+
+#include "uniform_buffers.h"
+
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+static_assert(sizeof(FrameUniforms)  == 144, "FrameUniforms deve seguir o layout std140");
+static_assert(sizeof(ObjectUniforms) == 176, "ObjectUniforms deve seguir o layout std140");
+
+struct UniformBufferState
+{
+    GLuint frame_buffer;
+    GLuint object_buffer;          // Anel: UNIFORM_RING_FRAMES trechos de "capacity" entradas
+    GLuint immediate_buffer;       // Uma entrada, para desenhos avulsos
+    size_t stride;                 // Bytes entre entradas do anel
+    size_t capacity;               // Entradas por trecho
+    size_t ring_frame;             // Trecho do quadro atual
+    std::vector<ObjectUniforms> objects;  // Entradas do quadro atual (CPU)
+    std::vector<unsigned char>  staging;  // As mesmas, já com o espaçamento do buffer
+};
+
+static UniformBufferState g_UniformBuffers;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// (Re)cria o anel com "capacity" entradas por trecho
+static void AllocateObjectRing(size_t capacity)
+{
+    g_UniformBuffers.capacity = capacity;
+    glBindBuffer(GL_UNIFORM_BUFFER, g_UniformBuffers.object_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, UNIFORM_RING_FRAMES * capacity * g_UniformBuffers.stride, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffers_Init()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0)
+        alignment = 256;
+    g_UniformBuffers.stride = AlignUp(sizeof(ObjectUniforms), (size_t)alignment);
+    g_UniformBuffers.ring_frame = 0;
+
+    glGenBuffers(1, &g_UniformBuffers.frame_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_UniformBuffers.frame_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &g_UniformBuffers.immediate_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_UniformBuffers.immediate_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ObjectUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glGenBuffers(1, &g_UniformBuffers.object_buffer);
+    AllocateObjectRing(64);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING_FRAME, g_UniformBuffers.frame_buffer);
+}
+
+void UniformBuffers_Destroy()
+{
+    GLuint buffers[3] = { g_UniformBuffers.frame_buffer, g_UniformBuffers.object_buffer, g_UniformBuffers.immediate_buffer };
+    glDeleteBuffers(3, buffers);
+    g_UniformBuffers = UniformBufferState();
+}
+
+void UniformBuffers_BindBlocks(GLuint program_id)
+{
+    GLuint frame_block = glGetUniformBlockIndex(program_id, "FrameUniforms");
+    if (frame_block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program_id, frame_block, UNIFORM_BINDING_FRAME);
+
+    GLuint object_block = glGetUniformBlockIndex(program_id, "ObjectUniforms");
+    if (object_block != GL_INVALID_INDEX)
+        glUniformBlockBinding(program_id, object_block, UNIFORM_BINDING_OBJECT);
+}
+
+void UniformBuffers_SetFrame(const FrameUniforms& frame)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, g_UniformBuffers.frame_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    g_UniformBuffers.ring_frame = (g_UniformBuffers.ring_frame + 1) % UNIFORM_RING_FRAMES;
+}
+
+ObjectUniforms* UniformBuffers_BeginObjects(size_t count)
+{
+    if (count > g_UniformBuffers.capacity)
+    {
+        size_t capacity = g_UniformBuffers.capacity;
+        while (capacity < count)
+            capacity *= 2;
+        AllocateObjectRing(capacity);
+    }
+
+    g_UniformBuffers.objects.resize(count);
+    return g_UniformBuffers.objects.data();
+}
+
+void UniformBuffers_UploadObjects(size_t count)
+{
+    count = std::min(count, g_UniformBuffers.objects.size());
+    size_t stride = g_UniformBuffers.stride;
+    if (count == 0)
+        return;
+
+    g_UniformBuffers.staging.resize(count * stride);
+    for (size_t i = 0; i < count; ++i)
+        memcpy(&g_UniformBuffers.staging[i * stride], &g_UniformBuffers.objects[i], sizeof(ObjectUniforms));
+
+    size_t offset = g_UniformBuffers.ring_frame * g_UniformBuffers.capacity * stride;
+    glBindBuffer(GL_UNIFORM_BUFFER, g_UniformBuffers.object_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, count * stride, g_UniformBuffers.staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffers_ObjectRange(size_t index, GLuint* buffer, GLintptr* offset, GLsizeiptr* size)
+{
+    *buffer = g_UniformBuffers.object_buffer;
+    *offset = (GLintptr)((g_UniformBuffers.ring_frame * g_UniformBuffers.capacity + index) * g_UniformBuffers.stride);
+    *size   = sizeof(ObjectUniforms);
+}
+
+void UniformBuffers_SetImmediateObject(const ObjectUniforms& object)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, g_UniformBuffers.immediate_buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ObjectUniforms), &object);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING_OBJECT, g_UniformBuffers.immediate_buffer);
+}
@@ -0,0 +1,208 @@
+// vertex_format.cpp - Codificação do formato compacto de vértices
+//
+// Veja vertex_format.h para o layout. A decodificação correspondente está em
+// "shader_vertex.glsl" (função DecodeNormal() e cálculo de model_coefficients).
+
+#include "vertex_format.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex deve ter 12 bytes, sem preenchimento");
+
+size_t VertexFormat_ColorOffset(unsigned int flags)
+{
+    if (flags & VERTEX_FORMAT_TEXCOORDS)
+        return sizeof(PackedVertex);
+    return offsetof(PackedVertex, texcoord);
+}
+
+size_t VertexFormat_Stride(unsigned int flags)
+{
+    size_t stride = VertexFormat_ColorOffset(flags);
+    if (flags & VERTEX_FORMAT_COLORS)
+        stride += 4 * sizeof(GLushort);
+    return stride;
+}
+
+void VertexFormat_EncodePosition(const glm::vec3& position, const glm::vec3& bbox_min, const glm::vec3& bbox_max, GLushort out[3])
+{
+    for (int c = 0; c < 3; ++c)
+    {
+        float extent = bbox_max[c] - bbox_min[c];
+        float t = extent > 0.0f ? (position[c] - bbox_min[c]) / extent : 0.0f;
+        t = std::min(std::max(t, 0.0f), 1.0f);
+        out[c] = (GLushort)std::floor(t * 65535.0f + 0.5f);
+    }
+}
+
+static float SignNotZero(float value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+glm::vec3 VertexFormat_DecodeNormal(const GLbyte encoded[2])
+{
+    glm::vec2 e = glm::vec2(encoded[0], encoded[1]) / 127.0f;
+    glm::vec3 n = glm::vec3(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.0f)
+    {
+        n.x = (1.0f - std::fabs(e.y)) * SignNotZero(e.x);
+        n.y = (1.0f - std::fabs(e.x)) * SignNotZero(e.y);
+    }
+    return glm::normalize(n);
+}
+
+void VertexFormat_EncodeNormal(const glm::vec3& normal, GLbyte out[2])
+{
+    // Projeção no octaedro |x|+|y|+|z| = 1 e desdobramento do hemisfério
+    // inferior sobre o quadrado [-1,1]^2.
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (l1 == 0.0f)
+    {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+
+    glm::vec3 n = normal / l1;
+    glm::vec2 e = glm::vec2(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        e.x = (1.0f - std::fabs(n.y)) * SignNotZero(n.x);
+        e.y = (1.0f - std::fabs(n.x)) * SignNotZero(n.y);
+    }
+
+    // Com só 8 bits por componente, escolhemos entre os quatro vizinhos da
+    // grade aquele cuja normal decodificada fica mais próxima da original.
+    glm::vec3 unit = normal / std::sqrt(glm::dot(normal, normal));
+    float best_dot = -2.0f;
+    for (int i = 0; i < 4; ++i)
+    {
+        float x = (i & 1) ? std::ceil(e.x * 127.0f) : std::floor(e.x * 127.0f);
+        float y = (i & 2) ? std::ceil(e.y * 127.0f) : std::floor(e.y * 127.0f);
+
+        GLbyte candidate[2];
+        candidate[0] = (GLbyte)std::min(std::max(x, -127.0f), 127.0f);
+        candidate[1] = (GLbyte)std::min(std::max(y, -127.0f), 127.0f);
+
+        float d = glm::dot(VertexFormat_DecodeNormal(candidate), unit);
+        if (d > best_dot)
+        {
+            best_dot = d;
+            out[0] = candidate[0];
+            out[1] = candidate[1];
+        }
+    }
+}
+
+GLushort VertexFormat_EncodeHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign     = (bits >> 16) & 0x8000u;
+    int32_t  exponent = (int32_t)((bits >> 23) & 0xFFu) - 127 + 15;
+    uint32_t mantissa = bits & 0x007FFFFFu;
+
+    if (((bits >> 23) & 0xFFu) == 0xFFu) // Inf/NaN
+        return (GLushort)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+
+    if (exponent >= 31) // Grande demais: infinito
+        return (GLushort)(sign | 0x7C00u);
+
+    if (exponent <= 0) // Subnormal (ou zero)
+    {
+        if (exponent < -10)
+            return (GLushort)sign;
+        mantissa |= 0x00800000u;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1u);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            half += 1;
+        return (GLushort)(sign | half);
+    }
+
+    // Arredondamento para o mais próximo (empate para par). Um "vai um" da
+    // mantissa incrementa corretamente o expoente.
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        half += 1;
+    return (GLushort)half;
+}
+
+void VertexFormat_EncodeColor(const glm::vec3& color, GLushort out[4])
+{
+    out[0] = VertexFormat_EncodeHalf(color.r);
+    out[1] = VertexFormat_EncodeHalf(color.g);
+    out[2] = VertexFormat_EncodeHalf(color.b);
+    out[3] = 0;
+}
+
+void VertexFormat_SetupAttributes(unsigned int flags)
+{
+    GLsizei stride = (GLsizei)VertexFormat_Stride(flags);
+
+    // Posição quantizada: o shader recebe valores em [0,1] e interpola na bbox
+    GLuint location = 0; // "(location = 0)" em "shader_vertex.glsl"
+    glVertexAttribPointer(location, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(location);
+
+    // Normal octaédrica: valores inteiros em [-127,127], sem normalização pelo
+    // OpenGL (a regra de conversão de GL_BYTE normalizado mudou no OpenGL 4.2)
+    location = 1; // "(location = 1)" em "shader_vertex.glsl"
+    if (flags & VERTEX_FORMAT_NORMALS)
+    {
+        glVertexAttribPointer(location, 2, GL_BYTE, GL_FALSE, stride, (void*)offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(location);
+    }
+    else
+        glDisableVertexAttribArray(location);
+
+    location = 2; // "(location = 2)" em "shader_vertex.glsl"
+    if (flags & VERTEX_FORMAT_TEXCOORDS)
+    {
+        glVertexAttribPointer(location, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, texcoord));
+        glEnableVertexAttribArray(location);
+    }
+    else
+        glDisableVertexAttribArray(location);
+
+    // Sem cores por vértice o shader ignora o atributo e usa a cor do objeto
+    // do bloco "ObjectUniforms" (veja FlushRenderQueue())
+    location = VERTEX_FORMAT_COLOR_LOCATION; // "(location = 3)" em "shader_vertex.glsl"
+    if (flags & VERTEX_FORMAT_COLORS)
+    {
+        glVertexAttribPointer(location, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)VertexFormat_ColorOffset(flags));
+        glEnableVertexAttribArray(location);
+    }
+    else
+        glDisableVertexAttribArray(location);
+}
+
+void VertexFormat_SetupInstanceAttributes(size_t first_instance)
+{
+    GLsizei stride = 12 * sizeof(float);
+    size_t  base   = first_instance * stride;
+    for (GLuint row = 0; row < 3; ++row)
+    {
+        GLuint location = VERTEX_FORMAT_INSTANCE_LOCATION + row;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + row * 4 * sizeof(float)));
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+}
+
+void VertexFormat_ResetInstanceAttributes()
+{
+    glVertexAttrib4f(VERTEX_FORMAT_INSTANCE_LOCATION + 0, 1.0f, 0.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(VERTEX_FORMAT_INSTANCE_LOCATION + 1, 0.0f, 1.0f, 0.0f, 0.0f);
+    glVertexAttrib4f(VERTEX_FORMAT_INSTANCE_LOCATION + 2, 0.0f, 0.0f, 1.0f, 0.0f);
+}
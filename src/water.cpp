@@ -0,0 +1,235 @@
+// water.cpp - Superfície da água procedural
+//
+// Veja water.h. Cada onda i tem altura
+//
+//   amplitude[i] * sin(kx[i] * x + kz[i] * z + phase[i])
+//
+// onde (kx, kz) é o vetor de onda (direção * 2pi / comprimento) e phase[i] =
+// omega[i] * time, com omega da dispersão de águas profundas, sqrt(g * |k|).
+// A fase do instante é reduzida a [0, 2pi) em double antes de ir para a GPU ou
+// para o laço SIMD, então a precisão não se degrada com o tempo de jogo.
+
+#include "water.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WATER_USE_SSE
+#endif
+
+#include <glm/mat4x4.hpp>
+
+#include "game_types.h"
+#include "render_queue.h"
+#include "uniform_buffers.h"
+
+// Ondas: amplitude, comprimento e direção (radianos, a partir de +X)
+static const float WAVE_AMPLITUDE[WATER_WAVES]  = { 0.035f, 0.025f, 0.015f, 0.010f };
+static const float WAVE_LENGTH[WATER_WAVES]     = { 9.0f,   6.0f,   3.5f,   2.2f   };
+static const float WAVE_DIRECTION[WATER_WAVES]  = { 0.3f,   1.9f,  -0.8f,   2.7f   };
+
+// Cor difusa da água (antigo "water.mtl")
+static const glm::vec3 WATER_COLOR = glm::vec3(0.0f, 0.3f, 0.5f);
+
+// Fração do espaçamento médio da grade usada no centro: a posição de um
+// vértice é radius * u * (INNER + (1 - INNER) * |u|), com u em [-1,1]
+static const float WATER_GRID_INNER = 0.15f;
+
+struct WaveTable
+{
+    float amplitude[WATER_WAVES];
+    float kx[WATER_WAVES];
+    float kz[WATER_WAVES];
+    double omega[WATER_WAVES];
+};
+
+static WaveTable MakeWaveTable()
+{
+    WaveTable table;
+    for (int i = 0; i < WATER_WAVES; ++i)
+    {
+        float k = 2.0f * (float)M_PI / WAVE_LENGTH[i];
+        table.amplitude[i] = WAVE_AMPLITUDE[i];
+        table.kx[i]        = k * std::cos(WAVE_DIRECTION[i]);
+        table.kz[i]        = k * std::sin(WAVE_DIRECTION[i]);
+        table.omega[i]     = std::sqrt(9.8 * k);
+    }
+    return table;
+}
+
+static const WaveTable g_Waves = MakeWaveTable();
+
+struct WaterState
+{
+    GLuint    vertex_array;   // Sem atributos: tudo vem de gl_VertexID
+    glm::vec2 bounds_min;
+    glm::vec2 bounds_max;
+
+    // Locais dos uniforms do último programa usado
+    GLuint program;
+    GLint  grid_uniform;
+    GLint  cells_uniform;
+    GLint  bounds_uniform;
+    GLint  level_uniform;
+    GLint  amplitude_uniform;
+    GLint  kx_uniform;
+    GLint  kz_uniform;
+    GLint  phase_uniform;
+};
+
+static WaterState g_Water;
+
+// Fase de cada onda no instante "time", em [0, 2pi). A redução é feita em
+// double; só o resultado, pequeno, vira float.
+static void WavePhases(double time, float* phases)
+{
+    for (int i = 0; i < WATER_WAVES; ++i)
+        phases[i] = (float)std::fmod(g_Waves.omega[i] * time, 2.0 * M_PI);
+}
+
+void Water_Init(const glm::vec2& bounds_min, const glm::vec2& bounds_max)
+{
+    memset(&g_Water, 0, sizeof(g_Water));
+    g_Water.bounds_min = bounds_min;
+    g_Water.bounds_max = bounds_max;
+    glGenVertexArrays(1, &g_Water.vertex_array);
+}
+
+void Water_Destroy()
+{
+    glDeleteVertexArrays(1, &g_Water.vertex_array);
+    memset(&g_Water, 0, sizeof(g_Water));
+}
+
+#ifdef WATER_USE_SSE
+// sin() de quatro ângulos: redução a [-pi, pi], simetria
+// sin(x) = sin(pi - x) até [0, pi/2] e série de Taylor de grau 9 (erro < 4e-6)
+static inline __m128 Sin4(__m128 x)
+{
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 pi        = _mm_set1_ps((float)M_PI);
+    const __m128 two_pi    = _mm_set1_ps(2.0f * (float)M_PI);
+
+    __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.5f / (float)M_PI))));
+    x = _mm_sub_ps(x, _mm_mul_ps(turns, two_pi));
+
+    __m128 sign = _mm_and_ps(x, sign_mask);
+    __m128 a    = _mm_andnot_ps(sign_mask, x);
+    a = _mm_min_ps(a, _mm_sub_ps(pi, a));
+
+    __m128 a2 = _mm_mul_ps(a, a);
+    __m128 p  = _mm_set1_ps(1.0f / 362880.0f);
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(-1.0f / 5040.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(1.0f / 120.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(-1.0f / 6.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(1.0f));
+    return _mm_xor_ps(_mm_mul_ps(a, p), sign);
+}
+#endif
+
+void Water_Heights(const float* x, const float* z, size_t count, double time, float* heights)
+{
+    float phases[WATER_WAVES];
+    WavePhases(time, phases);
+
+    size_t i = 0;
+#ifdef WATER_USE_SSE
+    // Quatro pontos por iteração; os pontos que sobram vão por uma cópia
+    // completada com zeros
+    for (; i < count; i += 4)
+    {
+        float px[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float pz[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        size_t n = count - i < 4 ? count - i : 4;
+        memcpy(px, x + i, n * sizeof(float));
+        memcpy(pz, z + i, n * sizeof(float));
+
+        __m128 vx = _mm_loadu_ps(px);
+        __m128 vz = _mm_loadu_ps(pz);
+        __m128 h  = _mm_set1_ps(WATER_SURFACE_Y);
+        for (int w = 0; w < WATER_WAVES; ++w)
+        {
+            __m128 phase = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(g_Waves.kx[w])),
+                                                 _mm_mul_ps(vz, _mm_set1_ps(g_Waves.kz[w]))),
+                                      _mm_set1_ps(phases[w]));
+            h = _mm_add_ps(h, _mm_mul_ps(_mm_set1_ps(g_Waves.amplitude[w]), Sin4(phase)));
+        }
+
+        float result[4];
+        _mm_storeu_ps(result, h);
+        memcpy(heights + i, result, n * sizeof(float));
+    }
+#else
+    for (; i < count; ++i)
+    {
+        float h = WATER_SURFACE_Y;
+        for (int w = 0; w < WATER_WAVES; ++w)
+            h += g_Waves.amplitude[w] * std::sin(g_Waves.kx[w] * x[i] + g_Waves.kz[w] * z[i] + phases[w]);
+        heights[i] = h;
+    }
+#endif
+}
+
+float Water_Height(float x, float z, double time)
+{
+    float height;
+    Water_Heights(&x, &z, 1, time, &height);
+    return height;
+}
+
+void Water_Render(GLuint program_id, const glm::vec3& camera_position, double time)
+{
+    if (g_Water.vertex_array == 0)
+        return;
+
+    if (program_id != g_Water.program)
+    {
+        g_Water.program           = program_id;
+        g_Water.grid_uniform      = glGetUniformLocation(program_id, "water_grid");
+        g_Water.cells_uniform     = glGetUniformLocation(program_id, "water_grid_cells");
+        g_Water.bounds_uniform    = glGetUniformLocation(program_id, "water_bounds");
+        g_Water.level_uniform     = glGetUniformLocation(program_id, "water_level");
+        g_Water.amplitude_uniform = glGetUniformLocation(program_id, "wave_amplitude");
+        g_Water.kx_uniform        = glGetUniformLocation(program_id, "wave_kx");
+        g_Water.kz_uniform        = glGetUniformLocation(program_id, "wave_kz");
+        g_Water.phase_uniform     = glGetUniformLocation(program_id, "wave_phase");
+    }
+
+    // O centro da grade anda em passos do espaçamento médio, para que os
+    // vértices não deslizem sobre as ondas a cada movimento da câmera
+    float step = 2.0f * WATER_GRID_RADIUS / WATER_GRID_CELLS;
+    float center_x = std::floor(camera_position.x / step + 0.5f) * step;
+    float center_z = std::floor(camera_position.z / step + 0.5f) * step;
+
+    float phases[WATER_WAVES];
+    WavePhases(time, phases);
+
+    ObjectUniforms object;
+    memset(&object, 0, sizeof(object));
+    object.model         = glm::mat4(1.0f);
+    object.normal_matrix = glm::mat4(1.0f);
+    object.material_kd   = glm::vec4(WATER_COLOR, 0.0f);
+    UniformBuffers_SetImmediateObject(object);
+
+    // A água é o único objeto transparente: desenhada depois dos opacos, com
+    // blending, e ainda escrevendo profundidade como o antigo water.obj
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RenderState_SetBlend(true);
+    RenderState_UseProgram(program_id);
+    RenderState_BindVertexArray(g_Water.vertex_array);
+
+    glUniform4f(g_Water.grid_uniform, center_x, center_z, WATER_GRID_RADIUS, WATER_GRID_INNER);
+    glUniform1i(g_Water.cells_uniform, WATER_GRID_CELLS);
+    glUniform4f(g_Water.bounds_uniform, g_Water.bounds_min.x, g_Water.bounds_min.y, g_Water.bounds_max.x, g_Water.bounds_max.y);
+    glUniform1f(g_Water.level_uniform, WATER_SURFACE_Y);
+    glUniform4fv(g_Water.amplitude_uniform, 1, g_Waves.amplitude);
+    glUniform4fv(g_Water.kx_uniform, 1, g_Waves.kx);
+    glUniform4fv(g_Water.kz_uniform, 1, g_Waves.kz);
+    glUniform4fv(g_Water.phase_uniform, 1, phases);
+
+    glDrawArrays(GL_TRIANGLES, 0, WATER_GRID_CELLS * WATER_GRID_CELLS * 6);
+    RenderState_CountDraw();
+    RenderState_SetBlend(false);
+}